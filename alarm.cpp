@@ -0,0 +1,54 @@
+#include "alarm.h"
+
+// evaluate a new sample, updates alarm and returns the state change
+AlarmEvent alarmEvaluate(bool &alarm, float fridgeTemp, int targetTemp, int hysteresis) {
+    if (fridgeTemp > targetTemp && !alarm) {                        // If Fridge Temp is above Target Temp and alarm not yet triggered
+        alarm = true;
+        return ALARM_RAISED;
+    }
+    if (fridgeTemp < (targetTemp - hysteresis) && alarm) {          // If Fridge Temp is below Target Temp - Hysteresis and alarm is triggered
+        alarm = false;
+        return ALARM_CLEARED;
+    }
+    return ALARM_NONE;
+}
+
+// evaluate the projected time until TARGET_TEMP, updates preAlarm and returns the state change
+AlarmEvent preAlarmEvaluate(bool &preAlarm, float etaMinutes, int leadMinutes, int hysteresisMinutes) {
+    bool rising = etaMinutes >= 0;
+    if (!preAlarm && leadMinutes > 0 && rising && etaMinutes <= leadMinutes) {                   // Crossing expected within the lead time
+        preAlarm = true;
+        return ALARM_RAISED;
+    }
+    if (preAlarm && (leadMinutes == 0 || !rising || etaMinutes > leadMinutes + hysteresisMinutes)) {  // Disabled, falling or far enough away again
+        preAlarm = false;
+        return ALARM_CLEARED;
+    }
+    return ALARM_NONE;
+}
+
+// start/stop the reminder with the alarm output, returns the state change
+AlarmEvent alarmReminderUpdate(AlarmReminder &reminder, bool anyAlarm, uint32_t nowMs, uint32_t periodMs) {
+    if (anyAlarm && !reminder.running) {                            // First sensor in alarm
+        reminder.running = true;
+        reminder.nextMs = nowMs + periodMs;
+        return ALARM_RAISED;
+    }
+    if (!anyAlarm && reminder.running) {                            // Last sensor back to normal
+        reminder.running = false;
+        return ALARM_CLEARED;
+    }
+    return ALARM_NONE;
+}
+
+// true once per period while the reminder is running
+bool alarmReminderDue(AlarmReminder &reminder, uint32_t nowMs, uint32_t periodMs) {
+    if (!reminder.running || (int32_t)(nowMs - reminder.nextMs) < 0) {
+        return false;
+    }
+    reminder.nextMs += periodMs;
+    if ((int32_t)(nowMs - reminder.nextMs) >= 0) {                  // Late by more than a period (e.g. REMINDER shortened) -> no burst
+        reminder.nextMs = nowMs + periodMs;
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+// ======================================================================
+// Alarm state machine
+// ======================================================================
+// Raises the alarm above TARGET_TEMP and clears it below
+// TARGET_TEMP - HYSTERESIS. The pre-alarm is raised when the projected
+// time until TARGET_TEMP is crossed drops to PRE_ALARM minutes and
+// cleared when it grows beyond PRE_ALARM + PRE_ALARM_HYSTERESIS. The
+// reminder starts with the first sensor in alarm, fires every REMINDER
+// minutes from then on and stops with the last one back to normal.
+
+enum AlarmEvent {
+    ALARM_NONE,                                         // No state change
+    ALARM_RAISED,                                       // Fridge Temp rose above Target Temp
+    ALARM_CLEARED                                       // Fridge Temp fell below Target Temp - Hysteresis
+};
+
+AlarmEvent alarmEvaluate(bool &alarm, float fridgeTemp, int targetTemp, int hysteresis);
+AlarmEvent preAlarmEvaluate(bool &preAlarm, float etaMinutes, int leadMinutes, int hysteresisMinutes);  // etaMinutes < 0: not rising
+
+// Reminder schedule while any sensor is in alarm (times in halMillis()/millis())
+struct AlarmReminder {
+    bool running;                                       // Alarm output is on
+    uint32_t nextMs;                                    // Time of the next reminder
+};
+
+AlarmEvent alarmReminderUpdate(AlarmReminder &reminder, bool anyAlarm, uint32_t nowMs, uint32_t periodMs);  // Raised: first sensor in alarm, cleared: last one back
+bool alarmReminderDue(AlarmReminder &reminder, uint32_t nowMs, uint32_t periodMs);   // True once per period while running
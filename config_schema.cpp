@@ -0,0 +1,148 @@
+#include "config_schema.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+AppConfig config;                                       // Shared configuration and runtime state
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+void configLock() { portENTER_CRITICAL(&configMux); }
+void configUnlock() { portEXIT_CRITICAL(&configMux); }
+#else
+void configLock() {}                                    // Native build is single threaded
+void configUnlock() {}
+#endif
+
+// pointer to a field
+static inline void *fieldPtr(AppConfig &cfg, const ConfigField &field) {
+    return (uint8_t *)&cfg + field.offset;
+}
+
+static inline const void *fieldPtr(const AppConfig &cfg, const ConfigField &field) {
+    return (const uint8_t *)&cfg + field.offset;
+}
+
+// clamp a number to the range of a field
+static float clampField(const ConfigField &field, float value) {
+    if (isnan(value)) { return field.defaultNumber; }
+    return value < field.min ? field.min : (value > field.max ? field.max : value);
+}
+
+// set a number field, returns true if changed
+static bool setNumber(AppConfig &cfg, const ConfigField &field, float value) {
+    void *p = fieldPtr(cfg, field);
+    switch (field.type) {
+        case FIELD_BOOL: {
+            bool b = value != 0;
+            if (*(bool *)p == b) { return false; }
+            *(bool *)p = b;
+            return true;
+        }
+        case FIELD_INT: {
+            int32_t i = (int32_t)lroundf(clampField(field, value));
+            if (*(int32_t *)p == i) { return false; }
+            *(int32_t *)p = i;
+            return true;
+        }
+        case FIELD_FLOAT: {
+            float f = clampField(field, value);
+            if (*(float *)p == f) { return false; }
+            *(float *)p = f;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// set a string field, returns true if changed
+static bool setString(AppConfig &cfg, const ConfigField &field, const char *value) {
+    char *p = (char *)fieldPtr(cfg, field);
+    if (strncmp(p, value, field.size) == 0) { return false; }
+    strncpy(p, value, field.size - 1);
+    p[field.size - 1] = '\0';
+    return true;
+}
+
+// set all fields to their defaults
+void configDefaults(AppConfig &cfg) {
+    memset(&cfg, 0, sizeof(cfg));
+    for (const ConfigField &field : CONFIG_SCHEMA) {
+        if (field.type == FIELD_STR) {
+            setString(cfg, field, field.defaultString);
+        } else {
+            setNumber(cfg, field, field.defaultNumber);
+        }
+    }
+}
+
+// schema index of a key
+int configFind(const char *key) {
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (strcmp(CONFIG_SCHEMA[i].key, key) == 0) { return i; }
+    }
+    return -1;
+}
+
+// set all known fields present in obj
+void configFromJson(AppConfig &cfg, JsonObjectConst obj) {
+    for (const ConfigField &field : CONFIG_SCHEMA) {
+        JsonVariantConst value = obj[field.key];
+        if (value.isNull()) {
+            continue;
+        }
+        if (field.type == FIELD_STR) {
+            setString(cfg, field, value.is<const char *>() ? value.as<const char *>() : "");
+        } else {
+            setNumber(cfg, field, value.as<float>());
+        }
+    }
+}
+
+// fields with all "require" and none of the "skip" flags
+void configToJson(const AppConfig &cfg, JsonDocument &doc, uint8_t require, uint8_t skip) {
+    for (const ConfigField &field : CONFIG_SCHEMA) {
+        if ((field.flags & require) != require || (field.flags & skip) != 0) {
+            continue;
+        }
+        const void *p = fieldPtr(cfg, field);
+        switch (field.type) {
+            case FIELD_BOOL:  doc[field.key] = *(const bool *)p; break;
+            case FIELD_INT:   doc[field.key] = *(const int32_t *)p; break;
+            case FIELD_FLOAT: doc[field.key] = *(const float *)p; break;
+            case FIELD_STR:   doc[field.key] = (const char *)p; break;
+        }
+    }
+}
+
+// set a field of config from a /getdata parameter
+bool configApplyParam(const char *key, const char *value) {
+    int index = configFind(key);
+    if (index < 0 || (CONFIG_SCHEMA[index].flags & CFG_READONLY)) {
+        return false;
+    }
+    const ConfigField &field = CONFIG_SCHEMA[index];
+
+    float number = 0;
+    if (field.type == FIELD_BOOL) {                     // Convert "true"/"false" to boolean
+        number = strcmp(value, "true") == 0 ? 1 : 0;
+    } else if (field.type != FIELD_STR) {               // Convert to integer/float
+        char *end;
+        number = strtof(value, &end);
+        if (end == value) { return false; }             // Not a number -> keep the old value
+    }
+
+    configLock();
+    bool changed = field.type == FIELD_STR ? setString(config, field, value) : setNumber(config, field, number);
+    configUnlock();
+    return changed;
+}
+
+// consistent copy of config
+void configCopy(AppConfig &copy) {
+    configLock();
+    memcpy(&copy, &config, sizeof(AppConfig));
+    configUnlock();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Configuration schema
+// ======================================================================
+// Single source for the configuration and runtime state: the table below
+// generates the AppConfig struct (plain members, O(1) access in the hot
+// path) and the constexpr CONFIG_SCHEMA used at the JSON boundaries
+// (config file, /getdata). Ranges are applied whenever a value is set
+// from JSON or a /getdata parameter.
+
+#define CONFIG_DEFAULT_NOTIFY_URL "https://api.callmebot.com/whatsapp.php"
+#define CONFIG_DEFAULT_TIMEZONE "CET-1CEST,M3.5.0,M10.5.0/3"  // POSIX TZ, Europe/Berlin
+
+// Field flags
+#define CFG_PERSIST  0x01                               // Stored in /config.json
+#define CFG_NVS      0x02                               // Runtime value stored in NVS
+#define CFG_SECRET   0x04                               // Never sent to the public web UI snapshot
+#define CFG_READONLY 0x08                               // Cannot be set via /getdata
+
+//  B(member, key, default, flags)
+//  I(member, key, default, min, max, flags)
+//  F(member, key, default, min, max, flags)
+//  S(member, key, size, default, flags)
+#define CONFIG_FIELDS(B, I, F, S) \
+    S(mode,              "MODE",                12,  "NORMAL",                   CFG_PERSIST) \
+    I(targetTemp,        "TARGET_TEMP",         7,    0,    25,                  CFG_PERSIST) \
+    F(minTemp,           "MIN_TEMP",            100,  -100, 100,                 CFG_NVS) \
+    F(maxTemp,           "MAX_TEMP",            -100, -100, 100,                 CFG_NVS) \
+    I(hysteresis,        "HYSTERESIS",          2,    0,    10,                  CFG_PERSIST) \
+    B(notification,      "NOTIFICATION",        false,                           CFG_PERSIST) \
+    S(notifyUrl,         "NOTIFY_URL",          128, CONFIG_DEFAULT_NOTIFY_URL,  CFG_PERSIST) \
+    I(reminder,          "REMINDER",            30,   1,    1440,                CFG_PERSIST) \
+    I(preAlarm,          "PRE_ALARM",           0,    0,    240,                 CFG_PERSIST) \
+    I(preAlarmHysteresis, "PRE_ALARM_HYSTERESIS", 15, 0,    120,                 CFG_PERSIST) \
+    I(sampleMin,         "SAMPLE_MIN",          10,   2,    60,                  CFG_PERSIST) \
+    I(sampleMax,         "SAMPLE_MAX",          60,   2,    600,                 CFG_PERSIST) \
+    I(deepSleepMinInterval, "DEEP_SLEEP_MIN_INTERVAL", 5, 1, 1440,               CFG_PERSIST) \
+    I(deepSleepInterval, "DEEP_SLEEP_INTERVAL", 15,   1,    1440,                CFG_PERSIST) \
+    I(sensorResolution,  "SENSOR_RESOLUTION",   12,   9,    12,                  CFG_PERSIST) \
+    F(fridgeTemp,        "FRIDGE_TEMP",         0,    -127, 125,                 CFG_READONLY) \
+    F(trend,             "TREND",               0,    -100, 100,                 CFG_READONLY) \
+    F(preAlarmEta,       "PRE_ALARM_ETA",       -1,   -1,   10000,               CFG_READONLY) \
+    S(hostname,          "HOSTNAME",            32,  "aldo-mopro",               CFG_PERSIST) \
+    S(timezone,          "TIMEZONE",            48,  CONFIG_DEFAULT_TIMEZONE,    CFG_PERSIST) \
+    S(wifiApSsid,        "WIFI_AP_SSID",        33,  "aldo-mopro",               CFG_PERSIST) \
+    S(wifiStaSsid,       "WIFI_STA_SSID",       33,  "",                         CFG_PERSIST) \
+    S(wifiStaPw,         "WIFI_STA_PW",         64,  "",                         CFG_PERSIST | CFG_SECRET) \
+    S(phoneNumber1,      "PHONE_NUMBER_1",      20,  "",                         CFG_PERSIST) \
+    S(apiKey1,           "API_KEY_1",           24,  "",                         CFG_PERSIST | CFG_SECRET) \
+    S(phoneNumber2,      "PHONE_NUMBER_2",      20,  "",                         CFG_PERSIST) \
+    S(apiKey2,           "API_KEY_2",           24,  "",                         CFG_PERSIST | CFG_SECRET) \
+    S(phoneNumber3,      "PHONE_NUMBER_3",      20,  "",                         CFG_PERSIST) \
+    S(apiKey3,           "API_KEY_3",           24,  "",                         CFG_PERSIST | CFG_SECRET) \
+    S(mqttHost,          "MQTT_HOST",           64,  "",                         CFG_PERSIST) \
+    I(mqttPort,          "MQTT_PORT",           1883, 1,    65535,               CFG_PERSIST) \
+    S(mqttUser,          "MQTT_USER",           32,  "",                         CFG_PERSIST) \
+    S(mqttPassword,      "MQTT_PASSWORD",       64,  "",                         CFG_PERSIST | CFG_SECRET) \
+    S(mqttPrefix,        "MQTT_PREFIX",         48,  "aldo-mopro",               CFG_PERSIST) \
+    I(mqttQos,           "MQTT_QOS",            1,    0,    2,                   CFG_PERSIST) \
+    I(mqttBatch,         "MQTT_BATCH",          60,   0,    3600,                CFG_PERSIST) \
+    S(version,           "VERSION",             16,  "",                         CFG_READONLY) \
+    B(alarm,             "ALARM",               false,                           CFG_READONLY) \
+    B(preAlarmActive,    "PRE_ALARM_ACTIVE",    false,                           CFG_READONLY)
+
+// Configuration and runtime state
+struct AppConfig {
+#define CFG_MEMBER_B(m, k, d, f) bool m;
+#define CFG_MEMBER_I(m, k, d, lo, hi, f) int32_t m;
+#define CFG_MEMBER_F(m, k, d, lo, hi, f) float m;
+#define CFG_MEMBER_S(m, k, n, d, f) char m[n];
+    CONFIG_FIELDS(CFG_MEMBER_B, CFG_MEMBER_I, CFG_MEMBER_F, CFG_MEMBER_S)
+#undef CFG_MEMBER_B
+#undef CFG_MEMBER_I
+#undef CFG_MEMBER_F
+#undef CFG_MEMBER_S
+};
+
+enum ConfigType : uint8_t { FIELD_BOOL, FIELD_INT, FIELD_FLOAT, FIELD_STR };
+
+// Schema entry
+struct ConfigField {
+    const char *key;                                    // JSON key
+    ConfigType type;                                    // Field type
+    uint16_t offset;                                    // Offset in AppConfig
+    uint16_t size;                                      // Size in AppConfig (capacity for strings)
+    float min;                                          // Range for numbers
+    float max;
+    float defaultNumber;                                // Default for bool/int/float
+    const char *defaultString;                          // Default for strings
+    uint8_t flags;                                      // CFG_* flags
+};
+
+constexpr ConfigField CONFIG_SCHEMA[] = {
+#define CFG_SCHEMA_B(m, k, d, f) { k, FIELD_BOOL, offsetof(AppConfig, m), sizeof(bool), 0, 1, (d) ? 1.0f : 0.0f, nullptr, f },
+#define CFG_SCHEMA_I(m, k, d, lo, hi, f) { k, FIELD_INT, offsetof(AppConfig, m), sizeof(int32_t), lo, hi, d, nullptr, f },
+#define CFG_SCHEMA_F(m, k, d, lo, hi, f) { k, FIELD_FLOAT, offsetof(AppConfig, m), sizeof(float), lo, hi, d, nullptr, f },
+#define CFG_SCHEMA_S(m, k, n, d, f) { k, FIELD_STR, offsetof(AppConfig, m), n, 0, 0, 0, d, f },
+    CONFIG_FIELDS(CFG_SCHEMA_B, CFG_SCHEMA_I, CFG_SCHEMA_F, CFG_SCHEMA_S)
+#undef CFG_SCHEMA_B
+#undef CFG_SCHEMA_I
+#undef CFG_SCHEMA_F
+#undef CFG_SCHEMA_S
+};
+
+constexpr size_t CONFIG_FIELD_COUNT = sizeof(CONFIG_SCHEMA) / sizeof(CONFIG_SCHEMA[0]);
+static_assert(CONFIG_FIELD_COUNT <= 64, "dirty masks are 64 bit");
+
+extern AppConfig config;                                // Shared configuration and runtime state
+
+void configLock();                                      // Guard multi-field/string access across tasks
+void configUnlock();
+void configDefaults(AppConfig &cfg);                    // Set all fields to their defaults
+int configFind(const char *key);                        // Schema index of a key, -1 if unknown
+void configFromJson(AppConfig &cfg, JsonObjectConst obj);   // Set all known fields present in obj
+void configToJson(const AppConfig &cfg, JsonDocument &doc, uint8_t require, uint8_t skip);  // Fields with all "require" and none of the "skip" flags
+bool configApplyParam(const char *key, const char *value);  // Set a field of config from a /getdata parameter, true if changed
+void configCopy(AppConfig &copy);                       // Consistent copy of config
@@ -0,0 +1,49 @@
+#include "config_store.h"
+#include <string.h>
+#include "hal.h"
+#include "debug.h"
+
+// defaults + values from the configuration file
+bool configLoad(AppConfig &cfg, const char *version) {
+    configDefaults(cfg);
+    strncpy(cfg.version, version, sizeof(cfg.version) - 1);                 // Add version to config
+
+    if (!halFileExists(CONFIG_FILE)) {
+        debugln("❌ No configuration file found");
+        return false;
+    }
+
+    static char buffer[CONFIG_FILE_MAX];
+    size_t len = halFileRead(CONFIG_FILE, buffer, sizeof(buffer));
+
+    JsonDocument doc;                                                       // Only used while parsing
+    DeserializationError error = deserializeJson(doc, buffer, len);         // Deserialize the JSON document
+    if (error) {
+        debugf("❌ DeserializeJson failed! -> %s\n", error.c_str());
+        return false;
+    }
+
+    configFromJson(cfg, doc.as<JsonObjectConst>());
+    debugf("✅ Configuration loaded (%u bytes)\n", (unsigned)len);
+    return true;
+}
+
+// pretty-print the persisted fields
+size_t configSerialize(const AppConfig &cfg, char *buffer, size_t maxLen) {
+    JsonDocument doc;
+    configToJson(cfg, doc, CFG_PERSIST, 0);
+    if (measureJsonPretty(doc) >= maxLen) {
+        return 0;
+    }
+    return serializeJsonPretty(doc, buffer, maxLen);
+}
+
+// write the file (temp file + rename, so a power cut keeps the old file)
+bool configSave(const char *data, size_t len) {
+    if (halFileWrite(CONFIG_TMP_FILE, data, len) != len || !halFileRename(CONFIG_TMP_FILE, CONFIG_FILE)) {
+        debugln("❌ Failed to write to JSON file");
+        halFileRemove(CONFIG_TMP_FILE);
+        return false;
+    }
+    return true;
+}
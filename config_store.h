@@ -0,0 +1,15 @@
+#pragma once
+
+#include "config_schema.h"
+
+// ======================================================================
+// Configuration file
+// ======================================================================
+
+#define CONFIG_FILE "/config.json"                      // Configuration file
+#define CONFIG_TMP_FILE "/config.tmp"                   // Temp file for atomic config writes
+#define CONFIG_FILE_MAX 2048                            // Max. size of the configuration file
+
+bool configLoad(AppConfig &cfg, const char *version);  // Defaults + values from the configuration file
+size_t configSerialize(const AppConfig &cfg, char *buffer, size_t maxLen); // Pretty-print the persisted fields, 0 if too large
+bool configSave(const char *data, size_t len);          // Write the file (temp file + rename)
@@ -0,0 +1,40 @@
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <cstdio>
+#include <iostream>
+#endif
+
+#define DEBUG_SERIAL true                               // Enable debbuging over serial interface
+#define DEBUG_LINE_LEN 192                              // Longer debug lines are cut, formatted on the stack
+
+#if DEBUG_SERIAL && defined(ARDUINO)
+// printf to Serial without the heap (Print::printf allocates above 64 bytes)
+__attribute__((format(printf, 1, 2))) inline void debugPrintf(const char *format, ...) {
+    char line[DEBUG_LINE_LEN];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (len > 0) {
+        Serial.write((const uint8_t *)line, len < (int)sizeof(line) ? len : sizeof(line) - 1);
+    }
+}
+
+    #define debug(x) Serial.print(x)
+    #define debugf(x, ...) debugPrintf((x), ##__VA_ARGS__)
+    #define debugln(x) Serial.println(x)
+    #define debug_speed(x) Serial.begin(x)
+#elif DEBUG_SERIAL                                      // Native build: print to stdout
+    #define debug(x) (std::cout << (x))
+    #define debugf(x, ...) std::printf((x), ##__VA_ARGS__)
+    #define debugln(x) (std::cout << (x) << std::endl)
+    #define debug_speed(x)
+#else
+    #define debug(x)
+    #define debugf(x, ...)
+    #define debugln(x)
+    #define debug_speed(x) 
+#endif
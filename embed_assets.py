@@ -0,0 +1,118 @@
+# ======================================================================
+# Embed web assets
+# ======================================================================
+# PlatformIO pre-build script: minifies and gzips the web UI and writes
+# it as constant byte arrays to $BUILD_DIR/generated/web_assets_data.h,
+# so the UI is served from flash and survives a wiped LittleFS.
+# Each asset gets a content hash used as strong ETag. CSS/SVG/icon
+# references in the pages are fingerprinted with ?v=<hash>, so those
+# can be cached forever while the pages are revalidated.
+
+Import("env")
+
+import gzip
+import hashlib
+import os
+import re
+
+# (file, url, mime type, compress) - pages last, they reference the others
+ASSETS = [
+    ("style.css", "/style.css", "text/css", True),
+    ("icons.svg", "/icons.svg", "image/svg+xml", True),
+    ("cold-32.png", "/favicon.ico", "image/png", False),  # Already compressed
+    ("index.html", "/", "text/html", True),
+    ("config.html", "/config", "text/html", True),
+    ("system.html", "/system", "text/html", True),
+]
+
+
+# look up an asset in the data dir first, then in the project dir
+def find_asset(name):
+    for folder in (env.subst("$PROJECT_DATA_DIR"), env.subst("$PROJECT_DIR")):
+        path = os.path.join(folder, name)
+        if os.path.isfile(path):
+            return path
+    raise FileNotFoundError("embed_assets: %s not found" % name)
+
+
+# conservative minifier: comments and indentation only, no JS rewriting
+def minify(text, mime):
+    if mime == "text/css":
+        text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+        text = re.sub(r"\s+", " ", text)
+        text = re.sub(r"\s*([{};,])\s*", r"\1", text)
+        return text.replace(";}", "}").strip()
+
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if line == "" or line.startswith("//"):        # Full-line JS comments only, URLs stay intact
+            continue
+        lines.append(line)
+    text = "\n".join(lines)
+    if mime == "image/svg+xml":
+        text = re.sub(r">\s+<", "><", text)
+    return text
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def c_array(name, data):
+    rows = []
+    for i in range(0, len(data), 24):
+        rows.append("    " + ",".join("0x%02x" % b for b in data[i:i + 24]) + ",")
+    return "static const uint8_t %s[%d] = {\n%s\n};\n" % (name, len(data), "\n".join(rows))
+
+
+def embed_assets():
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    out_file = os.path.join(out_dir, "web_assets_data.h")
+
+    hashes = {}                                         # url -> content hash for fingerprinting
+    arrays = []
+    entries = []
+    total_in = 0
+    total_out = 0
+
+    for name, url, mime, compress in ASSETS:
+        with open(find_asset(name), "rb") as f:
+            raw = f.read()
+        data = raw
+        if mime.startswith("text/") or mime == "image/svg+xml":
+            text = minify(raw.decode("utf-8"), mime)
+            for ref, ref_hash in hashes.items():        # href="/style.css" -> href="/style.css?v=<hash>"
+                text = text.replace('"%s"' % ref, '"%s?v=%s"' % (ref, ref_hash))
+            data = text.encode("utf-8")
+        if compress:
+            data = gzip.compress(data, 9, mtime=0)      # mtime=0: reproducible output and hash
+
+        digest = content_hash(data)
+        if mime != "text/html":                         # Pages keep their URLs and are revalidated
+            hashes[url] = digest
+        symbol = "asset_" + re.sub(r"\W", "_", name)
+        arrays.append(c_array(symbol, data))
+        entries.append('    {"%s", "%s", %s, sizeof(%s), "\\"%s\\"", %s},' %
+                       (url, mime, symbol, symbol, digest, "true" if compress else "false"))
+        total_in += len(raw)
+        total_out += len(data)
+
+    header = "// Generated by embed_assets.py - do not edit\n#pragma once\n\n"
+    header += "".join(arrays)
+    header += "\nstatic const WebAsset WEB_ASSETS[] = {\n%s\n};\n" % "\n".join(entries)
+
+    os.makedirs(out_dir, exist_ok=True)
+    old = None
+    if os.path.isfile(out_file):
+        with open(out_file) as f:
+            old = f.read()
+    if old != header:                                   # Keep the timestamp, no rebuild if nothing changed
+        with open(out_file, "w") as f:
+            f.write(header)
+    print("embed_assets: %d assets, %d -> %d bytes" % (len(ASSETS), total_in, total_out))
+    env.Append(CPPPATH=[out_dir])
+
+
+embed_assets()
@@ -0,0 +1,324 @@
+#include "fw_update.h"
+#include <LittleFS.h>
+#include <Update.h>
+#include <mbedtls/sha256.h>
+#include "esp32/rom/miniz.h"
+#include "debug.h"
+#include "metrics.h"
+
+#define GZIP_FLAG_FHCRC 0x02                            // gzip header flags (RFC 1952)
+#define GZIP_FLAG_FEXTRA 0x04
+#define GZIP_FLAG_FNAME 0x08
+#define GZIP_FLAG_FCOMMENT 0x10
+
+// State of the running upload, only touched by the async TCP task
+struct UpdateState {
+    AsyncWebServerRequest *owner;                       // Request that started the running update
+    bool active;                                        // Update.begin() done, not yet ended or aborted
+    bool ok;                                            // Verified and committed
+    bool filesystem;                                    // LittleFS image instead of firmware
+    bool gzip;                                          // Image is gzip-compressed
+    bool headerDone;                                    // gzip header skipped, inflating
+    bool inflated;                                      // End of the deflate stream reached
+    int httpCode;                                       // Response for the finished upload
+    const char *error;
+    uint8_t expected[32];                               // SHA-256 given with the request
+    mbedtls_sha256_context sha;                         // SHA-256 of the inflated image
+    tinfl_decompressor *inflater;                       // Allocated for gzip images only
+    uint8_t *window;                                    // Circular 32 KB output window (deflate history)
+    size_t windowOfs;
+    uint8_t header[FW_UPDATE_GZIP_HEADER_MAX];          // gzip header collected across chunks
+    size_t headerLen;
+    uint32_t received;                                  // Bytes uploaded (compressed)
+    uint32_t written;                                   // Bytes written to flash (inflated)
+    uint32_t startMs;
+    uint32_t progressMs;                                // Last progress event
+};
+
+static UpdateState state;
+static AsyncEventSource *progressEvents = nullptr;
+
+static const char *lastResult = "none";                 // Statistics of the last update
+static uint32_t lastReceived = 0;
+static uint32_t lastWritten = 0;
+static uint32_t lastDurationMs = 0;
+static uint32_t updatesDone = 0;
+static uint32_t updatesFailed = 0;
+
+// parse 64 hex digits
+static bool parseSha256(const String &hex, uint8_t *digest) {
+    if (hex.length() != 64) {
+        return false;
+    }
+    for (int i = 0; i < 32; i++) {
+        char byte[3] = { hex[2 * i], hex[2 * i + 1], '\0' };
+        char *end;
+        digest[i] = strtoul(byte, &end, 16);
+        if (*end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// length of a gzip header, 0 if more bytes are needed, -1 if it is not a deflate gzip header
+static int gzipHeaderLength(const uint8_t *p, size_t n) {
+    if (n < 10) {
+        return 0;
+    }
+    if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 8) {    // Magic, method deflate
+        return -1;
+    }
+    uint8_t flags = p[3];
+    size_t pos = 10;                                    // Magic, method, flags, mtime, xfl, os
+    if (flags & GZIP_FLAG_FEXTRA) {
+        if (n < pos + 2) { return 0; }
+        pos += 2 + (p[pos] | p[pos + 1] << 8);
+    }
+    if (flags & GZIP_FLAG_FNAME) {                      // Zero-terminated strings
+        while (pos < n && p[pos] != 0) { pos++; }
+        if (pos++ >= n) { return 0; }
+    }
+    if (flags & GZIP_FLAG_FCOMMENT) {
+        while (pos < n && p[pos] != 0) { pos++; }
+        if (pos++ >= n) { return 0; }
+    }
+    if (flags & GZIP_FLAG_FHCRC) {
+        pos += 2;
+    }
+    return pos <= n ? (int)pos : 0;
+}
+
+// release the inflate buffers
+static void freeBuffers() {
+    free(state.inflater);
+    free(state.window);
+    state.inflater = nullptr;
+    state.window = nullptr;
+}
+
+// stop the update with an error, the rest of the upload is ignored
+static void fail(int httpCode, const char *error) {
+    if (state.active) {
+        Update.abort();
+        mbedtls_sha256_free(&state.sha);
+        state.active = false;
+    }
+    freeBuffers();
+    if (state.filesystem && !LittleFS.begin()) {        // Unusable image -> formatted on the next start
+        debugln("❌ Update: LittleFS not mounted until restart");
+    }
+    state.httpCode = httpCode;
+    state.error = error;
+    updatesFailed++;
+    lastResult = error;
+    debugf("❌ Update failed: %s\n", error);
+}
+
+// hash and write inflated bytes
+static bool writeImage(uint8_t *data, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    mbedtls_sha256_update(&state.sha, data, len);
+    if (Update.write(data, len) != len) {
+        Update.printError(Serial);
+        fail(500, Update.errorString());
+        return false;
+    }
+    state.written += len;
+    return true;
+}
+
+// inflate a piece of the deflate stream through the window
+static bool inflate(const uint8_t *data, size_t len) {
+    size_t pos = 0;
+    while (!state.inflated) {
+        size_t inBytes = len - pos;
+        size_t outBytes = TINFL_LZ_DICT_SIZE - state.windowOfs;
+        tinfl_status status = tinfl_decompress(state.inflater, data + pos, &inBytes, state.window,
+                                               state.window + state.windowOfs, &outBytes, TINFL_FLAG_HAS_MORE_INPUT);
+        pos += inBytes;
+        if (!writeImage(state.window + state.windowOfs, outBytes)) {
+            return false;
+        }
+        state.windowOfs = (state.windowOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+        if (status == TINFL_STATUS_DONE) {
+            state.inflated = true;                      // The gzip trailer (CRC32, size) is not needed, SHA-256 covers it
+        } else if (status < TINFL_STATUS_DONE) {
+            fail(400, "Corrupt gzip data");
+            return false;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && pos >= len) {
+            break;                                      // Wait for the next chunk
+        }
+    }
+    return true;
+}
+
+// start a new update from the first chunk
+static bool beginUpdate(AsyncWebServerRequest *request, const String &filename, const uint8_t *data, size_t len) {
+    if (state.active) {                                 // Previous upload was cut off
+        Update.abort();
+        mbedtls_sha256_free(&state.sha);
+    }
+    freeBuffers();
+    memset(&state, 0, sizeof(state));
+    state.owner = request;
+    state.startMs = millis();
+    state.progressMs = state.startMs;
+    state.filesystem = request->hasParam("target") && request->getParam("target")->value() == "filesystem";
+    state.gzip = len >= 2 && data[0] == 0x1f && data[1] == 0x8b;
+    debugf("🆙 Update Start: %s (%s%s)\n", filename.c_str(), state.filesystem ? "filesystem" : "firmware", state.gzip ? ", gzip" : "");
+
+    if (!request->hasParam("sha256") || !parseSha256(request->getParam("sha256")->value(), state.expected)) {
+        fail(400, "Missing or invalid sha256 parameter");
+        return false;
+    }
+    if (state.gzip) {                                   // Allocated once for the whole upload
+        state.inflater = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+        state.window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+        if (state.inflater == nullptr || state.window == nullptr) {
+            fail(503, "Not enough memory to inflate");
+            return false;
+        }
+        tinfl_init(state.inflater);
+    }
+    if (state.filesystem) {
+        LittleFS.end();                                 // Overwritten below
+    }
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN, state.filesystem ? U_SPIFFS : U_FLASH)) {
+        Update.printError(Serial);
+        fail(500, Update.errorString());
+        return false;
+    }
+    mbedtls_sha256_init(&state.sha);
+    mbedtls_sha256_starts(&state.sha, 0);
+    state.active = true;
+    return true;
+}
+
+// feed a chunk of the upload
+static void feed(const uint8_t *data, size_t len) {
+    if (!state.gzip) {
+        writeImage((uint8_t *)data, len);
+        return;
+    }
+    if (!state.headerDone) {                            // Collect the header, it may span chunks
+        size_t take = min(len, sizeof(state.header) - state.headerLen);
+        memcpy(state.header + state.headerLen, data, take);
+        state.headerLen += take;
+        int headerLen = gzipHeaderLength(state.header, state.headerLen);
+        if (headerLen < 0 || (headerLen == 0 && state.headerLen == sizeof(state.header))) {
+            fail(400, "Unsupported gzip header");
+            return;
+        }
+        if (headerLen == 0) {
+            return;
+        }
+        state.headerDone = true;
+        if (!inflate(state.header + headerLen, state.headerLen - headerLen)) {
+            return;
+        }
+        data += take;
+        len -= take;
+    }
+    inflate(data, len);
+}
+
+// push progress and throughput to the live clients
+static void sendProgress(AsyncWebServerRequest *request, bool force) {
+    uint32_t now = millis();
+    if (progressEvents == nullptr || (!force && now - state.progressMs < FW_UPDATE_PROGRESS_MS)) {
+        return;
+    }
+    state.progressMs = now;
+    uint32_t elapsed = now - state.startMs + 1;         // ms, never 0
+    size_t total = request->contentLength();            // Includes the multipart framing, close enough
+    char payload[128];
+    snprintf(payload, sizeof(payload), "{\"percent\":%u,\"received\":%lu,\"written\":%lu,\"kbps\":%lu}",
+             total > 0 ? (unsigned)min((uint64_t)100, (uint64_t)state.received * 100 / total) : 0,
+             (unsigned long)state.received, (unsigned long)state.written, (unsigned long)(state.received / elapsed));
+    progressEvents->send(payload, "update_progress", now);
+}
+
+// verify the SHA-256 and commit
+static void finish() {
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&state.sha, digest);
+    mbedtls_sha256_free(&state.sha);
+    freeBuffers();
+    if (state.gzip && !state.inflated) {
+        state.active = false;                           // Hash context is already freed
+        Update.abort();
+        fail(400, "Truncated gzip data");
+        return;
+    }
+    if (memcmp(digest, state.expected, sizeof(digest)) != 0) {
+        state.active = false;
+        Update.abort();
+        fail(400, "SHA-256 mismatch");
+        return;
+    }
+    state.active = false;
+    if (!Update.end(true)) {                            // true to set the size to the current progress
+        Update.printError(Serial);
+        fail(500, Update.errorString());
+        return;
+    }
+    state.ok = true;
+    state.httpCode = 200;
+    updatesDone++;
+    lastResult = "ok";
+    debugf("🆙 Update Success: %lu bytes received, %lu written\n", (unsigned long)state.received, (unsigned long)state.written);
+}
+
+// upload handler, called per received chunk
+static void handleUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
+    uint32_t start = micros();
+    if (index == 0 && !beginUpdate(request, filename, data, len)) {
+        return;
+    }
+    if (state.owner != request || !state.active) {     // Failed before, or a second upload meanwhile
+        return;
+    }
+    state.received += len;
+    feed(data, len);
+    if (state.active && final) {
+        finish();
+    }
+    lastReceived = state.received;
+    lastWritten = state.written;
+    lastDurationMs = millis() - state.startMs;
+    sendProgress(request, final || !state.active);
+    metricsObserve(HIST_HTTP_UPDATE, micros() - start);                         // Per uploaded chunk (inflate, hash, flash write)
+}
+
+// register POST /update
+void fwUpdateBegin(AsyncWebServer &server, AsyncEventSource &events) {
+    progressEvents = &events;
+    server.on("/update", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (state.owner != request) {
+            request->send(400, "text/plain", "No image uploaded");
+        } else if (!state.ok) {
+            if (state.active) {                         // Upload ended without a final chunk
+                fail(400, "Incomplete upload");
+            }
+            request->send(state.httpCode, "text/plain", state.error);
+        } else {
+            debugln("🆙 Update Done, restarting...");
+            request->onDisconnect([](){ ESP.restart(); });    // Restart once the response is out
+            request->send(200, "text/plain", "Update Done, restarting...");
+        }
+    }, handleUpload);
+}
+
+// add result, duration and throughput of the last update
+void fwUpdateStats(JsonDocument &sys) {
+    sys["update_last_result"] = lastResult;
+    sys["update_last_received"] = lastReceived;
+    sys["update_last_written"] = lastWritten;
+    sys["update_last_ms"] = lastDurationMs;
+    sys["update_last_kbps"] = lastDurationMs > 0 ? lastReceived / lastDurationMs : 0;
+    sys["update_done"] = updatesDone;
+    sys["update_failed"] = updatesFailed;
+}
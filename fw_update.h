@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// ======================================================================
+// Firmware and filesystem update
+// ======================================================================
+// POST /update?sha256=<hex>[&target=filesystem] with the image as
+// multipart file. The image may be gzip-compressed (detected by its
+// magic bytes); it is inflated while it streams in, through one fixed
+// 32 KB window, so it never has to fit in RAM. The SHA-256 of the
+// inflated image (what ends up in flash) is checked before Update.end()
+// commits, a mismatch aborts and the old firmware keeps booting.
+// Progress and throughput are pushed as "update_progress" events.
+//
+//   gzip -9 -k firmware.bin
+//   curl -F "image=@firmware.bin.gz" "http://aldo-mopro.local/update?sha256=$(sha256sum firmware.bin | cut -c1-64)"
+//
+// A filesystem image overwrites LittleFS in place: a failed check leaves
+// it unusable (formatted on the next start), the web UI is embedded in
+// the firmware and keeps working.
+
+#define FW_UPDATE_PROGRESS_MS 1000                      // Push progress at most once per second
+#define FW_UPDATE_GZIP_HEADER_MAX 256                   // Longest gzip header accepted (with file name)
+
+void fwUpdateBegin(AsyncWebServer &server, AsyncEventSource &events);   // Register POST /update
+void fwUpdateStats(JsonDocument &sys);                  // Add result, duration and throughput of the last update
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ======================================================================
+// Hardware abstraction
+// ======================================================================
+// Thin link-time HAL: the portable logic (alarm, config, sensor state
+// machine, history, outbox) only calls these functions. hal_esp32.cpp
+// implements them on the board, native/hal_native.cpp on Linux with a
+// simulated DS18B20, an in-memory filesystem and a virtual clock.
+
+// Clock
+uint32_t halMillis();                                   // Milliseconds since start
+uint32_t halMicros();                                   // Microseconds since start (wraps after 71 minutes)
+uint32_t halEpoch();                                    // Seconds since 1970, 0 while the clock is not set (SNTP)
+void halDelay(uint32_t ms);                             // Wait (advances the virtual clock on native)
+
+// DS18B20 sensor bus
+uint8_t halSensorBegin(uint8_t resolution);             // Start the bus without waiting for conversions, returns the number of sensors
+bool halSensorAddress(uint8_t index, uint8_t address[8]);   // ROM address of a sensor (enumerates the bus, call once)
+void halSensorSetResolution(uint8_t resolution);        // Set resolution of all sensors
+uint32_t halSensorConversionMs(uint8_t resolution);     // Nominal conversion time
+void halSensorRequest();                                // Start a conversion on all sensors (broadcast, returns immediately)
+bool halSensorComplete();                               // True when the conversion is complete
+bool halSensorRead(const uint8_t address[8], float &tempC); // Read one sensor by address, false if disconnected
+
+// GPIO
+void halPinWrite(uint8_t pin, bool level);              // Set an output pin
+bool halPinRead(uint8_t pin);                           // Read an input pin
+
+// Filesystem
+bool halFileExists(const char *path);                   // True if the file exists
+size_t halFileRead(const char *path, char *buffer, size_t maxLen);          // Read a whole file, returns the bytes read
+size_t halFileWrite(const char *path, const char *data, size_t len);        // Create/overwrite a file, returns the bytes written
+bool halFileRename(const char *from, const char *to);   // Atomically replace "to" with "from"
+bool halFileRemove(const char *path);                   // Delete a file
+size_t halFileSize(const char *path);                   // Size of a file, 0 if it does not exist
+size_t halFileReadAt(const char *path, size_t offset, char *buffer, size_t maxLen);    // Read from an offset, returns the bytes read
+size_t halFileAppend(const char *path, const char *data, size_t len);       // Append in one write (creates the file), returns the bytes written
+bool halDirCreate(const char *path);                    // Create a directory, true if it exists afterwards
+bool halDirList(const char *path, void (*visit)(const char *name, void *context), void *context);   // Call visit with the name of every entry, false if not a directory
+
+// HTTP
+int halHttpPost(const char *url);                       // POST to url (connection is reused), returns the HTTP response code
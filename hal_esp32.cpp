@@ -0,0 +1,187 @@
+#ifdef ARDUINO
+
+#include "hal.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <OneWire.h>
+#include <DallasTemperature.h>
+
+#define ONE_WIRE_BUS 4                                  // GPIO 4
+
+static OneWire oneWire(ONE_WIRE_BUS);                   // Setup a oneWire instance to communicate with any OneWire devices (not just Maxim/Dallas temperature ICs)
+static DallasTemperature sensors(&oneWire);             // Pass our oneWire reference to Dallas Temperature.
+
+// ======================================================================
+// Clock
+// ======================================================================
+
+uint32_t halMillis() {
+    return millis();
+}
+
+uint32_t halMicros() {
+    return micros();
+}
+
+uint32_t halEpoch() {
+    time_t now = time(nullptr);
+    return now > 1600000000 ? (uint32_t)now : 0;        // Below: not set by SNTP yet
+}
+
+void halDelay(uint32_t ms) {
+    delay(ms);
+}
+
+// ======================================================================
+// DS18B20 sensor bus
+// ======================================================================
+
+uint8_t halSensorBegin(uint8_t resolution) {
+    sensors.begin();                                    // Start up the library
+    sensors.setWaitForConversion(false);                // requestTemperatures() returns immediately
+    sensors.setResolution(resolution);
+    return sensors.getDeviceCount();
+}
+
+bool halSensorAddress(uint8_t index, uint8_t address[8]) {
+    return sensors.getAddress(address, index);
+}
+
+void halSensorSetResolution(uint8_t resolution) {
+    sensors.setResolution(resolution);
+}
+
+uint32_t halSensorConversionMs(uint8_t resolution) {
+    return sensors.millisToWaitForConversion(resolution);
+}
+
+void halSensorRequest() {
+    sensors.requestTemperatures();                      // Skip ROM: one conversion for all sensors
+}
+
+bool halSensorComplete() {
+    return sensors.isConversionComplete();
+}
+
+bool halSensorRead(const uint8_t address[8], float &tempC) {
+    tempC = sensors.getTempC(address);                  // Match ROM: no bus search
+    return tempC != DEVICE_DISCONNECTED_C;
+}
+
+// ======================================================================
+// GPIO
+// ======================================================================
+
+void halPinWrite(uint8_t pin, bool level) {
+    digitalWrite(pin, level ? HIGH : LOW);
+}
+
+bool halPinRead(uint8_t pin) {
+    return digitalRead(pin) == HIGH;
+}
+
+// ======================================================================
+// Filesystem (LittleFS)
+// ======================================================================
+
+bool halFileExists(const char *path) {
+    return LittleFS.exists(path);
+}
+
+size_t halFileRead(const char *path, char *buffer, size_t maxLen) {
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return 0;
+    }
+    size_t len = file.read((uint8_t *)buffer, maxLen);
+    file.close();
+    return len;
+}
+
+size_t halFileWrite(const char *path, const char *data, size_t len) {
+    File file = LittleFS.open(path, "w");
+    if (!file) {
+        return 0;
+    }
+    size_t written = file.write((const uint8_t *)data, len);
+    file.close();
+    return written;
+}
+
+bool halFileRename(const char *from, const char *to) {
+    return LittleFS.rename(from, to);                   // LittleFS replaces an existing target atomically
+}
+
+bool halFileRemove(const char *path) {
+    return LittleFS.exists(path) && LittleFS.remove(path);
+}
+
+size_t halFileSize(const char *path) {
+    File file = LittleFS.open(path, "r");
+    size_t size = file ? file.size() : 0;
+    file.close();
+    return size;
+}
+
+size_t halFileReadAt(const char *path, size_t offset, char *buffer, size_t maxLen) {
+    File file = LittleFS.open(path, "r");
+    size_t len = file && file.seek(offset) ? file.read((uint8_t *)buffer, maxLen) : 0;
+    file.close();
+    return len;
+}
+
+size_t halFileAppend(const char *path, const char *data, size_t len) {
+    File file = LittleFS.open(path, "a");
+    size_t written = file ? file.write((const uint8_t *)data, len) : 0;
+    file.close();
+    return written;
+}
+
+bool halDirCreate(const char *path) {
+    return LittleFS.exists(path) || LittleFS.mkdir(path);
+}
+
+bool halDirList(const char *path, void (*visit)(const char *name, void *context), void *context) {
+    File dir = LittleFS.open(path);
+    if (!dir || !dir.isDirectory()) {
+        return false;
+    }
+    File file = dir.openNextFile();
+    while (file) {
+        visit(file.name(), context);                    // Name without the directory
+        file.close();
+        file = dir.openNextFile();
+    }
+    dir.close();
+    return true;
+}
+
+// ======================================================================
+// HTTP
+// ======================================================================
+
+int halHttpPost(const char *url) {
+    static WiFiClientSecure secureClient;               // Kept between requests -> TLS session is reused
+    static WiFiClient plainClient;
+    static HTTPClient http;
+    static bool initialized = false;
+    if (!initialized) {
+        secureClient.setInsecure();                     // CallMeBot certificate is not pinned
+        http.setReuse(true);                            // Keep-alive to the endpoint
+        initialized = true;
+    }
+
+    bool tls = strncmp(url, "https://", 8) == 0;
+    if (!http.begin(tls ? (WiFiClient &)secureClient : plainClient, url)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    http.addHeader("Content-Type", "application/x-www-form-urlencoded");    // Specify content-type header
+    int httpResponseCode = http.POST("");                                  // Send HTTP POST request
+    http.end();                                                             // Keeps the connection open (setReuse)
+    return httpResponseCode;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include "heap_watch.h"
+#include <esp_heap_caps.h>
+#include "debug.h"
+
+// One hour of samples, the worst value of each
+struct HeapSlot {
+    uint32_t freeMin;                                   // Lowest free heap
+    uint32_t minFree;                                   // Lowest free heap since boot at the end of the hour
+    uint32_t largestMin;                                // Smallest largest allocatable block
+    uint8_t fragmentationMin;                           // Lowest fragmentation in %: above the limit all hour long
+};
+
+static TimerHandle_t timer = nullptr;                   // Sampling timer (timer service task)
+static portMUX_TYPE heapMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Written by the timer task only, read by loop() under heapMux
+static HeapSlot slots[HEAP_WATCH_SLOTS];                // Completed hours, ring
+static uint8_t slotNext = 0;                            // Next slot to write
+static uint8_t slotCount = 0;                           // Completed hours in the ring
+static HeapSlot current;                                // Hour in progress
+static uint8_t currentSamples = 0;                      // Samples in the hour in progress
+static uint8_t fragmentation = 0;                       // Latest sample in %
+static uint32_t largestLowest = UINT32_MAX;             // Smallest largest block since boot
+static int32_t largestTrend = 0;                        // Bytes per day, 0 until HEAP_WATCH_MIN_SLOTS hours
+static bool warning = false;                            // Trend or fragmentation above the limits
+
+// least-squares slope of the hourly largest block in bytes per day
+static int32_t trendPerDay() {
+    if (slotCount < HEAP_WATCH_MIN_SLOTS) {
+        return 0;
+    }
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (uint8_t i = 0; i < slotCount; i++) {           // Oldest first, x in hours
+        const HeapSlot &slot = slots[(slotNext + HEAP_WATCH_SLOTS - slotCount + i) % HEAP_WATCH_SLOTS];
+        sx += i;
+        sy += slot.largestMin;
+        sxx += (double)i * i;
+        sxy += (double)i * slot.largestMin;
+    }
+    double denominator = slotCount * sxx - sx * sx;
+    return (int32_t)((slotCount * sxy - sx * sy) / denominator * 24);
+}
+
+// timer callback: one sample, closes the hour after HEAP_WATCH_SAMPLES_PER_SLOT
+static void sample(TimerHandle_t) {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t minFree = ESP.getMinFreeHeap();
+    uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    uint8_t percent = freeHeap > 0 && largest < freeHeap ? 100 - (uint64_t)largest * 100 / freeHeap : 0;
+
+    HeapSlot hour = current;
+    if (currentSamples == 0) {
+        hour = { freeHeap, minFree, largest, percent };
+    }
+    hour.freeMin = min(hour.freeMin, freeHeap);
+    hour.minFree = minFree;
+    hour.largestMin = min(hour.largestMin, largest);
+    hour.fragmentationMin = min(hour.fragmentationMin, percent);
+    bool closed = currentSamples + 1 >= HEAP_WATCH_SAMPLES_PER_SLOT;
+
+    portENTER_CRITICAL(&heapMux);
+    current = hour;
+    currentSamples = closed ? 0 : currentSamples + 1;
+    fragmentation = percent;
+    largestLowest = min(largestLowest, largest);
+    if (closed) {
+        slots[slotNext] = hour;
+        slotNext = (slotNext + 1) % HEAP_WATCH_SLOTS;
+        slotCount = min<uint8_t>(slotCount + 1, HEAP_WATCH_SLOTS);
+    }
+    portEXIT_CRITICAL(&heapMux);
+
+    if (!closed) {
+        return;
+    }
+    int32_t trend = trendPerDay();
+    bool warn = trend < -HEAP_WATCH_DECLINE_WARN || hour.fragmentationMin > HEAP_WATCH_FRAGMENTATION_WARN;
+    portENTER_CRITICAL(&heapMux);
+    largestTrend = trend;
+    warning = warn;
+    portEXIT_CRITICAL(&heapMux);
+
+    if (warn) {
+        debugf("⚠️ Heap fragmentation: largest block %u bytes (%+ld bytes/day), %u%% of %u bytes free not allocatable\n",
+               (unsigned)hour.largestMin, (long)trend, hour.fragmentationMin, (unsigned)hour.freeMin);
+    }
+}
+
+// first sample, start the sampling timer
+void heapWatchBegin() {
+    sample(nullptr);
+    timer = xTimerCreate("Heap Watch", pdMS_TO_TICKS(HEAP_WATCH_SAMPLE_MS), pdTRUE, nullptr, sample);
+    if (timer == nullptr || xTimerStart(timer, 0) != pdPASS) {
+        debugln("❌ Failed to start the heap watchdog");
+    }
+}
+
+// add fragmentation, trend and the hourly history (oldest first)
+void heapWatchStats(JsonDocument &sys) {
+    HeapSlot history[HEAP_WATCH_SLOTS];
+    portENTER_CRITICAL(&heapMux);                       // Copy only, no allocation inside
+    uint8_t count = slotCount;
+    for (uint8_t i = 0; i < count; i++) {
+        history[i] = slots[(slotNext + HEAP_WATCH_SLOTS - count + i) % HEAP_WATCH_SLOTS];
+    }
+    uint8_t percent = fragmentation;
+    uint32_t lowest = largestLowest;
+    int32_t trend = largestTrend;
+    bool warn = warning;
+    portEXIT_CRITICAL(&heapMux);
+
+    sys["heap_fragmentation"] = percent;
+    sys["heap_largest_block_lowest"] = lowest;
+    sys["heap_largest_block_trend"] = trend;            // Bytes per day
+    sys["heap_fragmentation_warning"] = warn;
+    JsonArray freeHeap = sys["heap_history_free"].to<JsonArray>();
+    JsonArray minFree = sys["heap_history_min_free"].to<JsonArray>();
+    JsonArray largest = sys["heap_history_largest_block"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+        freeHeap.add(history[i].freeMin);
+        minFree.add(history[i].minFree);
+        largest.add(history[i].largestMin);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Heap watchdog
+// ======================================================================
+// A timer samples the free heap, the lowest free heap since boot and the
+// largest allocatable block once a minute and keeps the lowest values of
+// each hour for the last day. A largest block that keeps shrinking hour
+// after hour means fragmentation (or a leak): the watchdog fits a line
+// through the hourly values and warns when the block loses more than
+// HEAP_WATCH_DECLINE_WARN bytes a day or most of the free heap is no
+// longer allocatable in one piece.
+
+#define HEAP_WATCH_SAMPLE_MS 60000                      // Sample once a minute
+#define HEAP_WATCH_SAMPLES_PER_SLOT 60                  // One history slot per hour
+#define HEAP_WATCH_SLOTS 24                             // History of the last 24 hours
+#define HEAP_WATCH_MIN_SLOTS 6                          // Trend needs at least 6 hours
+#define HEAP_WATCH_DECLINE_WARN 2048                    // Largest block shrinking by more than 2 KiB a day
+#define HEAP_WATCH_FRAGMENTATION_WARN 50                // % of the free heap not allocatable as one block
+
+void heapWatchBegin();                                  // First sample, start the sampling timer
+void heapWatchStats(JsonDocument &sys);                 // Add fragmentation, trend and the hourly history
@@ -0,0 +1,443 @@
+#include "history.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal.h"
+#include "debug.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <memory>
+#include "metrics.h"
+#include "response_format.h"
+static portMUX_TYPE historyMux = portMUX_INITIALIZER_UNLOCKED;
+static void historyLock() { portENTER_CRITICAL(&historyMux); }
+static void historyUnlock() { portEXIT_CRITICAL(&historyMux); }
+#else
+#define metricsObserve(histogram, us)                   // No /metrics on native
+static void historyLock() {}                            // Native build is single threaded
+static void historyUnlock() {}
+#endif
+
+#define HISTORY_CSV_RECORD_MAX 24                       // Longest CSV line: "4294967295,-3276.8\n"
+#define HISTORY_READ_BLOCK 32                           // Samples read from flash per file access
+#define HISTORY_MSGPACK_RECORD 9                        // [uint32 ts, int16 temp]: fixarray, 0xce + 4, 0xd1 + 2
+#define HISTORY_MSGPACK_HEADER 5                        // array 32: 0xdd + 4 byte length
+
+// ======================================================================
+// RAM ring
+// ======================================================================
+
+static HistorySample ring[HISTORY_RAM_SAMPLES];         // Fixed RAM ring, no heap allocation
+static uint32_t ringTotal = 0;                          // Sequence number of the next sample
+static uint32_t ringFlushed = 0;                        // All samples below this sequence number are on flash
+static uint32_t lastTs = 0;                             // Timestamp of the newest sample
+static uint32_t timeBase = 0;                           // Timestamp base while the clock is not set
+static uint32_t segFirst = 0;                           // Oldest segment number on flash
+static uint32_t segLast = 0;                            // Newest segment number on flash
+static bool fsReady = false;                            // True if the history directory is usable
+
+// build the path of a segment file
+static void segmentPath(char *path, size_t len, uint32_t segment) {
+    snprintf(path, len, HISTORY_DIR "/%08lu.bin", (unsigned long)segment);
+}
+
+// current timestamp, continues from the last stored sample while the clock is not set
+static uint32_t historyNow() {
+    uint32_t now = halEpoch();
+    if (now != 0) {                                     // Clock has been set (e.g. SNTP)
+        return now;
+    }
+    return timeBase + halMillis() / 1000;
+}
+
+// Oldest and newest segment number found in the directory
+struct SegmentRange {
+    uint32_t first;
+    uint32_t last;
+    bool found;
+};
+
+// find the segment files on LittleFS
+void historyBegin() {
+    ringTotal = ringFlushed = 0;
+    lastTs = timeBase = 0;
+    segFirst = segLast = 0;
+    fsReady = false;
+
+    if (!halDirCreate(HISTORY_DIR)) {
+        debugln("❌ History: Failed to create " HISTORY_DIR);
+        return;
+    }
+
+    SegmentRange range = {};
+    bool listed = halDirList(HISTORY_DIR, [](const char *name, void *context) {
+        SegmentRange &r = *(SegmentRange *)context;
+        uint32_t segment = strtoul(name, nullptr, 10);
+        if (!r.found || segment < r.first) { r.first = segment; }
+        if (!r.found || segment > r.last) { r.last = segment; }
+        r.found = true;
+    }, &range);
+    if (!listed) {
+        debugln("❌ History: Failed to open " HISTORY_DIR);
+        return;
+    }
+    segFirst = range.first;
+    segLast = range.last;
+
+    if (range.found) {                                  // Continue timestamps after the newest stored sample
+        char path[32];
+        segmentPath(path, sizeof(path), segLast);
+        size_t records = halFileSize(path) / sizeof(HistorySample);
+        HistorySample sample;
+        if (records > 0 && halFileReadAt(path, (records - 1) * sizeof(HistorySample), (char *)&sample, sizeof(sample)) == sizeof(sample)) {
+            lastTs = sample.ts;
+            timeBase = sample.ts + 1;
+        }
+    }
+
+    fsReady = true;
+    debugf("✅ History: segments %lu..%lu (last sample at %lu)\n", (unsigned long)segFirst, (unsigned long)segLast, (unsigned long)lastTs);
+}
+
+// add a sample to the RAM ring
+void historyAdd(float tempC) {
+    historyAddAt(0, tempC);
+}
+
+// add a sample taken earlier, ts = 0 means now
+void historyAddAt(uint32_t ts, float tempC) {
+    HistorySample sample;
+    long temp = lroundf(tempC * 10);
+    sample.temp = (int16_t)(temp < -32768 ? -32768 : (temp > 32767 ? 32767 : temp));
+    sample.ts = ts != 0 ? ts : historyNow();            // time() takes a lock, not inside the critical section
+
+    historyLock();
+    if (sample.ts <= lastTs) {                          // Keep timestamps strictly increasing
+        sample.ts = lastTs + 1;
+    }
+    lastTs = sample.ts;
+    ring[ringTotal % HISTORY_RAM_SAMPLES] = sample;
+    ringTotal++;
+    if (ringTotal - ringFlushed > HISTORY_RAM_SAMPLES) {  // Oldest unflushed sample has been overwritten
+        ringFlushed = ringTotal - HISTORY_RAM_SAMPLES;
+    }
+    historyUnlock();
+}
+
+// timestamp of the newest sample
+uint32_t historyLastTimestamp() {
+    historyLock();
+    uint32_t ts = lastTs;
+    historyUnlock();
+    return ts;
+}
+
+// true if enough unflushed samples are waiting
+bool historyNeedsFlush() {
+    return fsReady && (ringTotal - ringFlushed) >= HISTORY_FLUSH_SAMPLES;
+}
+
+// append unflushed samples to the current segment file
+void historyFlush() {
+    if (!fsReady) {
+        return;
+    }
+
+    HistorySample block[HISTORY_FLUSH_SAMPLES];
+    uint32_t start = halMicros();
+    bool wrote = false;
+
+    while (true) {
+        uint32_t first;
+        size_t count = 0;
+
+        historyLock();
+        first = ringFlushed;
+        while (count < HISTORY_FLUSH_SAMPLES && first + count < ringTotal) {
+            block[count] = ring[(first + count) % HISTORY_RAM_SAMPLES];
+            count++;
+        }
+        historyUnlock();
+
+        if (count == 0) {
+            break;
+        }
+
+        char path[32];
+        segmentPath(path, sizeof(path), segLast);
+        size_t size = halFileSize(path);
+        if (size % sizeof(HistorySample) != 0 || size / sizeof(HistorySample) >= HISTORY_SEGMENT_SAMPLES) {
+            segLast++;                                  // Segment full or torn by a power cut -> start a new one
+            segmentPath(path, sizeof(path), segLast);
+        }
+
+        while (segLast - segFirst + 1 > HISTORY_SEGMENTS) {    // Drop the oldest segment
+            char oldest[32];
+            segmentPath(oldest, sizeof(oldest), segFirst);
+            halFileRemove(oldest);
+            segFirst++;
+        }
+
+        size_t bytes = count * sizeof(HistorySample);
+        if (halFileAppend(path, (const char *)block, bytes) != bytes) {
+            debugf("❌ History: Failed to write %s\n", path);
+            break;
+        }
+
+        wrote = true;
+
+        historyLock();
+        if (ringFlushed == first) {                     // Unless the ring overflowed meanwhile
+            ringFlushed = first + count;
+        }
+        historyUnlock();
+    }
+
+    if (wrote) {
+        metricsObserve(HIST_FLASH_WRITE, halMicros() - start);
+        debugf("💾 History flushed to segment %lu (%lu µs)\n", (unsigned long)segLast, (unsigned long)(halMicros() - start));
+    }
+}
+
+// ======================================================================
+// Streaming export
+// ======================================================================
+
+// write one record, returns the number of bytes written
+static size_t writeRecord(HistoryCursor &c, uint32_t ts, int16_t temp, uint8_t *buffer) {
+    if (c.format == HISTORY_MSGPACK && c.records >= c.total) {  // Never more than announced
+        return 0;
+    }
+    c.records++;
+    if (c.format == HISTORY_BIN) {
+        HistorySample sample = { ts, temp };
+        memcpy(buffer, &sample, sizeof(sample));
+        return sizeof(sample);
+    }
+    if (c.format == HISTORY_MSGPACK) {                  // One [ts, temp] array per sample, big endian
+        const uint8_t record[HISTORY_MSGPACK_RECORD] = { 0x92, 0xce, (uint8_t)(ts >> 24), (uint8_t)(ts >> 16), (uint8_t)(ts >> 8),
+                                                         (uint8_t)ts, 0xd1, (uint8_t)((uint16_t)temp >> 8), (uint8_t)temp };
+        memcpy(buffer, record, sizeof(record));
+        return sizeof(record);
+    }
+    int whole = abs(temp) / 10;
+    int tenth = abs(temp) % 10;
+    return snprintf((char *)buffer, HISTORY_CSV_RECORD_MAX, "%lu,%s%d.%d\n", (unsigned long)ts, temp < 0 ? "-" : "", whole, tenth);
+}
+
+// feed one sample through range filter and downsampling, returns the number of bytes written
+static size_t consumeSample(HistoryCursor &c, const HistorySample &sample, uint8_t *buffer) {
+    if (c.started && sample.ts <= c.lastTs) {           // Already exported from flash
+        return 0;
+    }
+    c.started = true;
+    c.lastTs = sample.ts;
+
+    if (sample.ts < c.from) {
+        return 0;
+    }
+    if (sample.ts > c.to) {
+        c.phase = PHASE_FINAL;
+        return 0;
+    }
+    if (c.step == 0) {
+        return writeRecord(c, sample.ts, sample.temp, buffer);
+    }
+
+    size_t len = 0;
+    uint32_t bucket = sample.ts - sample.ts % c.step;
+    if (c.count > 0 && bucket != c.bucket) {            // Bucket complete -> emit its mean
+        len = writeRecord(c, c.bucket, (int16_t)(c.sum / c.count), buffer);
+        c.sum = 0;
+        c.count = 0;
+    }
+    c.bucket = bucket;
+    c.sum += sample.temp;
+    c.count++;
+    return len;
+}
+
+// fill the next chunk, returns 0 when the export is complete, HISTORY_TRY_AGAIN if not even a record fits
+size_t historyExportChunk(HistoryCursor &c, uint8_t *buffer, size_t maxLen) {
+    size_t len = 0;
+
+    if (c.format == HISTORY_CSV && !c.header) {
+        static const char header[] = "timestamp,temp_c\n";
+        if (maxLen < sizeof(header) - 1) {
+            return HISTORY_TRY_AGAIN;
+        }
+        memcpy(buffer, header, sizeof(header) - 1);
+        len = sizeof(header) - 1;
+        c.header = true;
+    } else if (c.format == HISTORY_MSGPACK && !c.header) {
+        if (maxLen < HISTORY_MSGPACK_HEADER) {
+            return HISTORY_TRY_AGAIN;
+        }
+        const uint8_t header[HISTORY_MSGPACK_HEADER] = { 0xdd, (uint8_t)(c.total >> 24), (uint8_t)(c.total >> 16),
+                                                         (uint8_t)(c.total >> 8), (uint8_t)c.total };
+        memcpy(buffer, header, sizeof(header));
+        len = sizeof(header);
+        c.header = true;
+    }
+
+    while (c.phase != PHASE_DONE && maxLen - len >= HISTORY_CSV_RECORD_MAX) {
+
+        if (c.phase == PHASE_FLASH) {
+            if (c.segment > c.segmentEnd) {
+                c.phase = PHASE_RAM;
+                historyLock();
+                c.seq = ringTotal > HISTORY_RAM_SAMPLES ? ringTotal - HISTORY_RAM_SAMPLES : 0;
+                historyUnlock();
+                continue;
+            }
+
+            HistorySample block[HISTORY_READ_BLOCK];
+            size_t wanted = (maxLen - len) / HISTORY_CSV_RECORD_MAX;
+            if (wanted > HISTORY_READ_BLOCK) {
+                wanted = HISTORY_READ_BLOCK;
+            }
+
+            char path[32];
+            segmentPath(path, sizeof(path), c.segment);
+            size_t records = halFileReadAt(path, c.offset, (char *)block, wanted * sizeof(HistorySample)) / sizeof(HistorySample);
+
+            if (records == 0) {                         // End of segment (or deleted by rotation)
+                c.segment++;
+                c.offset = 0;
+                continue;
+            }
+            c.offset += records * sizeof(HistorySample);
+
+            for (size_t i = 0; i < records && c.phase == PHASE_FLASH; i++) {
+                len += consumeSample(c, block[i], buffer + len);
+            }
+
+        } else if (c.phase == PHASE_RAM) {
+            HistorySample sample;
+            bool available = false;
+
+            historyLock();
+            if (ringTotal - c.seq > HISTORY_RAM_SAMPLES) {     // Overwritten meanwhile, those are on flash
+                c.seq = ringTotal - HISTORY_RAM_SAMPLES;
+            }
+            if (c.seq < ringTotal) {
+                sample = ring[c.seq % HISTORY_RAM_SAMPLES];
+                c.seq++;
+                available = true;
+            }
+            historyUnlock();
+
+            if (!available) {
+                c.phase = PHASE_FINAL;
+                continue;
+            }
+            len += consumeSample(c, sample, buffer + len);
+
+        } else {                                        // PHASE_FINAL: emit the last incomplete bucket
+            if (c.count > 0) {
+                len += writeRecord(c, c.bucket, (int16_t)(c.sum / c.count), buffer + len);
+                c.count = 0;
+                continue;
+            }
+            if (c.format == HISTORY_MSGPACK && c.records < c.total) {   // Samples rotated away meanwhile, pad with nil
+                buffer[len++] = 0xc0;
+                c.records++;
+                continue;
+            }
+            c.phase = PHASE_DONE;
+        }
+    }
+
+    if (len == 0 && c.phase != PHASE_DONE) {            // Window smaller than a record, 0 would end the response
+        return HISTORY_TRY_AGAIN;
+    }
+    return len;
+}
+
+// number of records an export will produce, a dry run of a copy of the cursor (the MessagePack array length)
+static uint32_t countRecords(HistoryCursor c) {
+    uint8_t scratch[HISTORY_READ_BLOCK * HISTORY_CSV_RECORD_MAX];
+    c.format = HISTORY_BIN;
+    while (c.phase != PHASE_DONE) {
+        historyExportChunk(c, scratch, sizeof(scratch));
+    }
+    return c.records;
+}
+
+// prepare an export of [from, to] in buckets of step seconds (0 = raw samples)
+void historyExportBegin(HistoryCursor &c, HistoryFormat format, uint32_t from, uint32_t to, uint32_t step) {
+    c = HistoryCursor();
+    c.format = format;
+    c.from = from;
+    c.to = to;
+    c.step = step < HISTORY_STEP_MAX ? step : HISTORY_STEP_MAX;    // At most the time span kept on flash
+
+    historyLock();
+    c.segment = segFirst;
+    c.segmentEnd = segLast;
+    bool ready = fsReady;
+    historyUnlock();
+
+    if (!ready) {                                       // Nothing on flash, RAM ring only
+        c.segment = 1;
+        c.segmentEnd = 0;
+    }
+
+    // Skip segments that end before the requested range
+    for (uint32_t segment = c.segmentEnd; ready && c.from > 0 && segment > c.segment; segment--) {
+        char path[32];
+        segmentPath(path, sizeof(path), segment);
+        HistorySample first;
+        bool valid = halFileReadAt(path, 0, (char *)&first, sizeof(first)) == sizeof(first);
+        if (valid && first.ts <= c.from) {
+            c.segment = segment;
+            break;
+        }
+    }
+
+    if (c.format == HISTORY_MSGPACK) {                  // One array, its length goes first
+        uint32_t last = historyLastTimestamp();
+        if (c.to > last) {                              // Samples added meanwhile are not counted
+            c.to = last;
+        }
+        c.total = countRecords(c);
+    }
+}
+
+#ifdef ARDUINO
+
+// Names and content types per HistoryFormat
+static const char *const formatNames[] = { "csv", "bin", "msgpack" };
+static const char *const contentTypes[] = { "text/csv", "application/octet-stream", FORMAT_MSGPACK_TYPE };
+
+// stream /history?fmt=csv|bin|msgpack&from=<ts>&to=<ts>&step=<seconds> (Accept: application/msgpack as well)
+void historyStream(AsyncWebServerRequest *request) {
+    auto cursor = std::make_shared<HistoryCursor>();
+
+    HistoryFormat format = HISTORY_CSV;
+    const char *fmt = request->hasParam("fmt") ? request->getParam("fmt")->value().c_str() : nullptr;
+    const char *accept = request->hasHeader("Accept") ? request->header("Accept").c_str() : nullptr;
+    if (fmt != nullptr && strcmp(fmt, "bin") == 0) {
+        format = HISTORY_BIN;
+    } else if (responseFormat(fmt, accept) == FORMAT_MSGPACK) {
+        format = HISTORY_MSGPACK;
+    }
+    uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), nullptr, 10) : 0;
+    uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), nullptr, 10) : UINT32_MAX;
+    uint32_t step = request->hasParam("step") ? strtoul(request->getParam("step")->value().c_str(), nullptr, 10) : 0;
+    historyExportBegin(*cursor, format, from, to, step);
+
+    debugf("📬 /history from %lu to %lu step %lu (%s)\n", (unsigned long)cursor->from, (unsigned long)cursor->to, (unsigned long)cursor->step, formatNames[cursor->format]);
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse(contentTypes[cursor->format],
+        [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            size_t len = historyExportChunk(*cursor, buffer, maxLen);
+            return len == HISTORY_TRY_AGAIN ? RESPONSE_TRY_AGAIN : len;
+        });
+    request->send(response);
+}
+
+#endif
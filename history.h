@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class AsyncWebServerRequest;
+
+// ======================================================================
+// Temperature history
+// ======================================================================
+// Samples are kept in a fixed RAM ring and flushed in batches to
+// append-only segment files (/history/<n>.bin) on LittleFS. A segment
+// holds one day of 10 second samples, the oldest segment is deleted once
+// HISTORY_SEGMENTS are on flash, so a week always fits. Flash and clock
+// go through hal.h, historyStream() is the only board-specific part.
+
+#define HISTORY_DIR "/history"                          // Directory for the segment files
+#define HISTORY_RAM_SAMPLES 360                         // RAM ring size (1 hour of 10 second samples)
+#define HISTORY_FLUSH_SAMPLES 60                        // Flush to flash every 60 samples (10 minutes)
+#define HISTORY_SEGMENT_SAMPLES 8640                    // Samples per segment file (1 day of 10 second samples)
+#define HISTORY_SEGMENTS 8                              // Segment files kept on flash (7 days + current)
+#define HISTORY_STEP_MAX (HISTORY_SEGMENTS * 86400UL)   // Largest /history?step= in seconds
+#define HISTORY_TRY_AGAIN ((size_t)-1)                  // historyExportChunk(): no room for a record, call again
+
+// Compact history sample: 6 bytes on flash and in RAM
+struct __attribute__((packed)) HistorySample {
+    uint32_t ts;                                        // Timestamp in seconds (epoch when the clock is set)
+    int16_t temp;                                       // Temperature in 1/10 °C
+};
+
+enum HistoryPhase : uint8_t { PHASE_FLASH, PHASE_RAM, PHASE_FINAL, PHASE_DONE };
+enum HistoryFormat : uint8_t { HISTORY_CSV, HISTORY_BIN, HISTORY_MSGPACK };
+
+// State of a running export, fields are private to history.cpp
+struct HistoryCursor {
+    uint32_t from = 0;                                  // First timestamp to export
+    uint32_t to = UINT32_MAX;                           // Last timestamp to export
+    uint32_t step = 0;                                  // Downsampling bucket in seconds (0 = raw samples)
+    HistoryFormat format = HISTORY_CSV;                 // CSV, packed HistorySample records or one MessagePack array
+    bool header = false;                                // CSV header or MessagePack array length sent
+    uint32_t records = 0;                               // Records written
+    uint32_t total = 0;                                 // MessagePack: array length announced in the header
+    HistoryPhase phase = PHASE_FLASH;
+    uint32_t segment = 0;                               // Current segment file
+    uint32_t segmentEnd = 0;                            // Last segment file to read
+    size_t offset = 0;                                  // Read offset in the current segment file
+    uint32_t seq = 0;                                   // Next RAM ring sequence number
+    uint32_t lastTs = 0;                                // Newest timestamp consumed (skips samples seen twice)
+    bool started = false;                               // At least one sample consumed
+    uint32_t bucket = 0;                                // Current downsampling bucket
+    int32_t sum = 0;                                    // Sum of temperatures in the current bucket
+    uint32_t count = 0;                                 // Samples in the current bucket
+};
+
+void historyBegin();                                    // Find segment files and start with an empty RAM ring, must be called after mounting
+void historyAdd(float tempC);                           // Add a sample to the RAM ring (safe from timer task)
+void historyAddAt(uint32_t ts, float tempC);            // Add a sample taken earlier (e.g. kept in RTC memory)
+uint32_t historyLastTimestamp();                        // Timestamp of the newest sample (RAM or flash)
+bool historyNeedsFlush();                               // True if enough unflushed samples are waiting
+void historyFlush();                                    // Append unflushed samples to the current segment file
+void historyExportBegin(HistoryCursor &c, HistoryFormat format, uint32_t from, uint32_t to, uint32_t step);    // Prepare an export of [from, to]
+size_t historyExportChunk(HistoryCursor &c, uint8_t *buffer, size_t maxLen);   // Next chunk, 0 when complete, HISTORY_TRY_AGAIN if not even a record fits
+void historyStream(AsyncWebServerRequest *request);     // Stream /history as chunked CSV, binary or MessagePack (board only)
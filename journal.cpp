@@ -0,0 +1,479 @@
+#include "journal.h"
+#include <LittleFS.h>
+#include <memory>
+#include "sensor.h"
+#include "probes.h"
+#include "metrics.h"
+#include "debug.h"
+
+#define JOURNAL_EPISODES_FILE JOURNAL_DIR "/episodes.bin"
+#define JOURNAL_DAYS_FILE JOURNAL_DIR "/days.bin"
+#define JOURNAL_STATE_FILE JOURNAL_DIR "/state.bin"
+#define JOURNAL_STATE_TMP_FILE JOURNAL_DIR "/state.tmp"
+#define JOURNAL_STATE_MAGIC 0x4A53                      // "JS", changes with the layout of JournalState
+#define JOURNAL_CLOCK_VALID 1600000000                  // time() above this has been set (e.g. SNTP)
+#define JOURNAL_CSV_LINE_MAX 112                        // Longest CSV line (episode with a 15 character name)
+#define JOURNAL_READ_BLOCK 16                           // Records read from flash per file access
+
+enum JournalType : uint8_t { JOURNAL_START = 1, JOURNAL_END = 2 };
+
+// Episode record, 16 bytes
+struct __attribute__((packed)) JournalEpisode {
+    uint8_t type;                                       // JOURNAL_START or JOURNAL_END
+    uint8_t probe;                                      // Sensor index
+    int16_t threshold;                                  // 1/10 °C
+    int16_t peak;                                       // Highest reading in 1/10 °C (START: first reading)
+    uint16_t notifications;                             // Notifications queued (START: 0)
+    uint32_t start;                                     // time(), 0 = clock was not set
+    uint32_t end;                                       // time(), START: 0
+};
+
+// Daily aggregate of one sensor, 22 bytes
+struct __attribute__((packed)) JournalDay {
+    uint32_t day;                                       // Local date as YYYYMMDD, 0 = empty
+    uint8_t probe;
+    uint8_t reserved;
+    uint16_t samples;
+    int32_t sum;                                        // Sum of the readings in 1/10 °C
+    int16_t min;
+    int16_t max;
+    uint32_t secondsAbove;                              // Time above the threshold
+    uint16_t episodes;                                  // Episodes started that day
+};
+
+// Running state per sensor, checkpointed to flash
+struct JournalProbe {
+    JournalDay today;                                   // Running day
+    JournalEpisode open;                                // Open episode (type JOURNAL_START), type 0 = none
+    uint32_t lastTs;                                    // time() of the previous sample (time above threshold)
+    bool lastAbove;                                     // Previous sample was above the threshold
+};
+
+struct JournalState {
+    uint16_t magic;
+    uint16_t count;                                     // Entries in probes[]
+    JournalProbe probes[SENSOR_MAX];
+};
+
+static JournalState state;
+static uint32_t openMs[SENSOR_MAX];                     // millis() at the start of an episode while the clock was not set
+static bool dirty = false;                              // Running day changed since the last checkpoint
+static uint32_t checkpointMs = 0;
+static bool fsReady = false;
+static uint32_t episodesWritten = 0;                    // Statistics
+static uint32_t daysWritten = 0;
+static uint32_t writeErrors = 0;
+static portMUX_TYPE journalMux = portMUX_INITIALIZER_UNLOCKED;
+
+// current time() or 0 if the clock was not set
+static uint32_t clockNow() {
+    time_t now = time(nullptr);
+    return now > JOURNAL_CLOCK_VALID ? (uint32_t)now : 0;
+}
+
+// local date of a timestamp as YYYYMMDD
+static uint32_t localDay(uint32_t ts) {
+    time_t t = ts;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+}
+
+// append a record, rotating the file to <path>.old when it gets too big
+static bool appendRecord(const char *path, const void *record, size_t len) {
+    if (!fsReady) {
+        return false;
+    }
+    uint32_t start = micros();
+    File file = LittleFS.open(path, "a");
+    if (file && file.size() >= JOURNAL_FILE_MAX) {
+        file.close();
+        char old[40];
+        snprintf(old, sizeof(old), "%s.old", path);
+        LittleFS.remove(old);
+        LittleFS.rename(path, old);
+        file = LittleFS.open(path, "a");
+    }
+    bool ok = file && file.write((const uint8_t *)record, len) == len;
+    file.close();
+    if (!ok) {
+        writeErrors++;
+        debugf("❌ Journal: Failed to write %s\n", path);
+    }
+    metricsObserve(HIST_FLASH_WRITE, micros() - start);
+    return ok;
+}
+
+// start an empty day
+static void resetDay(JournalDay &day, uint8_t probe, uint32_t key) {
+    memset(&day, 0, sizeof(day));
+    day.day = key;
+    day.probe = probe;
+    day.min = INT16_MAX;
+    day.max = INT16_MIN;
+}
+
+// save the running days and open episodes (temp file + rename)
+static void checkpoint() {
+    if (!fsReady) {
+        return;
+    }
+    JournalState copy;
+    portENTER_CRITICAL(&journalMux);
+    copy = state;
+    portEXIT_CRITICAL(&journalMux);
+
+    uint32_t start = micros();
+    File file = LittleFS.open(JOURNAL_STATE_TMP_FILE, "w");
+    bool ok = file && file.write((const uint8_t *)&copy, sizeof(copy)) == sizeof(copy);
+    file.close();
+    if (!ok || !LittleFS.rename(JOURNAL_STATE_TMP_FILE, JOURNAL_STATE_FILE)) {
+        writeErrors++;
+        debugln("❌ Journal: Failed to write " JOURNAL_STATE_FILE);
+    }
+    metricsObserve(HIST_FLASH_WRITE, micros() - start);
+    dirty = false;
+    checkpointMs = millis();
+}
+
+// restore the running days and open episodes
+void journalBegin() {
+    memset(&state, 0, sizeof(state));
+    state.magic = JOURNAL_STATE_MAGIC;
+    state.count = SENSOR_MAX;
+    for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+        resetDay(state.probes[i].today, i, 0);
+    }
+
+    if (!LittleFS.exists(JOURNAL_DIR) && !LittleFS.mkdir(JOURNAL_DIR)) {
+        debugln("❌ Journal: Failed to create " JOURNAL_DIR);
+        return;
+    }
+    fsReady = true;
+
+    JournalState saved;
+    File file = LittleFS.open(JOURNAL_STATE_FILE, "r");
+    bool valid = file && file.read((uint8_t *)&saved, sizeof(saved)) == sizeof(saved) &&
+                 saved.magic == JOURNAL_STATE_MAGIC && saved.count == SENSOR_MAX;
+    file.close();
+    uint8_t open = 0;
+    if (valid) {                                        // A past day is written out with its first new sample
+        state = saved;
+        for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+            open += state.probes[i].open.type == JOURNAL_START;
+        }
+    }
+    checkpointMs = millis();
+    debugf("✅ Journal: %s, %u open episodes\n", valid ? "state restored" : "new state", open);
+}
+
+// per sensor and sample: episodes and the running day
+void journalSample(uint8_t probe, int16_t temp, int16_t threshold, bool alarm) {
+    if (probe >= SENSOR_MAX) {
+        return;
+    }
+    JournalProbe &p = state.probes[probe];
+    uint32_t now = clockNow();
+    JournalEpisode record;
+    bool started = false, ended = false;
+    JournalDay finished;
+    bool dayDone = false;
+
+    portENTER_CRITICAL(&journalMux);
+    if (alarm && p.open.type != JOURNAL_START) {        // Episode starts
+        memset(&p.open, 0, sizeof(p.open));
+        p.open.type = JOURNAL_START;
+        p.open.probe = probe;
+        p.open.threshold = threshold;
+        p.open.peak = temp;
+        p.open.start = now;
+        openMs[probe] = millis();
+        record = p.open;
+        started = true;
+    } else if (alarm) {
+        if (temp > p.open.peak) { p.open.peak = temp; }
+    } else if (p.open.type == JOURNAL_START) {          // Episode ends
+        record = p.open;
+        record.type = JOURNAL_END;
+        record.end = now;
+        if (record.start == 0 && now != 0) {            // Clock was set during the episode
+            record.start = now - (millis() - openMs[probe]) / 1000;
+        }
+        p.open.type = 0;
+        ended = true;
+    }
+
+    if (now != 0) {                                     // Days need the clock
+        uint32_t key = localDay(now);
+        if (p.today.day != key) {
+            if (p.today.day != 0 && p.today.samples > 0) {
+                finished = p.today;
+                dayDone = true;
+            }
+            resetDay(p.today, probe, key);
+        }
+        if (p.lastAbove && p.lastTs != 0 && now > p.lastTs) {   // Interval since the previous sample above the threshold
+            p.today.secondsAbove += now - p.lastTs < JOURNAL_MAX_GAP_S ? now - p.lastTs : JOURNAL_MAX_GAP_S;
+        }
+        p.today.samples++;
+        p.today.sum += temp;
+        if (temp < p.today.min) { p.today.min = temp; }
+        if (temp > p.today.max) { p.today.max = temp; }
+        p.today.episodes += started;
+        p.lastTs = now;
+        p.lastAbove = temp > threshold;
+    }
+    portEXIT_CRITICAL(&journalMux);
+    dirty = true;
+
+    if (dayDone && appendRecord(JOURNAL_DAYS_FILE, &finished, sizeof(finished))) {
+        daysWritten++;
+    }
+    if ((started || ended) && appendRecord(JOURNAL_EPISODES_FILE, &record, sizeof(record))) {
+        episodesWritten++;
+    }
+    if (started || ended || dayDone) {                  // Keep the open episodes in sync with the journal
+        checkpoint();
+    }
+}
+
+// count notifications queued for an open episode
+void journalNotified(int probe, uint8_t count) {
+    portENTER_CRITICAL(&journalMux);
+    for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+        if ((probe == JOURNAL_ALL_PROBES || probe == i) && state.probes[i].open.type == JOURNAL_START) {
+            state.probes[i].open.notifications += count;
+        }
+    }
+    portEXIT_CRITICAL(&journalMux);
+    dirty = true;
+}
+
+// checkpoint the running day
+void journalLoop() {
+    if (dirty && millis() - checkpointMs >= JOURNAL_CHECKPOINT_MS) {
+        checkpoint();
+    }
+}
+
+// checkpoint now
+void journalCommitNow() {
+    if (dirty) {
+        checkpoint();
+    }
+}
+
+// ======================================================================
+// Streaming report
+// ======================================================================
+
+enum ReportPhase : uint8_t { REPORT_OLD, REPORT_CURRENT, REPORT_RAM, REPORT_DONE };
+
+// State of a running /report response, lives as long as the response
+struct ReportCursor {
+    bool episodes = false;                              // Episodes or daily aggregates
+    uint32_t from = 0;                                  // First local day (YYYYMMDD)
+    uint32_t to = UINT32_MAX;                           // Last local day
+    bool header = false;                                // CSV header sent
+    ReportPhase phase = REPORT_OLD;
+    size_t offset = 0;                                  // Read offset in the current file
+    uint8_t probe = 0;                                  // Next sensor in REPORT_RAM
+    JournalState ram;                                   // Running days and open episodes when the report started
+};
+
+// format 1/10 °C
+static int formatTenths(char *buffer, size_t len, int32_t tenths) {
+    return snprintf(buffer, len, "%s%ld.%ld", tenths < 0 ? "-" : "", (long)(labs(tenths) / 10), (long)(labs(tenths) % 10));
+}
+
+// format a timestamp as local time
+static int formatTime(char *buffer, size_t len, uint32_t ts) {
+    if (ts == 0) {                                      // Clock was not set / still open
+        buffer[0] = '\0';
+        return 0;
+    }
+    time_t t = ts;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return strftime(buffer, len, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+// sensor name for the report (index if it has no name)
+static void probeName(uint8_t index, char *name, size_t len) {
+    Probe probe;
+    if (probesGet(index, probe) && probe.name[0] != '\0') {
+        strlcpy(name, probe.name, len);
+        for (char *c = name; *c; c++) {
+            if (*c == ',' || *c == '"') { *c = ' '; }   // Keep the CSV columns
+        }
+    } else {
+        snprintf(name, len, "%u", index + 1);
+    }
+}
+
+// write one daily aggregate line
+static size_t writeDay(const ReportCursor &c, const JournalDay &day, char *buffer) {
+    if (day.day < c.from || day.day > c.to || day.samples == 0) {
+        return 0;
+    }
+    char name[PROBE_NAME_LEN], mean[12], minT[12], maxT[12];
+    probeName(day.probe, name, sizeof(name));
+    formatTenths(mean, sizeof(mean), (day.sum + (day.sum >= 0 ? day.samples / 2 : -(int32_t)day.samples / 2)) / (int32_t)day.samples);
+    formatTenths(minT, sizeof(minT), day.min);
+    formatTenths(maxT, sizeof(maxT), day.max);
+    return snprintf(buffer, JOURNAL_CSV_LINE_MAX, "%04lu-%02lu-%02lu,%s,%u,%s,%s,%s,%lu.%lu,%u\n",
+                    (unsigned long)(day.day / 10000), (unsigned long)(day.day / 100 % 100), (unsigned long)(day.day % 100),
+                    name, day.samples, mean, minT, maxT,
+                    (unsigned long)(day.secondsAbove / 60), (unsigned long)(day.secondsAbove % 60 / 6), day.episodes);
+}
+
+// write one episode line (END records and open episodes)
+static size_t writeEpisode(const ReportCursor &c, const JournalEpisode &episode, uint32_t now, char *buffer) {
+    uint32_t ts = episode.start != 0 ? episode.start : episode.end;
+    if (ts == 0 || localDay(ts) < c.from || localDay(ts) > c.to) {
+        return 0;
+    }
+    char name[PROBE_NAME_LEN], start[24], end[24], threshold[12], peak[12];
+    probeName(episode.probe, name, sizeof(name));
+    formatTime(start, sizeof(start), episode.start);
+    formatTime(end, sizeof(end), episode.end);
+    formatTenths(threshold, sizeof(threshold), episode.threshold);
+    formatTenths(peak, sizeof(peak), episode.peak);
+    uint32_t until = episode.end != 0 ? episode.end : now;
+    uint32_t duration = episode.start != 0 && until >= episode.start ? until - episode.start : 0;
+    return snprintf(buffer, JOURNAL_CSV_LINE_MAX, "%s,%s,%s,%s,%s,%lu.%lu,%u\n", start, end, name, threshold, peak,
+                    (unsigned long)(duration / 60), (unsigned long)(duration % 60 / 6), episode.notifications);
+}
+
+// fill the next chunk, returns 0 when the report is complete, RESPONSE_TRY_AGAIN if not even a line fits
+static size_t fillReport(ReportCursor &c, uint8_t *buffer, size_t maxLen) {
+    size_t len = 0;
+
+    if (!c.header) {
+        const char *header = c.episodes ? "start,end,sensor,threshold_c,peak_c,duration_min,notifications\n"
+                                        : "date,sensor,samples,mean_c,min_c,max_c,minutes_above,episodes\n";
+        size_t headerLen = strlen(header);
+        if (headerLen > maxLen) {
+            return RESPONSE_TRY_AGAIN;
+        }
+        memcpy(buffer, header, headerLen);
+        len = headerLen;
+        c.header = true;
+    }
+
+    while (c.phase != REPORT_DONE && maxLen - len >= JOURNAL_CSV_LINE_MAX) {
+
+        if (c.phase == REPORT_OLD || c.phase == REPORT_CURRENT) {
+            char path[40];
+            snprintf(path, sizeof(path), "%s%s", c.episodes ? JOURNAL_EPISODES_FILE : JOURNAL_DAYS_FILE, c.phase == REPORT_OLD ? ".old" : "");
+            size_t recordSize = c.episodes ? sizeof(JournalEpisode) : sizeof(JournalDay);
+            size_t wanted = min((size_t)JOURNAL_READ_BLOCK, (maxLen - len) / JOURNAL_CSV_LINE_MAX);
+            uint8_t block[JOURNAL_READ_BLOCK * sizeof(JournalDay)];
+            size_t records = 0;
+
+            File file = LittleFS.open(path, "r");
+            if (file && file.seek(c.offset)) {
+                records = file.read(block, wanted * recordSize) / recordSize;
+            }
+            file.close();
+
+            if (records == 0) {                         // End of file (or rotated meanwhile)
+                c.phase = c.phase == REPORT_OLD ? REPORT_CURRENT : REPORT_RAM;
+                c.offset = 0;
+                continue;
+            }
+            c.offset += records * recordSize;
+
+            for (size_t i = 0; i < records; i++) {
+                if (c.episodes) {
+                    JournalEpisode episode;
+                    memcpy(&episode, block + i * recordSize, sizeof(episode));
+                    if (episode.type == JOURNAL_END) {
+                        len += writeEpisode(c, episode, 0, (char *)buffer + len);
+                    }
+                } else {
+                    JournalDay day;
+                    memcpy(&day, block + i * recordSize, sizeof(day));
+                    len += writeDay(c, day, (char *)buffer + len);
+                }
+            }
+
+        } else {                                        // REPORT_RAM: running days or open episodes
+            if (c.probe >= SENSOR_MAX) {
+                c.phase = REPORT_DONE;
+                continue;
+            }
+            const JournalProbe &p = c.ram.probes[c.probe];
+            if (c.episodes && p.open.type == JOURNAL_START) {
+                len += writeEpisode(c, p.open, clockNow(), (char *)buffer + len);
+            } else if (!c.episodes) {
+                len += writeDay(c, p.today, (char *)buffer + len);
+            }
+            c.probe++;
+        }
+    }
+
+    if (len == 0 && c.phase != REPORT_DONE) {           // Window smaller than a line, 0 would end the response
+        return RESPONSE_TRY_AGAIN;
+    }
+    return len;
+}
+
+// parse YYYY-MM-DD or YYYY-MM into a YYYYMMDD range
+static bool parsePeriod(const String &value, uint32_t &from, uint32_t &to) {
+    unsigned year, month, day;
+    if (sscanf(value.c_str(), "%4u-%2u-%2u", &year, &month, &day) == 3) {
+        from = to = year * 10000 + month * 100 + day;
+        return true;
+    }
+    if (sscanf(value.c_str(), "%4u-%2u", &year, &month) == 2) {
+        from = year * 10000 + month * 100 + 1;
+        to = year * 10000 + month * 100 + 31;
+        return true;
+    }
+    return false;
+}
+
+// stream /report?day=YYYY-MM-DD|month=YYYY-MM&type=days|episodes
+void journalReport(AsyncWebServerRequest *request) {
+    auto cursor = std::make_shared<ReportCursor>();
+
+    if (request->hasParam("type")) { cursor->episodes = request->getParam("type")->value() == "episodes"; }
+    bool valid = true;
+    if (request->hasParam("day")) {
+        valid = parsePeriod(request->getParam("day")->value(), cursor->from, cursor->to);
+    } else if (request->hasParam("month")) {
+        valid = parsePeriod(request->getParam("month")->value(), cursor->from, cursor->to);
+    } else if (clockNow() != 0) {                       // Default: current month
+        cursor->from = localDay(clockNow()) / 100 * 100 + 1;
+        cursor->to = cursor->from + 30;
+    }
+    if (!valid) {
+        request->send(400, "text/plain", "Expected day=YYYY-MM-DD or month=YYYY-MM");
+        return;
+    }
+
+    portENTER_CRITICAL(&journalMux);
+    cursor->ram = state;
+    portEXIT_CRITICAL(&journalMux);
+
+    debugf("📬 /report %s from %lu to %lu\n", cursor->episodes ? "episodes" : "days", (unsigned long)cursor->from, (unsigned long)cursor->to);
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+        [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return fillReport(*cursor, buffer, maxLen);
+        });
+    request->send(response);
+}
+
+// add open episodes and journal writes
+void journalStats(JsonDocument &sys) {
+    uint8_t open = 0;
+    for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+        open += state.probes[i].open.type == JOURNAL_START;
+    }
+    sys["journal_open_episodes"] = open;
+    sys["journal_episodes_written"] = episodesWritten;
+    sys["journal_days_written"] = daysWritten;
+    sys["journal_write_errors"] = writeErrors;
+}
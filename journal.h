@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// ======================================================================
+// Alarm journal and daily report
+// ======================================================================
+// Every alarm episode of a sensor is appended to /journal/episodes.bin:
+// a START record when it begins (so an episode cut off by a power loss
+// still shows up) and an END record with start, end, peak and the
+// notifications queued for it. Per sensor and local day the number of
+// samples, sum, min/max and the time above the threshold are updated
+// with every sample and appended to /journal/days.bin when the day
+// changes. The running day and open episodes are checkpointed to
+// /journal/state.bin. /report streams either file as CSV block by block.
+// Day aggregates need the clock (SNTP); samples before it is set only
+// count for episodes.
+
+#define JOURNAL_DIR "/journal"                          // Directory of the journal files
+#define JOURNAL_FILE_MAX 65536                          // Rotate to <file>.old above 64 KB (years of episodes)
+#define JOURNAL_CHECKPOINT_MS 600000                    // Save the running day every 10 minutes
+#define JOURNAL_MAX_GAP_S 60                            // Longest sample gap counted as time above threshold
+#define JOURNAL_ALL_PROBES -1                           // journalNotified(): every open episode
+
+void journalBegin();                                    // Restore the running day and open episodes (after mounting LittleFS)
+void journalSample(uint8_t probe, int16_t temp, int16_t threshold, bool alarm);  // Per sensor and sample, 1/10 °C (loop task)
+void journalNotified(int probe, uint8_t count);         // Count notifications queued for an open episode
+void journalLoop();                                     // Checkpoint the running day
+void journalCommitNow();                                // Checkpoint now (before restart/sleep)
+void journalReport(AsyncWebServerRequest *request);     // Stream /report?day=YYYY-MM-DD|month=YYYY-MM&type=days|episodes
+void journalStats(JsonDocument &sys);                   // Add open episodes and journal writes
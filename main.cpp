@@ -7,48 +7,58 @@
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoOTA.h>
-#include <Update.h>
-#include <HTTPClient.h>
-#include <UrlEncode.h>
-#include <OneWire.h>
-#include <DallasTemperature.h>
 #include <OneButton.h>
+#include <atomic>
+#include "debug.h"
+#include "history.h"
+#include "persist.h"
+#include "sensor.h"
+#include "notify.h"
+#include "alarm.h"
+#include "config_store.h"
+#include "config_schema.h"
+#include "wakeup.h"
+#include "web_assets.h"
+#include "snapshot.h"
+#include "rtc_state.h"
+#include "probes.h"
+#include "metrics.h"
+#include "trend.h"
+#include "wifi_manager.h"
+#include "fw_update.h"
+#include "journal.h"
+#include "spsc_ring.h"
+#include "heap_watch.h"
+#include "sampling.h"
+#include "mqtt.h"
+#include "rules.h"
  
 
 #define PIN_ALARM_OUTPUT 32                             // IO32 for LED green
 #define PIN_CONFIG_MODE_INPUT  25                       // IO25 for Alarm input
-#define ONE_WIRE_BUS 4                                  // GPIO 4
 
 #define VERSION "0.9.5"                                 // Software Version 
 #define OTA_PASSWORD "aldo"                             // OTA Update Password
+#define NTP_SERVER_1 "pool.ntp.org"                     // SNTP servers for the journal timestamps
+#define NTP_SERVER_2 "time.google.com"
 
-#define DEBUG_SERIAL true                               // Enable debbuging over serial interface
-#if DEBUG_SERIAL
-    #define debug(x) Serial.print(x)
-    #define debugf(x, ...) Serial.printf((x), ##__VA_ARGS__)
-    #define debugln(x) Serial.println(x)
-    #define debug_speed(x) Serial.begin(x)
-#else
-    #define debug(x)
-    #define debugf(x, ...)
-    #define debugln(x)
-    #define debug_speed(x) 
-#endif
+#define SENSING_CORE 1                                  // APP_CPU: sensing and alarm decisions, Wi-Fi/web/notify on PRO_CPU (0)
+#define SENSING_PRIORITY 5                              // Above loop() (1) and AsyncTCP (3)
+#define SENSING_STACK 4096
+#define SENSING_EVENTS 64                               // Ring between the sensing task and loop() (power of two)
 
 // ======================================================================
 // Setting parameters with default values
 // ======================================================================
 
-// JSON Dcuments to hold configuration and system parameters
-JsonDocument config;                                    // Create a JSON document to hold configuration parameters
+// Configuration and runtime values live in the typed AppConfig config (config_schema.h)
+// JSON Dcuments to hold system parameters
 JsonDocument sys;                                       // Create a JSON document to hold system parameters
-String configString;                                    // Create a String to hold JSON configuration parameters  
-String sysString;                                       // Create a String to hold JSON system parameters
+// /getdata and /getsys are served from versioned snapshots (snapshot.h)
 
 // Flags and States
 volatile bool led_state = false;                        // State of the LED
 volatile bool alarmtriggered = false;                   // Flag for alarmtriggered
-volatile bool tempTrigger = false;                      // Flag for new Temp available
 volatile bool enableNotifications = false;              // Enable WhatsApp Notifications     
 
 
@@ -57,43 +67,71 @@ volatile bool enableNotifications = false;              // Enable WhatsApp Notif
 // ======================================================================
 static TimerHandle_t Normal_Mode_timer = nullptr;       // Handle for LED blinking task, when in NORMAL Mode
 static TimerHandle_t No_WiFi_timer = nullptr;           // Handle for LED blinking task, when no WiFi connection
-static TimerHandle_t Temp_timer = nullptr;              // Handle for getting the Temp
-static TimerHandle_t Reminder_timer = nullptr;          // Handle for resetting the alarm
+static Trend trend;                                     // Regression window of FRIDGE_TEMP, owned by the sensing task
+static AlarmReminder reminder = {};                     // Reminder schedule of the alarm output, owned by the sensing task
+
+// What the sensing task decided, handled by loop() (journal, notifications, log)
+enum SensingEventType : uint8_t {
+    SENSING_PROBE,                                      // One sensor evaluated
+    SENSING_PRE_ALARM,                                  // Pre-alarm raised or cleared
+    SENSING_REMINDER,                                   // REMINDER minutes passed with the alarm out
+    SENSING_RULE                                        // Alarm rule raised, cleared or reminder due
+};
+
+struct SensingEvent {
+    SensingEventType type;
+    AlarmEvent event;                                   // Raised/cleared/none
+    uint8_t probe;                                      // Sensor index (SENSING_PROBE)
+    bool alarm;                                         // Sensor in alarm, SENSING_PRE_ALARM: any sensor in alarm
+    bool online;                                        // Reading succeeded
+    int16_t temp;                                       // 1/10 °C
+    int8_t threshold;                                   // Effective TARGET_TEMP in °C
+    int8_t hysteresis;                                  // Effective HYSTERESIS in °C
+    RuleEventType ruleEvent;                            // SENSING_RULE
+    uint8_t rule;                                       // Index of the rule definition (SENSING_RULE)
+    uint16_t ruleGeneration;                            // Rule table the index refers to (SENSING_RULE)
+    float trend;                                        // °C/min (SENSING_PRE_ALARM)
+    float eta;                                          // Minutes until TARGET_TEMP (SENSING_PRE_ALARM)
+};
+
+static SpscRing<SensingEvent, SENSING_EVENTS> sensingEvents;   // Sensing task -> loop(), lock-free
+static std::atomic<int> liveRSSI{0};                    // Copy of sys["RSSI"] for the async TCP task
 
 AsyncWebServer server(80);                              // Initialize WebServer
-HTTPClient http;                                        // Initialize HTTP Client  
-OneWire oneWire(ONE_WIRE_BUS);                          // Setup a oneWire instance to communicate with any OneWire devices (not just Maxim/Dallas temperature ICs)
-DallasTemperature sensors(&oneWire);                    // Pass our oneWire reference to Dallas Temperature.
+AsyncEventSource events("/events");                     // Initialize Server-Sent Events stream for live data
 OneButton button(PIN_CONFIG_MODE_INPUT, true, true);    // Initialize OneButton for CONFIG mode input pin
 
 
-// ======================================================================
-// Interrupts
-// ======================================================================
-
-
 // ======================================================================
 // Forward Declarations
 // ======================================================================
 void initESP(bool montFS = true);                           // Initialize ESP + gather system parameters
 
-void readConfig(JsonDocument &config);                      // Read configuration from filesystem
-void saveConfig(JsonDocument &config);                      // Save configuration to filesystem
-
-bool startWiFi_STA (bool staMode);                          // Start WiFi wether STA or in AP Mode
+bool startWiFi_AP();                                        // Start WiFi in AP Mode (CONFIG mode)
+void onWiFiConnected(bool first);                           // Station got an IP: LED, sys, web server/mDNS/OTA on the first connect
 void enableOTAUpdates();                                    // Enable OTA Updates
 void startWebServer();                                      // Start WebServer
+void pushLiveData(bool force = false);                      // Push changed live data to all event stream clients
+void buildData(JsonDocument &doc);                          // Public configuration + live values (no secrets)
+bool publishData();                                         // Publish a new /getdata snapshot
+bool publishSys();                                          // Publish a new /getsys snapshot
+void setRSSI(int rssi);                                     // Update sys["RSSI"] and the copy for the event stream (loop)
 
 TimerHandle_t createPeriodicTimer(const char* TimerName, uint32_t PeriodMS, TimerCallbackFunction_t CallbackFunction); // Create a periodic timer
+TimerHandle_t createOneShotTimer(const char* TimerName, uint32_t PeriodMS, TimerCallbackFunction_t CallbackFunction);  // Create a one-shot timer
 void blinkLED(TimerHandle_t xTimer);                        // Blink LED timer
-void getTemp(TimerHandle_t xTimer);                         // Get Temp timer
-void notificationReminder(TimerHandle_t xTimer);            // Sent remind notifications
+void getTemp();                                             // Get Temp and wait for the result (DEEP_SLEEP mode)
+void sensingTask(void *parameter);                          // Sample, evaluate the alarms and switch the output (NORMAL mode)
+void evaluateSample();                                      // Alarm decisions of one sample (sensing task)
+void handleSensingEvent(const SensingEvent &event);         // Journal, notifications and log of a decision (loop)
+void handleRuleEvent(const SensingEvent &event);            // Log and notification of an alarm rule (loop)
+void processTemp(float tempC);                              // Process a new temperature sample
+void notificationReminder();                                // Sent remind notifications
 
 void switchMode(String mode);                               // Switch the mode <CONFIG>, <CONFIG> or <DEEP_SLEEP>
 void switchToConfigMode();                                  // Switch to <CONFIG> mode
 
-void sendWhatsAppNotifications(String Notification);        // Function to send notifications via WhatsApp to all configured numbers
-void sendNotification(String Phone_Number, String API_Key, String Notification); // Function to send notifications via WhatsApp to a specific number
+int sendWhatsAppNotifications(const char *text);             // Function to queue notifications via WhatsApp to all configured numbers
 
 // ======================================================================
 // Setup
@@ -104,10 +142,24 @@ void setup() {
     debug_speed(115200);
     debugln("===SETUP_BEGIN===");
 
-    initESP(true);                                      // Initialize ESP + gather system parameters, true = mount filesystem
-    readConfig(config);                                 // Read configuration from filesystem
+    bool rtcSampled = rtcFastPath();                    // DEEP_SLEEP timer wake: sample + sleep, returns only if flash is needed
 
-    sensors.begin();                                    // Start up the library
+    initESP(true);                                      // Initialize ESP + gather system parameters, true = mount filesystem
+    configLoad(config, VERSION);                        // Read configuration from filesystem
+    persistBegin();                                     // Restore runtime values (MIN/MAX) from NVS
+    historyBegin();                                     // Find temperature history segments on filesystem
+    setenv("TZ", config.timezone, 1);                   // Local days for the journal, the RTC keeps the time across restarts
+    tzset();
+    journalBegin();                                     // Running day and open alarm episodes
+    rtcDrain();                                         // Samples and MIN/MAX of the DEEP_SLEEP fast wakes
+    wakeupBegin(strcmp(config.mode, "NORMAL") == 0);    // Event-driven loop, light sleep only with Wi-Fi STA
+    snapshotBegin();                                    // Versioned /getdata and /getsys responses
+    heapWatchBegin();                                   // Hourly free heap and largest block, fragmentation trend
+
+    sensorBegin(config.sensorResolution);               // Start up the sensors in non-blocking mode
+    probesBegin();                                      // Names and thresholds per sensor
+    rulesBegin();                                       // Additional alarm rules, compiled for the sensing task
+    trendReset(trend);                                  // Empty regression window for the pre-alarm
     
     pinMode(LED_BUILTIN, OUTPUT);                       // Initialize the BUILTIN_LED pin as an output
     pinMode(PIN_ALARM_OUTPUT, OUTPUT);                  // Set PIN_ALARM_OUTPUT as Output
@@ -116,48 +168,51 @@ void setup() {
     // Creating Timers
     Normal_Mode_timer = createPeriodicTimer("Normal Mode LED Timer", 500, blinkLED);     // Create LED timer, when in NORMAL mode
     No_WiFi_timer = createPeriodicTimer("No WiFi LED Timer", 200, blinkLED);             // Create LED timer, when no WiFi connection
-    Temp_timer = createPeriodicTimer("Temp Timer", 10000, getTemp);                      // Create timer for reading the temperature every 10 seconds
    
-    if(String(config["MODE"]) == "NORMAL") {
+    if(strcmp(config.mode, "NORMAL") == 0) {
         debugln("✅ Starting in <NORMAL> mode");
         button.attachLongPressStart(switchToConfigMode);    // Attach function to check CONFIG mode on long press
         button.setPressMs(5000);                            // Set long press time to 5 seconds
+        wakeupAttachButton(PIN_CONFIG_MODE_INPUT);          // Wake the loop on button edges, OneButton does the timing
 
-        xTimerStart(Temp_timer, 0);                         // Start Temp timer
-
-        if(startWiFi_STA(true)){
-            xTimerStart(Normal_Mode_timer, 0);              // Start Normal Mode LED blinking timer
-            enableOTAUpdates();                             // Enable OTA Updates
-            startWebServer();                               // Start WebServer
-        } else {
-            xTimerStart(No_WiFi_timer, 0);                  // Start No WiFi LED blinking timer
+        if(xTaskCreatePinnedToCore(sensingTask, "Sensing", SENSING_STACK, nullptr, SENSING_PRIORITY, nullptr, SENSING_CORE) != pdPASS) {  // First sample right away
+            debugln("❌ Failed to start the sensing task!");
         }
 
-    } else if(String(config["MODE"]) == "DEEP_SLEEP") {
-        int sleepInterval = config["DEEP_SLEEP_INTERVAL"].as<int>(); // Get DEEP SLEEP interval from config in microseconds
-        debugf("💤 Starting in <DEEP_SLEEP> mode - [Interval: %i minutes]\n", sleepInterval);
+        notifySetEndpoint(config.notifyUrl);                // Set notification endpoint
+        notifyBegin();                                      // Start notification dispatcher task
+
+        sys["SSID"] = config.wifiStaSsid;
+        wifiBegin(config.wifiStaSsid, config.wifiStaPw, config.hostname);  // Connects in the background, see loop()
+        xTimerStart(No_WiFi_timer, 0);                      // Until the station has an IP
+
+    } else if(strcmp(config.mode, "DEEP_SLEEP") == 0) {
+        debugf("💤 Starting in <DEEP_SLEEP> mode - [Interval: %i..%i minutes]\n", config.deepSleepMinInterval, config.deepSleepInterval);
         digitalWrite(LED_BUILTIN, LOW);                             // Turn the LED off to show <DEEP_SLEEP> mode
 
-        esp_sleep_enable_timer_wakeup(sleepInterval * 60 * 1000000);
-        
-        getTemp(nullptr);                                           // Get temperature before going to sleep
+        if(!rtcSampled) {
+            getTemp();                                              // Get temperature before going to sleep
+        }
+        historyFlush();                                             // RAM is lost in deep sleep -> write samples to flash
 
-        float fridge_temp = config["FRIDGE_TEMP"].as<float>();      // Get the temperature in °C
-        int target_temp = config["TARGET_TEMP"].as<int>();          // Get the temperature in °C
+        float fridge_temp = config.fridgeTemp;                      // Get the temperature in °C
+        int target_temp = config.targetTemp;                        // Get the temperature in °C
         
         if(fridge_temp > target_temp) {                             // If Fridge Temp is above Target Temp and alarm not yet triggered
-            config["MODE"] = "NORMAL";                              // Set MODE to NORMAL      
+            configApplyParam("MODE", "NORMAL");                     // Set MODE to NORMAL      
             debugf("⚠️ MODE changed form <DEEP_SLEEP> to <NORMAL>!");
-            saveConfig(config);                                     // Save configuration to filesystem
+            persistMarkDirty("MODE");
+            persistCommitNow();                                     // Save configuration to filesystem
             ESP.restart(); 
         } else {
-            esp_deep_sleep_start();
+            persistCommitNow();                                     // Save new MIN/MAX before going to sleep
+            rtcDeepSleep();                                         // Next wakes take the fast path
         }
 
     } else {
         debugln("⚙️  Starting in <CONFIG> mode!");
         
-        if(startWiFi_STA(false)){
+        if(startWiFi_AP()){
             digitalWrite(LED_BUILTIN, HIGH);                        // Turn the LED on to show <CONFIG> mode
             startWebServer();                                       // Start WebServer
         } else {
@@ -166,7 +221,10 @@ void setup() {
         }   
     }
 
-    debugf("✅ MODE: %s\n", String(config["MODE"])); 
+    debugf("✅ MODE: %s\n", config.mode); 
+
+    publishData();                                      // First versions for the web server
+    publishSys();
 
     debugln("===SETUP_END===");
 }
@@ -177,46 +235,65 @@ void setup() {
 
 void loop() {
 
+    static unsigned long lastRSSI = 0;
+    static bool dataPending = false;                                            // Snapshot publish skipped, retry
+    static bool sysPending = false;
+    uint32_t timeout = button.isIdle() ? WAKE_TICK_MS : WAKE_BUTTON_POLL_MS;   // Poll only while the button is in use
+    uint32_t wake = wakeupWait(timeout);                                        // Sleep until an event or the housekeeping tick
+    uint32_t iterationStart = micros();
+
     ArduinoOTA.handle();                                                        // Handle OTA updates
+    WifiEvent link = wifiLoop();                                                // Connect/reconnect in the background
+    if(link == WIFI_EVENT_UP) {
+        static bool connectedOnce = false;
+        onWiFiConnected(!connectedOnce);
+        connectedOnce = true;
+        sysPending = true;
+    } else if(link == WIFI_EVENT_DOWN) {
+        xTimerStop(Normal_Mode_timer, 0);                                       // Fast blinking until reconnected
+        xTimerStart(No_WiFi_timer, 0);
+        sysPending = true;
+    }
     button.tick();                                                              // Check if CONFIG mode should be started
 
-    sys["RSSI"] = WiFi.RSSI();
-
-    if(tempTrigger) {                                                           // If new Temp available
-        tempTrigger = false;                                                    // Set newTemp to false
-
-        float fridge_temp = config["FRIDGE_TEMP"].as<float>();                  // Get the temperature in °C
-        int target_temp = config["TARGET_TEMP"].as<int>();                      // Get the temperature in °C
-        int hysteresis = config["HYSTERESIS"].as<int>();                        // Get the temperature in °C
+    if(millis() - lastRSSI >= RSSI_INTERVAL_MS) {                               // Sample RSSI on a schedule, not every iteration
+        lastRSSI = millis();
+        setRSSI(WiFi.RSSI());
+        wake |= WAKE_LIVE;                                                      // Pushed only if it moved
+        sysPending = true;                                                      // Refresh /getsys with the RSSI
+    }
 
-        if(fridge_temp > target_temp && !config["ALARM"]) { // If Fridge Temp is above Target Temp and alarm not yet triggered
-            config["ALARM"] = true;                                             // Set ALARM to true       
-            digitalWrite(PIN_ALARM_OUTPUT, HIGH);
-            
-            debugf("🌡️ Fridge Temp %02.1f °C > Target Temp %i °C (ALARM: %s)\n", fridge_temp, target_temp, String(config["ALARM"] ? "true" : "false"));
-            sendWhatsAppNotifications(String("🌡️ ALARM: Aldo MoPro-Kühltheke - Temperatur: " + String(fridge_temp) + "°C (Schwellwert: " + String(target_temp) + "°C)!!")); // Send WhatsApp Notification to all configured numbers    
+    SensingEvent event;
+    while(sensingEvents.pop(event)) {                                           // Decisions of the sensing task, in order
+        handleSensingEvent(event);
+    }
+    if(wake & WAKE_SAMPLE) {                                                    // If new Temp available
+        wake |= WAKE_LIVE;                                                      // New sample -> push changed fields
+    }
 
-            if(Reminder_timer == nullptr) {
-                int timerReminderMinutes = int(config["REMINDER"])*60000;       // Get Reminder time from config
-                Reminder_timer = createPeriodicTimer("Reminder Timer", timerReminderMinutes, notificationReminder); // Create timer for re-sending notifications           
-                xTimerStart(Reminder_timer, 0);                                 // Start Reminder timer
-            }  
+    persistLoop();                                                              // Commit batched configuration/runtime changes
+    probesLoop();                                                               // Save changed sensor names/thresholds
+    rulesLoop();                                                                // Save changed alarm rules
+    journalLoop();                                                              // Checkpoint the running day
+    mqttLoop();                                                                 // Publish due batches and alarm transitions
 
-        } else if(fridge_temp < (target_temp - hysteresis) && config["ALARM"]) {                   // If Fridge Temp is below Target Temp - Hysteresis and alarm is triggered
-            config["ALARM"] = false;                                            // Set ALARM to false
-            digitalWrite(PIN_ALARM_OUTPUT, LOW);                                // Set PIN_ALARM_OUTPUT to LOW
+    if(historyNeedsFlush()) {                                                   // Write temperature history to flash in batches
+        historyFlush();
+    }
 
-            debugf("🌡️ Fridge Temp %02.1f °C < Target Temp %i °C - Hysteresis %i °C (ALARM: %s)!\n", fridge_temp, target_temp, hysteresis, String(config["ALARM"] ? "true" : "false"));
+    if(wake & WAKE_LIVE) {                                                      // If live data changed (new sample, alarm, reset, RSSI)
+        pushLiveData();                                                         // Push only changed fields to event stream clients
+        dataPending = true;
+    }
 
-            if(Reminder_timer != nullptr) {
-                xTimerStop(Reminder_timer, 0);                                  // Stop Reminder timer
-                xTimerDelete(Reminder_timer, 0);                                // Delete Reminder timer
-                Reminder_timer = nullptr;
-            }
-        } else {
-            debugf("🌡️ Fridge Temp %02.1f °C | Target Temp %i °C (ALARM: %s)\n", fridge_temp, target_temp, String(config["ALARM"] ? "true" : "false"));
-        }
-    }     
+    if(dataPending && snapshotRetryDue(SNAPSHOT_DATA)) {                        // Serialize once per change, not per request
+        dataPending = !publishData();
+    }
+    if(sysPending && snapshotRetryDue(SNAPSHOT_SYS)) {                          // Backs off while publishing fails
+        sysPending = !publishSys();
+    }
+    mqttHealth(sys);                                                            // Health subset to the broker, once a minute
+    metricsObserve(HIST_LOOP, micros() - iterationStart);
 }
 
 // ======================================================================
@@ -238,7 +315,7 @@ void initESP(bool mountFS) {
  
 
     debugln("+--------------------------------------------------------------------------");
-    debugf("| ChipModel:   %s (Rev.%d) with %d Core(s) and %d MHz\n", sys["chip_model"].as<String>(), sys["chip_revision"].as<int>(), sys["chip_cores"].as<int>(), sys["cpu_freq_mhz"].as<int>());
+    debugf("| ChipModel:   %s (Rev.%d) with %d Core(s) and %d MHz\n", sys["chip_model"].as<const char*>(), sys["chip_revision"].as<int>(), sys["chip_cores"].as<int>(), sys["cpu_freq_mhz"].as<int>());
     debugf("| SDK Version: %s\n", sys["sdk_version"].as<String>().c_str());
 
     // calculate RAM
@@ -271,124 +348,59 @@ void initESP(bool mountFS) {
     debugln("+--------------------------------------------------------------------------");
 }
 
-// Read Configuration from filesystem
-void readConfig(JsonDocument &config) {
-    config.clear();                                                              // Clear configuration JSON document
-    configString = "";                                                           // Clear configuration String
-
-    if(LittleFS.exists("/config.json")) {
-        File configFile = LittleFS.open("/config.json", "r");
-        if (configFile) {
-
-            DeserializationError error = deserializeJson(config, configFile);   // Deserialize the JSON document
-
-            config["VERSION"] = VERSION;                                        // Add version to config
-
-            serializeJson(config, configString);                                // convert JSON document to String  
-            debugf("✅ Configuration loaded -> %s\n", configString.c_str())  ;
-
-            if (error) { 
-                debugf("❌ DeserializeJson failed! -> %s\n", error.f_str());
-                return; 
-            } 
-        }
-        configFile.close();
-
-    } else {
-        debugln("❌ No configuration file found");
-    }
-}
-
-// Save Configuration to filesystem
-void saveConfig(JsonDocument &config) {
-    if(LittleFS.exists("/config.json")) {
-        File configFile = LittleFS.open("/config.json","w");
-        if(configFile) { 
-            if(serializeJsonPretty(config, configFile) == 0) {                  // Serialize the JSON document
-                debugln("❌ Failed to write to JSON file");
-            }else{
-                serializeJson(config, configString);                            // convert JSON document to String    
-                debugf("💾 Configuration saved -> %s\n", configString.c_str())  ;
-            }
-             
-        configFile.close();
-
-        } else {
-             debugln("❌ No configuration file found");
-        }
-    }
-} 
-
-// Start WiFi STA Mode
-bool startWiFi_STA (bool staMode) {
+// Start WiFi AP Mode
+bool startWiFi_AP() {
     
-    String hostname = String(config["HOSTNAME"]);
+    String hostname = String(config.hostname);
     WiFi.setHostname(hostname.c_str());
 
-    if (staMode){
-        String ssid_sta = String(config["WIFI_STA_SSID"]);
-        String sta_pw = String(config["WIFI_STA_PW"]);
-        sys["SSID"] = ssid_sta;
-        sys["WiFi_Mode"] = WiFi.getMode();
-
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(ssid_sta, sta_pw);
-
-        debugf("📶 Connecting WiFi STA with %s ", ssid_sta);
-
-        unsigned long startAttemptTime = millis();
-        while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < 15000) {
-            delay(500);
-            debug(".");
-        }
-
-        if (WiFi.status() == WL_CONNECTED) {
-            debugln("✅ WiFi connected!");
-            debugf("✅ IP: %s\n", WiFi.localIP().toString().c_str());
-            debugf("✅ Hostname: %s\n", hostname.c_str());
-            sys["RSSI"] = WiFi.RSSI();
-            sys["channel"] = WiFi.channel();
+    String ssid_ap = String(config.wifiApSsid);
+    sys["SSID"] = ssid_ap;
+    sys["WiFi_Mode"] = WiFi.getMode();
+    WiFi.mode(WIFI_AP);
+    debug("📶 Starting WiFi AP...");
+
+    if (WiFi.softAP(ssid_ap)) {
+        debugf("✅ WiFi AP: %s startet!\n", WiFi.softAPSSID().c_str());
+        debugf("✅ IP: %s\n", WiFi.softAPIP().toString().c_str());
+        debugf("✅ Hostname: %s\n", hostname.c_str());
+        setRSSI(WiFi.RSSI());
+        sys["channel"] = WiFi.channel();
+
+        if (MDNS.begin(hostname.c_str())) {
+            debugf("✅ mDNS: http://%s.local\n", hostname.c_str());
+        } else {
+            debugln("❌ Error setting up MDNS responder!");
+        } 
 
+        return true;
+    } else {
+        debugln("❌ Failed to start AP!");
+        return false;
+    }      
+}      
 
-            if (MDNS.begin(hostname.c_str())) {
-                debugf("✅ mDNS: http://%s.local\n", hostname.c_str());
-            } else {
-                debugln("❌ Error setting up MDNS responder!");
-            } 
-
-            return true;
-        } else {
-            debugln("\n❌ WiFi connection failed!");
-            return false;
-        }
+// Station got an IP (called from loop() by the connection manager)
+void onWiFiConnected(bool first) {
+    xTimerStop(No_WiFi_timer, 0);
+    xTimerStart(Normal_Mode_timer, 0);                  // Start Normal Mode LED blinking timer
+    sys["WiFi_Mode"] = WiFi.getMode();
+    setRSSI(WiFi.RSSI());
+    sys["channel"] = WiFi.channel();
 
+    if (!first) {                                       // Server, mDNS, OTA and SNTP keep running across reconnects
+        return;
+    }
+    configTzTime(config.timezone, NTP_SERVER_1, NTP_SERVER_2);  // Timestamps for the alarm journal
+    if (MDNS.begin(config.hostname)) {
+        debugf("✅ mDNS: http://%s.local\n", config.hostname);
     } else {
-        String ssid_ap = String(config["WIFI_AP_SSID"]);
-        sys["SSID"] = ssid_ap;
-        sys["WiFi_Mode"] = WiFi.getMode();
-        WiFi.mode(WIFI_AP);
-        debug("📶 Starting WiFi AP...");
-
-        if (WiFi.softAP(ssid_ap)) {
-            debugf("✅ WiFi AP: %s startet!\n", WiFi.softAPSSID().c_str());
-            debugf("✅ IP: %s\n", WiFi.softAPIP().toString().c_str());
-            debugf("✅ Hostname: %s\n", hostname.c_str());
-            sys["RSSI"] = WiFi.RSSI();
-            sys["channel"] = WiFi.channel();
-
-            if (MDNS.begin(hostname.c_str())) {
-                debugf("✅ mDNS: http://%s.local\n", hostname.c_str());
-            } else {
-                debugln("❌ Error setting up MDNS responder!");
-            } 
-
-            return true;
-        } else {
-            debugln("❌ Failed to start AP!");
-            return false;
-        }      
+        debugln("❌ Error setting up MDNS responder!");
     }
-}      
+    enableOTAUpdates();                                 // Enable OTA Updates
+    startWebServer();                                   // Start WebServer
+    mqttBegin();                                        // Telemetry to the broker in MQTT_HOST, reconnects on its own
+}
 
 // Start WebServer
 void startWebServer() { 
@@ -398,72 +410,21 @@ void startWebServer() {
         request->send(200, "text/plain", "Hello, world");
     });
 
-    // Make style.css available
-    server.on("/style.css", HTTP_GET, [](AsyncWebServerRequest *request){
-        request->send(LittleFS, "/style.css","text/css");
-    });
+    // Make the embedded web UI available (index.html, config.html, system.html, style.css, icons.svg, favicon)
+    webAssetsBegin(server);
 
-    // Make favicon.ico available
-    server.on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest *request){
-        debugln("✅ Requested /favicon.ico");
-        request->send(LittleFS, "/cold-32.png","image/png");
-    });
+    // Make counters and latency histograms available for Prometheus
+    metricsBegin(server);
 
-    // Make icons.svg available
-    server.on("/icons.svg", HTTP_GET, [](AsyncWebServerRequest *request){
-        debugln("✅ Requested /icons.svg");
-        request->send(LittleFS, "/icons.svg","image/svg+xml");
-    });
-
-    // Make index.html available
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        debugln("🌐 Requested index.html");
-        request->send(LittleFS, "/index.html", "text/html");
-    });
-
-    // Make config.html available
-    server.on("/config", HTTP_GET, [](AsyncWebServerRequest *request){
-        debugln("🌐 Requested config.html");
-        request->send(LittleFS, "/config.html", "text/html");
-    });
-
-
-    // Make system.html available
-    server.on("/system", HTTP_GET, [](AsyncWebServerRequest *request){
-         debugln("🌐 Requested system.html");
-        request->send(LittleFS, "/system.html", "text/html");
-    });
-
-    // 
-    server.on("/update", HTTP_POST, [](AsyncWebServerRequest *request){
-        debugln("🆙 Update Done, restarting...");
-        request->send(200, "text/plain", "Update Done, restarting...");
-        ESP.restart();
-    }, [](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final){
-        if(!index){
-            debugf("🆙 Update Start: %s\n", filename.c_str());
-            if(!Update.begin(UPDATE_SIZE_UNKNOWN)){ //start with max available size
-                Update.printError(Serial);
-            }
-        }
-        if(!Update.hasError()){
-            if(Update.write(data, len) != len){
-                Update.printError(Serial);
-            }
-        }
-        if(final){
-            if(Update.end(true)){ //true to set the size to the current progress
-                debugf("🆙 Update Success: %u bytes\n", index+len);
-            } else {
-                Update.printError(Serial);
-            }
-        }
-    });
+    // Accept (gzip-compressed) firmware and LittleFS images, verified by SHA-256
+    fwUpdateBegin(server, events);
  
     // Make configutation data available
     server.on("/getdata", HTTP_GET, [](AsyncWebServerRequest *request){      
                               
+        uint32_t start = micros();
         int paramsNr = request->params();
+        int changes = 0;                                                                            // Settings, not response options
         debugf("📬 /getdata with %i parameters: ", paramsNr);
         for(int i=0;i<paramsNr;i++){
             const AsyncWebParameter* p = request->getParam(i);   
@@ -472,43 +433,196 @@ void startWebServer() {
 
             debugf("%s:%s, ", name.c_str(), value.c_str());
 
-            if(name == "MODE" && value != String(config["MODE"])) {                                 // If MODE changed, set new MODE
+            if(name == "fmt" || name == "fields") {                                                 // Response format and key selection
+                continue;
+            }
+            changes++;
+
+            if(name == "MODE" && value != config.mode) {                                 // If MODE changed, set new MODE
                 switchMode(value); 
                 continue;
             }
 
-            if (config[name].is<bool>()) { config[name] = value == "true" ? true : false; }         // Convert "true"/"false" to boolean
-                else if (config[name].is<int>()) { config[name] = value.toInt(); }                  // Convert to integer
-                else if (config[name].is<float>()) { config[name] = value.toFloat(); }              // Convert to float
-                else { config[name] = p->value(); }                                                 // Else keep as string  
+            if (configApplyParam(name.c_str(), value.c_str())) {                                    // Convert to the type and range of the field
+                persistMarkDirty(name.c_str());                                                     // Committed later from loop()
+            } else if (!probesApplyParam(name.c_str(), value.c_str())) {                            // SENSOR_<n>_NAME/_TARGET/_HYSTERESIS, SENSORS_RESET
+                rulesApplyParam(name.c_str(), value.c_str());                                       // RULES=[...], saved from loop()
+            }
+
+            if(name == "NOTIFY_URL") {                                                              // Apply new notification endpoint
+                notifySetEndpoint(value.c_str());
+            }
+            if(name.startsWith("MQTT_")) {                                                          // Reconnect with the new broker settings
+                mqttReconfigure();
+            }
         }
 
         debugln("");
-        if (paramsNr > 0) {
-            saveConfig(config);                 // Save configuration to filesystem  
+        if (changes > 0) {
+            wakeupSignal(WAKE_LIVE);            // e.g. MIN/MAX reset -> push to event stream clients
+            if (!publishData()) {               // The response must show the new values right away
+                JsonDocument doc;               // Old version still sending -> private copy this once
+                buildData(doc);
+                snapshotSendDocument(request, doc);
+                metricsObserve(HIST_HTTP_GETDATA, micros() - start);
+                return;
+            }
         }
-            
-        serializeJson(config, configString);    // convert JSON document to String    
 
-        request->send(200, "application/json", configString);       
+        snapshotSend(request, SNAPSHOT_DATA);   // Published version or 304
+        metricsObserve(HIST_HTTP_GETDATA, micros() - start);
+    });
+
+    // Make temperature history available (chunked CSV, binary or MessagePack)
+    server.on("/history", HTTP_GET, [](AsyncWebServerRequest *request){
+        uint32_t start = micros();
+        historyStream(request);                                                 // Only the setup, chunks follow from the TCP task
+        metricsObserve(HIST_HTTP_HISTORY, micros() - start);
+    });
+
+    // Make the alarm journal available (daily aggregates or episodes as chunked CSV)
+    server.on("/report", HTTP_GET, [](AsyncWebServerRequest *request){
+        journalReport(request);                                                 // Only the setup, chunks follow from the TCP task
+    });
+
+    // Make alarm rules and their state available
+    server.on("/rules", HTTP_GET, [](AsyncWebServerRequest *request){
+        JsonDocument doc;
+        rulesToJson(doc);
+        snapshotSendDocument(request, doc);
     });
 
     // Make system data available
     server.on("/getsys", HTTP_GET, [](AsyncWebServerRequest *request){
-        serializeJson(sys, sysString); 
-        request->send(200, "application/json", sysString);
+        uint32_t start = micros();
+        snapshotSend(request, SNAPSHOT_SYS);                                    // Built by the loop with every RSSI refresh
+        metricsObserve(HIST_HTTP_GETSYS, micros() - start);
+    });
 
+    // Make live data available as Server-Sent Events
+    events.onConnect([](AsyncEventSourceClient *client){
+        debugf("📡 Event stream client connected (%u clients)\n", events.count());
+        char payload[192];
+        configLock();                                                           // The sensing task writes these meanwhile
+        float fridgeTemp = config.fridgeTemp;
+        float minTemp = config.minTemp;
+        float maxTemp = config.maxTemp;
+        bool alarm = config.alarm;
+        float trendNow = config.trend;
+        bool preAlarm = config.preAlarmActive;
+        configUnlock();
+        JsonDocument live;
+        live["FRIDGE_TEMP"] = fridgeTemp;
+        live["MIN_TEMP"] = minTemp;
+        live["MAX_TEMP"] = maxTemp;
+        live["ALARM"] = alarm;
+        live["TREND"] = trendNow;
+        live["PRE_ALARM_ACTIVE"] = preAlarm;
+        live["RSSI"] = liveRSSI.load();                                        // sys is rebuilt by loop(), not safe to read here
+        serializeJson(live, payload, sizeof(payload));
+        client->send(payload, "update", millis(), 5000);                        // Send full live data once, reconnect after 5 seconds
     });
+    server.addHandler(&events);
 
     server.begin();
     debugln("🌐 WebServer started");
 
 }
 
+// update sys["RSSI"] and the copy for the event stream
+void setRSSI(int rssi) {
+    sys["RSSI"] = rssi;
+    liveRSSI = rssi;
+}
+
+// Push changed live data (FRIDGE_TEMP, MIN/MAX, ALARM, RSSI) to all event stream clients
+void pushLiveData(bool force) {
+    static float lastFridgeTemp = NAN;
+    static float lastMinTemp = NAN;
+    static float lastMaxTemp = NAN;
+    static int lastAlarm = -1;
+    static int lastRSSI = 0;
+    static uint32_t lastProbes = 0;
+    static uint32_t lastReadings = 0;
+    static float lastTrend = NAN;
+    static int lastPreAlarm = -1;
+
+    JsonDocument live;
+    configLock();                                            // Written by the sensing task
+    float fridge_temp = config.fridgeTemp;
+    float min_temp = config.minTemp;
+    float max_temp = config.maxTemp;
+    int alarm = config.alarm ? 1 : 0;
+    float trend_now = config.trend;
+    int pre_alarm = config.preAlarmActive ? 1 : 0;
+    configUnlock();
+    int rssi = sys["RSSI"].as<int>();
+    uint32_t probesSum = probesChecksum();
+    uint32_t readingsSum = probesReadingsChecksum();
+
+    if(force || fridge_temp != lastFridgeTemp) { live["FRIDGE_TEMP"] = fridge_temp; lastFridgeTemp = fridge_temp; }
+    if(force || min_temp != lastMinTemp) { live["MIN_TEMP"] = min_temp; lastMinTemp = min_temp; }
+    if(force || max_temp != lastMaxTemp) { live["MAX_TEMP"] = max_temp; lastMaxTemp = max_temp; }
+    if(force || alarm != lastAlarm) { live["ALARM"] = (alarm == 1); lastAlarm = alarm; }
+    if(force || trend_now != lastTrend) { live["TREND"] = trend_now; lastTrend = trend_now; }
+    if(force || pre_alarm != lastPreAlarm) { live["PRE_ALARM_ACTIVE"] = (pre_alarm == 1); lastPreAlarm = pre_alarm; }
+    if(force || abs(rssi - lastRSSI) >= 2) { live["RSSI"] = rssi; lastRSSI = rssi; }   // Ignore RSSI jitter below 2 dBm
+    if(probesSum != lastProbes) { live["SENSORS_CHANGED"] = true; lastProbes = probesSum; } // Clients fetch the table from /getdata
+    if(readingsSum != lastReadings) {                                           // Readings of the table, no refetch per sample
+        if(probesCount() > 1) { probesReadingsToJson(live); }                   // The table is only shown with several sensors
+        lastReadings = readingsSum;
+    }
+
+    if(live.size() == 0 || events.count() == 0) {                               // Nothing changed or nobody listening
+        return;
+    }
+
+    char payload[384];                                                          // Incl. SENSOR_TEMPS of SENSOR_MAX sensors
+    serializeJson(live, payload, sizeof(payload));
+    events.send(payload, "update", millis());
+}
+
+// public configuration + live values (no secrets)
+void buildData(JsonDocument &doc) {
+    AppConfig copy;
+    configCopy(copy);                                        // Consistent copy, the sensing task may update it meanwhile
+    configToJson(copy, doc, 0, CFG_SECRET);                  // WIFI_STA_PW and API_KEY_n never leave the device
+    probesToJson(doc);                                       // Per-sensor table
+}
+
+// publish a new /getdata snapshot
+bool publishData() {
+    JsonDocument doc;
+    buildData(doc);
+    return snapshotPublish(SNAPSHOT_DATA, doc);
+}
+
+// publish a new /getsys snapshot
+bool publishSys() {
+    persistStats(sys);                                       // Add flash write counters
+    sensorStats(sys);                                        // Add acquisition latency
+    notifyStats(sys);                                        // Add notification counters
+    wakeupStats(sys);                                        // Add loop wakeups/s and idle %
+    webAssetStats(sys);                                      // Add web UI cache hits
+    snapshotStats(sys);                                      // Add snapshot counters
+    rtcStats(sys);                                           // Add DEEP_SLEEP awake times
+    metricsStats(sys);                                       // Add current heap and Wi-Fi reconnects
+    heapWatchStats(sys);                                     // Add heap history and fragmentation trend
+    samplingStats(sys);                                      // Add sampling period and samples per hour
+    wifiStats(sys);                                          // Add connect time and attempts
+    fwUpdateStats(sys);                                      // Add result and throughput of the last update
+    journalStats(sys);                                       // Add open alarm episodes
+    rulesStats(sys);                                         // Add alarm rules, table entries and events
+    mqttStats(sys);                                          // Add broker connection and buffered samples
+    sys["sensing_events_dropped"] = sensingEvents.dropped.load();   // Ring to loop() was full
+    sys["sensing_events_high_water"] = sensingEvents.highWater.load();
+    return snapshotPublish(SNAPSHOT_SYS, sys);
+}
+
 // Enable OTA Updates
 void enableOTAUpdates() {
 
-    ArduinoOTA.setHostname(String(config["HOSTNAME"]).c_str());
+    ArduinoOTA.setHostname(config.hostname);
     ArduinoOTA.setMdnsEnabled(true);
     ArduinoOTA.setRebootOnSuccess(true);
     ArduinoOTA.setPassword(OTA_PASSWORD);
@@ -556,82 +670,302 @@ TimerHandle_t createPeriodicTimer(const char* TimerName, uint32_t PeriodMS, Time
     return timerHandle;
 }
 
+// Create a one-shot timer
+TimerHandle_t createOneShotTimer(const char* TimerName, uint32_t PeriodMS, TimerCallbackFunction_t CallbackFunction) {
+    TimerHandle_t timerHandle = xTimerCreate(                 // Define timer
+        TimerName,                                            // Name of timer
+        PeriodMS/portTICK_PERIOD_MS,                          // Period of timer (in ticks)
+        pdFALSE,                                              // One-shot
+        (void *)1,                                            // Timer ID
+        CallbackFunction);                                    // Callback function
+
+    if (timerHandle == nullptr) {
+        debugf("❌ Failed to create timer: %s\n", TimerName);
+    } else {
+        debugf("✅ Timer created: %s (One-shot: %i ms)\n", TimerName, PeriodMS);
+    }
+
+    return timerHandle;
+}
+
 // blinking LED task
 void blinkLED(TimerHandle_t xTimer) {
     led_state = !led_state;
     digitalWrite(LED_BUILTIN, led_state);
 }
 
-// get Temp task
-void getTemp(TimerHandle_t xTimer) {
-    
-    sensors.requestTemperatures();                          // Temperaturmessung anstoßen
-    float tempC = sensors.getTempCByIndex(0);               // Temperatur des ersten Sensors lesen
-    if(tempC == DEVICE_DISCONNECTED_C) {
-        debugln("❌ Error: Could not read temperature data");
-        return;
+// get Temp (DEEP_SLEEP mode): wait for the result
+void getTemp() {
+    float tempC;
+    if(sensorReadBlocking(tempC) == SENSOR_READY) {
+        processTemp(tempC);
     }
+}
 
-    config["FRIDGE_TEMP"] = round(tempC * 10) / 10.0;        // Set TEMP_C to current temperature
-    if (config["FRIDGE_TEMP"] < config["MIN_TEMP"]) {        // Set MIN_TEMP to current temperature
-        config["MIN_TEMP"] = config["FRIDGE_TEMP"];
-        saveConfig(config);                                   
+// sensing task: start the conversion, collect the result and decide, every SAMPLE_MIN..SAMPLE_MAX seconds
+void sensingTask(void *parameter) {
+    TickType_t lastWake = xTaskGetTickCount();
+    for(;;) {
+        sensorSetResolution(config.sensorResolution);        // Apply changed resolution
+        uint32_t waitMs = sensorStart();                     // Temperaturmessung anstoßen (non-blocking)
+        uint32_t conversionStartUs = micros();
+        vTaskDelay(pdMS_TO_TICKS(waitMs));                   // Collect the result after the conversion time
+
+        float tempC;
+        SensorState state;
+        while((state = sensorPoll(tempC)) == SENSOR_CONVERTING) {   // Not yet complete -> check again shortly
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        uint32_t readyUs = micros();
+        probesUpdate();                                      // All sensors, also if the first one failed
+        if(state == SENSOR_READY) {
+            metricsObserve(HIST_SENSOR_CONVERSION, readyUs - conversionStartUs);
+            processTemp(tempC);
+        }
+        evaluateSample();
+        metricsObserve(HIST_ALARM_DECISION, micros() - readyUs);
+        wakeupSignal(WAKE_SAMPLE);                           // Wake the loop to handle the decisions
+
+        uint32_t periodMs = samplingProbesPeriodMs(config.trend, config.sampleMin * 1000, config.sampleMax * 1000);  // Shorter near the threshold
+        samplingRecord(millis(), periodMs, (readyUs - conversionStartUs) / 1000);
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(periodMs));
     }
-    if (config["FRIDGE_TEMP"] > config["MAX_TEMP"]) {        // Set MAX_TEMP to current temperature
-        config["MAX_TEMP"] = config["FRIDGE_TEMP"];          
-        saveConfig(config);
+}
+
+// alarm decisions of one sample: hysteresis per sensor, pre-alarm, alarm output and reminder
+void evaluateSample() {
+    bool anyAlarm = false;
+    RuleInput inputs[SENSOR_MAX];
+    for(uint8_t i = 0; i < probesCount(); i++) {             // Hysteresis state machine per sensor
+        Probe probe;
+        SensingEvent event = {};
+        event.type = SENSING_PROBE;
+        event.event = probesEvaluate(i, probe);
+        event.probe = i;
+        event.alarm = probe.alarm;
+        event.online = probe.online;
+        event.temp = probe.temp;
+        event.threshold = probesTarget(probe);
+        event.hysteresis = probesHysteresis(probe);
+        sensingEvents.push(event);
+        anyAlarm |= probe.alarm;
+        inputs[i] = {probe.temp, probe.online};
     }
-    tempTrigger = true;                                      // Set newTemp to true
 
+    RuleEvent ruleEvents[RULES_EVENTS_MAX];                  // Compiled rules, no JSON on this path
+    uint8_t ruleCount = rulesEvaluate(inputs, probesCount(), millis(), ruleEvents, RULES_EVENTS_MAX);
+    for(uint8_t i = 0; i < ruleCount; i++) {
+        SensingEvent event = {};
+        event.type = SENSING_RULE;
+        event.ruleEvent = ruleEvents[i].type;
+        event.rule = ruleEvents[i].rule;
+        event.ruleGeneration = ruleEvents[i].generation;
+        event.probe = ruleEvents[i].probe;
+        event.temp = ruleEvents[i].temp;
+        sensingEvents.push(event);
+    }
+
+    SensingEvent pre = {};                                   // Values for the message, loop() does not read config
+    pre.type = SENSING_PRE_ALARM;
+    pre.alarm = anyAlarm;
+    configLock();                                            // Projected crossing of TARGET_TEMP (first sensor)
+    bool preAlarm = config.preAlarmActive;
+    pre.event = preAlarmEvaluate(preAlarm, config.preAlarmEta, config.preAlarm, config.preAlarmHysteresis);
+    config.preAlarmActive = preAlarm;
+    pre.temp = (int16_t)lroundf(config.fridgeTemp * 10);
+    pre.threshold = config.targetTemp;
+    pre.trend = config.trend;
+    pre.eta = config.preAlarmEta;
+    configUnlock();
+    if(pre.event != ALARM_NONE) {
+        sensingEvents.push(pre);
+    }
+
+    uint32_t reminderMs = config.reminder * 60000;
+    AlarmEvent output = alarmReminderUpdate(reminder, anyAlarm, millis(), reminderMs);
+    if(output == ALARM_RAISED) {                             // First sensor in alarm
+        configLock();
+        config.alarm = true;
+        configUnlock();
+        digitalWrite(PIN_ALARM_OUTPUT, HIGH);
+    } else if(output == ALARM_CLEARED) {                     // Last sensor back to normal
+        configLock();
+        config.alarm = false;
+        configUnlock();
+        digitalWrite(PIN_ALARM_OUTPUT, LOW);                 // Set PIN_ALARM_OUTPUT to LOW
+    }
+    if(alarmReminderDue(reminder, millis(), reminderMs)) {   // Every REMINDER minutes while any sensor is in alarm
+        SensingEvent event = {};
+        event.type = SENSING_REMINDER;
+        sensingEvents.push(event);
+    }
 }
 
-// function to send notifications via WhatsApp to all configured numbers
-void sendWhatsAppNotifications(String Notification) {
-    if (config["NOTIFICATION"] == true) {
-        if(String(config["PHONE_NUMBER_1"]) != "" && String(config["API_KEY_1"]) != "") {
-            sendNotification(String(config["PHONE_NUMBER_1"]), String(config["API_KEY_1"]), Notification);
-        }
-        if(String(config["PHONE_NUMBER_2"]) != "" && String(config["API_KEY_2"]) != "") {
-            sendNotification(String(config["PHONE_NUMBER_2"]), String(config["API_KEY_2"]), Notification);
-        }
-        if(String(config["PHONE_NUMBER_3"]) != "" && String(config["API_KEY_3"]) != "") {
-            sendNotification(String(config["PHONE_NUMBER_3"]), String(config["API_KEY_3"]), Notification);
+// journal, notifications and log of a decision of the sensing task
+void handleSensingEvent(const SensingEvent &event) {
+    if(event.type == SENSING_REMINDER) {
+        notificationReminder();
+        return;
+    }
+
+    if(event.type == SENSING_RULE) {
+        handleRuleEvent(event);
+        return;
+    }
+
+    if(event.type == SENSING_PRE_ALARM) {
+        if(event.event == ALARM_RAISED) {
+            debugf("⏳ Pre-alarm: %+.2f °C/min, Target Temp %i °C in %.0f min\n", event.trend, event.threshold, event.eta);
+            if(!event.alarm) {                                  // No warning if the alarm is already out
+                char text[NOTIFY_TEXT_LEN];
+                snprintf(text, sizeof(text), "⏳ VORALARM: Aldo MoPro-Kühltheke - Temperatur steigt um %.2f°C/min, Schwellwert %i°C in ca. %i Minuten (aktuell %.1f°C)",
+                         event.trend, event.threshold, (int)ceilf(event.eta), event.temp / 10.0);
+                sendWhatsAppNotifications(text);
+            }
+        } else {
+            debugf("⏳ Pre-alarm cleared: %+.2f °C/min\n", event.trend);
         }
-    }           
+        return;
+    }
+
+    Probe probe;
+    probesGet(event.probe, probe);                           // Name only, the reading is in the event
+    float probe_temp = event.temp / 10.0;
+    if(event.online) {
+        journalSample(event.probe, event.temp, event.threshold * 10, event.alarm);  // Episodes and daily aggregates
+        mqttSample(event.probe, event.temp);                 // Batched to <prefix>/samples
+    }
+    if(event.event != ALARM_NONE) {
+        mqttAlarm(event.probe, event.event == ALARM_RAISED, event.temp, event.threshold);
+    }
+
+    if(event.event == ALARM_RAISED) {                        // If Fridge Temp is above Target Temp and alarm not yet triggered
+        debugf("🌡️ %s: Fridge Temp %02.1f °C > Target Temp %i °C (ALARM: true)\n", probe.name, probe_temp, event.threshold);
+        char text[NOTIFY_TEXT_LEN];
+        snprintf(text, sizeof(text), "🌡️ ALARM: Aldo MoPro-Kühltheke%s%s - Temperatur: %.1f°C (Schwellwert: %i°C)!!",
+                 probesCount() > 1 ? " " : "", probesCount() > 1 ? probe.name : "", probe_temp, event.threshold);
+        int sent = sendWhatsAppNotifications(text);          // Send WhatsApp Notification to all configured numbers
+        journalNotified(event.probe, sent);
+    } else if(event.event == ALARM_CLEARED) {                // If Fridge Temp is below Target Temp - Hysteresis and alarm is triggered
+        debugf("🌡️ %s: Fridge Temp %02.1f °C < Target Temp %i °C - Hysteresis %i °C (ALARM: false)!\n", probe.name, probe_temp, event.threshold, event.hysteresis);
+    } else {
+        debugf("🌡️ %s: Fridge Temp %02.1f °C | Target Temp %i °C (ALARM: %s)\n", probe.name, probe_temp, event.threshold, event.alarm ? "true" : "false");
+    }
 }
 
-// function to send a notification via WhatsApp
-void sendNotification(String Phone_Number, String API_Key, String Notification) {
+// log and notification of an alarm rule
+void handleRuleEvent(const SensingEvent &event) {
+    static const char *const icons[] = {"ℹ️", "⚠️", "🚨"};
+    RuleDef def;
+    Probe probe;
+    if(!rulesGet(event.rule, event.ruleGeneration, def) || !probesGet(event.probe, probe)) {  // Rules replaced meanwhile
+        return;
+    }
+    const char *what = event.ruleEvent == RULE_RAISED ? "raised" : (event.ruleEvent == RULE_CLEARED ? "cleared" : "reminder");
+    debugf("%s Rule %s %s: %s %.1f °C\n", icons[def.severity], def.name, what, probe.name, event.temp / 10.0);
 
-    String url = "https://api.callmebot.com/whatsapp.php?phone=" + Phone_Number + "&apikey=" + API_Key + "&text="+urlEncode(Notification);    
+    if(event.ruleEvent == RULE_CLEARED || def.severity == RULE_INFO) {      // Like the TARGET_TEMP alarm: no message when cleared
+        return;
+    }
+    RuleEvent ruleEvent = {event.ruleEvent, event.rule, event.probe, event.temp, event.ruleGeneration};
+    char text[NOTIFY_TEXT_LEN];
+    size_t len = event.ruleEvent == RULE_REMINDER ? snprintf(text, sizeof(text), "Erinnerung: ") : 0;
+    if(rulesFormat(def, ruleEvent, probe.name, text + len, sizeof(text) - len) > 0) {
+        sendWhatsAppNotifications(text);
+    }
+}
 
-    http.begin(url);                                                        // Data to send with HTTP POST  
-    http.addHeader("Content-Type", "application/x-www-form-urlencoded");    // Specify content-type header
-          
-    int httpResponseCode = http.POST("");                                  // Send HTTP POST request
-    if (httpResponseCode == 200){
-        debugf("📦 WHATSAPP Notification sent to <+%s>\n", Phone_Number);
-    } else {
-        debugf("❌ WHATSAPP Notification -> ERROR: HTTP response code: %i\n",httpResponseCode);
+// process a new temperature sample
+void processTemp(float tempC) {
+    static bool firstSample = true;
+    if (firstSample) {                                       // Boot-to-first-sample, no longer waits for Wi-Fi
+        firstSample = false;
+        metricsSet(GAUGE_BOOT_FIRST_SAMPLE, micros());
+    }
+
+    float fridgeTemp = round(tempC * 10) / 10.0;
+    float slope;                                             // O(1) update of the regression window and EWMA
+    trendAdd(trend, millis(), tempC);
+    float trendNow = trendSlope(trend, slope) ? roundf(slope * 100) / 100.0f : 0;
+    float eta = trendMinutesTo(trend, config.targetTemp);
+
+    configLock();                                            // Web task and event stream read these fields
+    config.fridgeTemp = fridgeTemp;                          // Set TEMP_C to current temperature
+    bool newMin = fridgeTemp < config.minTemp;               // Set MIN_TEMP to current temperature
+    if (newMin) {
+        config.minTemp = fridgeTemp;
     }
+    bool newMax = fridgeTemp > config.maxTemp;               // Set MAX_TEMP to current temperature
+    if (newMax) {
+        config.maxTemp = fridgeTemp;
+    }
+    config.trend = trendNow;
+    config.preAlarmEta = eta < 0 ? TREND_NO_ETA : roundf(eta * 10) / 10.0f;
+    configUnlock();
 
-    http.end();                                                             // Free resources
-  }
+    if (newMin) {
+        persistMarkDirty("MIN_TEMP");                         // Committed later from loop(), not in the sensing task
+    }
+    if (newMax) {
+        persistMarkDirty("MAX_TEMP");
+    }
+    historyAdd(fridgeTemp);                                  // Add sample to temperature history
+}
 
-// function for automatically resetting the alarm after a defined time
-void notificationReminder(TimerHandle_t xTimer) {
+// function to queue notifications via WhatsApp to all configured numbers (sent by the dispatcher task), returns the number queued
+int sendWhatsAppNotifications(const char *text) {
+    int queued = 0;
+    if (config.notification) {
+        char phone[3][sizeof(config.phoneNumber1)];
+        char apiKey[3][sizeof(config.apiKey1)];
+
+        configLock();                                       // Consistent copy, /getdata may change them meanwhile
+        strlcpy(phone[0], config.phoneNumber1, sizeof(phone[0]));
+        strlcpy(phone[1], config.phoneNumber2, sizeof(phone[1]));
+        strlcpy(phone[2], config.phoneNumber3, sizeof(phone[2]));
+        strlcpy(apiKey[0], config.apiKey1, sizeof(apiKey[0]));
+        strlcpy(apiKey[1], config.apiKey2, sizeof(apiKey[1]));
+        strlcpy(apiKey[2], config.apiKey3, sizeof(apiKey[2]));
+        configUnlock();
+
+        for(int i = 0; i < 3; i++) {
+            if(phone[i][0] != '\0' && apiKey[i][0] != '\0') {
+                queued += notifyEnqueue(phone[i], apiKey[i], text);
+            }
+        }
+    }           
+    return queued;
+}
+
+// function for re-sending the alarm every REMINDER minutes (called from loop())
+void notificationReminder() {
 
-    if (config["NOTIFICATION"] == true) {
+    if (config.notification) {
         debugln("📦 Notification reminder!");
-        sendWhatsAppNotifications(String("🌡️ Erinnerung: AlDo MoPro-Kühltheke immer noch zu warm!! (Temperatur: " + config["FRIDGE_TEMP"].as<String>() + "°C)")); // Send WhatsApp Notification to all configured numbers    
+        char temps[NOTIFY_TEXT_LEN / 2] = "";
+        size_t len = 0;
+        for(uint8_t i = 0; i < probesCount() && len < sizeof(temps); i++) {  // All sensors still in alarm
+            Probe probe;
+            if(probesGet(i, probe) && probe.alarm) {
+                len += snprintf(temps + len, sizeof(temps) - len, "%s%s%s%.1f°C", len > 0 ? ", " : "",
+                                probesCount() > 1 ? probe.name : "", probesCount() > 1 ? ": " : "", probe.temp / 10.0);
+            }
+        }
+        char text[NOTIFY_TEXT_LEN];
+        snprintf(text, sizeof(text), "🌡️ Erinnerung: AlDo MoPro-Kühltheke immer noch zu warm!! (Temperatur: %s)", temps);
+        int sent = sendWhatsAppNotifications(text);          // Send WhatsApp Notification to all configured numbers
+        journalNotified(JOURNAL_ALL_PROBES, sent);           // Counted for every open episode
     }   
 }
 
 // Function to switch between the modes <CONFIG>, <CONFIG> or <DEEP_SLEEP>
 void switchMode(String mode) {
     debugf("⚠️ MODE changed to <%s>. A restart is required to apply the new mode!", mode.c_str());
-    config["MODE"] = mode;
-    saveConfig(config);                               // Save configuration to filesystem
+    configApplyParam("MODE", mode.c_str());
+    persistMarkDirty("MODE");
+    persistCommitNow();                               // Save configuration to filesystem
+    probesCommitNow();                                // Save sensor names/thresholds
+    journalCommitNow();                               // Save the running day
     ESP.restart();  
 }
 
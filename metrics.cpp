@@ -0,0 +1,195 @@
+#include "metrics.h"
+#include <atomic>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include "config_schema.h"
+#include "probes.h"
+#include "debug.h"
+
+// Bucket upper bounds in µs and as OpenMetrics "le" label, shared by all histograms
+static const uint32_t BUCKET_US[METRICS_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+static const char *const BUCKET_LE[METRICS_BUCKETS] = {
+    "5e-05", "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05",
+    "0.1", "0.25", "0.5", "1.0", "2.5", "5.0", "10.0"
+};
+
+// One histogram: per-bucket counts (not cumulative, last = +Inf) and the sum in µs.
+// 64 bit atomics are not lock-free on the ESP32, the sum is guarded by sumMux.
+struct Histogram {
+    std::atomic<uint32_t> buckets[METRICS_BUCKETS + 1];
+    uint64_t sum;
+};
+
+struct HistogramInfo {
+    const char *family;                                 // Metric family name (consecutive entries share the header)
+    const char *route;                                  // Value of the route label, nullptr = no label
+    const char *help;
+};
+
+static const HistogramInfo HISTOGRAM_INFO[HIST_COUNT] = {
+    {"fridge_sensor_conversion_seconds", nullptr, "DS18B20 conversion started until all results are read"},
+    {"fridge_alarm_decision_seconds", nullptr, "Sensor results read until the alarm output is switched"},
+    {"fridge_loop_iteration_seconds", nullptr, "One loop() iteration without the wait for events"},
+    {"fridge_notify_round_trip_seconds", nullptr, "One notification POST until the HTTP response"},
+    {"fridge_flash_write_seconds", nullptr, "Configuration, NVS and history writes"},
+    {"fridge_wifi_connect_seconds", nullptr, "Boot or link loss until the station has an IP address"},
+    {"fridge_http_request_duration_seconds", "/getdata", "Web handler latency per route"},
+    {"fridge_http_request_duration_seconds", "/getsys", "Web handler latency per route"},
+    {"fridge_http_request_duration_seconds", "/history", "Web handler latency per route"},
+    {"fridge_http_request_duration_seconds", "asset", "Web handler latency per route"},
+    {"fridge_http_request_duration_seconds", "/update", "Web handler latency per route"},
+    {"fridge_http_request_duration_seconds", "/metrics", "Web handler latency per route"},
+};
+
+static const char *const COUNTER_NAME[COUNT_COUNT] = {
+    "fridge_wifi_disconnects",
+    "fridge_wifi_reconnects",
+};
+
+static const char *const GAUGE_NAME[GAUGE_COUNT][2] = {  // Name, help
+    {"fridge_boot_to_first_sample_seconds", "Boot until the first temperature sample"},
+};
+
+static Histogram histograms[HIST_COUNT];                // Zero-initialized (static storage)
+static portMUX_TYPE sumMux = portMUX_INITIALIZER_UNLOCKED;  // Histogram::sum of all histograms
+static std::atomic<uint32_t> counters[COUNT_COUNT];
+static std::atomic<uint32_t> gauges[GAUGE_COUNT];       // µs
+
+// record a duration
+void metricsObserve(MetricHistogram histogram, uint32_t us) {
+    Histogram &h = histograms[histogram];
+    uint8_t bucket = 0;
+    while (bucket < METRICS_BUCKETS && us > BUCKET_US[bucket]) {
+        bucket++;
+    }
+    h.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    portENTER_CRITICAL(&sumMux);
+    h.sum += us;
+    portEXIT_CRITICAL(&sumMux);
+}
+
+// count an event
+void metricsIncrement(MetricCounter counter) {
+    counters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+// set a duration gauge
+void metricsSet(MetricGauge gauge, uint32_t us) {
+    gauges[gauge].store(us, std::memory_order_relaxed);
+}
+
+// sum of a histogram in µs, both words read under the lock so it never goes backwards
+static uint64_t histogramSum(const Histogram &h) {
+    portENTER_CRITICAL(&sumMux);
+    uint64_t sum = h.sum;
+    portEXIT_CRITICAL(&sumMux);
+    return sum;
+}
+
+// copy a label value, escaping quotes and backslashes (user-defined sensor names)
+static void escapeLabel(char *dst, size_t len, const char *src) {
+    size_t n = 0;
+    for (; *src != '\0' && n + 2 < len; src++) {
+        if (*src == '"' || *src == '\\') {
+            dst[n++] = '\\';
+        }
+        dst[n++] = *src;
+    }
+    dst[n] = '\0';
+}
+
+// write one histogram series (cumulative buckets, sum, count)
+static void writeHistogram(AsyncResponseStream *out, const HistogramInfo &info, const Histogram &h) {
+    char label[32] = "";
+    if (info.route != nullptr) {
+        snprintf(label, sizeof(label), "route=\"%s\",", info.route);
+    }
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < METRICS_BUCKETS; i++) {
+        cumulative += h.buckets[i].load(std::memory_order_relaxed);
+        out->printf("%s_bucket{%sle=\"%s\"} %lu\n", info.family, label, BUCKET_LE[i], (unsigned long)cumulative);
+    }
+    cumulative += h.buckets[METRICS_BUCKETS].load(std::memory_order_relaxed);
+    out->printf("%s_bucket{%sle=\"+Inf\"} %lu\n", info.family, label, (unsigned long)cumulative);
+
+    if (label[0] != '\0') {                             // {route="..."} without the trailing comma
+        label[strlen(label) - 1] = '\0';
+        out->printf("%s_sum{%s} %.6f\n", info.family, label, histogramSum(h) / 1e6);
+        out->printf("%s_count{%s} %lu\n", info.family, label, (unsigned long)cumulative);
+    } else {
+        out->printf("%s_sum %.6f\n", info.family, histogramSum(h) / 1e6);
+        out->printf("%s_count %lu\n", info.family, (unsigned long)cumulative);
+    }
+}
+
+// write a gauge family with a single value
+static void writeGauge(AsyncResponseStream *out, const char *name, const char *unit, const char *help, double value) {
+    out->printf("# TYPE %s gauge\n", name);
+    if (unit != nullptr) {
+        out->printf("# UNIT %s %s\n", name, unit);
+    }
+    out->printf("# HELP %s %s\n", name, help);
+    out->printf("%s %.10g\n", name, value);
+}
+
+// render all metrics
+static void sendMetrics(AsyncWebServerRequest *request) {
+    uint32_t start = micros();
+    AsyncResponseStream *out = request->beginResponseStream(METRICS_CONTENT_TYPE);
+
+    for (uint8_t i = 0; i < HIST_COUNT; i++) {
+        const HistogramInfo &info = HISTOGRAM_INFO[i];
+        if (i == 0 || strcmp(info.family, HISTOGRAM_INFO[i - 1].family) != 0) {
+            out->printf("# TYPE %s histogram\n# UNIT %s seconds\n# HELP %s %s\n", info.family, info.family, info.family, info.help);
+        }
+        writeHistogram(out, info, histograms[i]);
+    }
+
+    for (uint8_t i = 0; i < COUNT_COUNT; i++) {
+        out->printf("# TYPE %s counter\n%s_total %lu\n", COUNTER_NAME[i], COUNTER_NAME[i], (unsigned long)counters[i].load(std::memory_order_relaxed));
+    }
+
+    for (uint8_t i = 0; i < GAUGE_COUNT; i++) {
+        writeGauge(out, GAUGE_NAME[i][0], "seconds", GAUGE_NAME[i][1], gauges[i].load(std::memory_order_relaxed) / 1e6);
+    }
+    writeGauge(out, "fridge_heap_free_bytes", "bytes", "Free heap", ESP.getFreeHeap());
+    writeGauge(out, "fridge_heap_min_free_bytes", "bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    writeGauge(out, "fridge_heap_largest_block_bytes", "bytes", "Largest allocatable heap block", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    writeGauge(out, "fridge_uptime_seconds", "seconds", "Time since boot", millis() / 1000.0);
+    if (WiFi.status() == WL_CONNECTED) {
+        writeGauge(out, "fridge_wifi_rssi_dbm", nullptr, "Signal strength of the access point", WiFi.RSSI());
+    }
+    writeGauge(out, "fridge_alarm", nullptr, "Any sensor in alarm", config.alarm ? 1 : 0);
+
+    out->printf("# TYPE fridge_temperature_celsius gauge\n# UNIT fridge_temperature_celsius celsius\n# HELP fridge_temperature_celsius Last reading per sensor\n");
+    for (uint8_t i = 0; i < probesCount(); i++) {
+        Probe probe;
+        if (probesGet(i, probe) && probe.online) {
+            char name[2 * PROBE_NAME_LEN];
+            escapeLabel(name, sizeof(name), probe.name);
+            out->printf("fridge_temperature_celsius{sensor=\"%s\",name=\"%s\"} %.1f\n", probe.id, name, probe.temp / 10.0);
+        }
+    }
+
+    out->print("# EOF\n");
+    request->send(out);
+    metricsObserve(HIST_HTTP_METRICS, micros() - start);
+}
+
+// register /metrics
+void metricsBegin(AsyncWebServer &server) {
+    server.on("/metrics", HTTP_GET, sendMetrics);
+    debugln("✅ Metrics available on /metrics");
+}
+
+// add current heap and Wi-Fi counters
+void metricsStats(JsonDocument &sys) {
+    sys["heap_free"] = ESP.getFreeHeap();
+    sys["heap_min_free"] = ESP.getMinFreeHeap();
+    sys["heap_largest_block"] = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    sys["wifi_reconnects"] = counters[COUNT_WIFI_RECONNECTS].load(std::memory_order_relaxed);
+    sys["boot_first_sample_ms"] = gauges[GAUGE_BOOT_FIRST_SAMPLE].load(std::memory_order_relaxed) / 1000;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// ======================================================================
+// Metrics
+// ======================================================================
+// Counters and fixed-bucket latency histograms for the hot paths, served
+// as OpenMetrics text on /metrics for a Prometheus scrape. Recording is
+// a bucket search plus two relaxed atomic increments, no lock and no
+// allocation, so it stays enabled in production and may be called from
+// any task. Heap and Wi-Fi gauges are read at scrape time.
+
+#define METRICS_BUCKETS 17                              // Bucket bounds 50 µs .. 10 s (+Inf is implicit)
+#define METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+enum MetricHistogram : uint8_t {
+    HIST_SENSOR_CONVERSION,                             // Conversion started -> results read
+    HIST_ALARM_DECISION,                                // Results read -> alarm output switched (sensing task)
+    HIST_LOOP,                                          // One loop() iteration, without the wait
+    HIST_NOTIFY_RTT,                                    // One notification POST (request -> response)
+    HIST_FLASH_WRITE,                                   // Config/NVS commit, history segment append
+    HIST_WIFI_CONNECT,                                  // Boot or link loss until the station has an IP
+    HIST_HTTP_GETDATA,                                  // Web handler latency per route ...
+    HIST_HTTP_GETSYS,
+    HIST_HTTP_HISTORY,
+    HIST_HTTP_ASSET,                                    // ... embedded pages, CSS, icons
+    HIST_HTTP_UPDATE,
+    HIST_HTTP_METRICS,
+    HIST_COUNT
+};
+
+enum MetricCounter : uint8_t {
+    COUNT_WIFI_DISCONNECTS,                             // Station lost the access point
+    COUNT_WIFI_RECONNECTS,                              // Station got an IP again after a disconnect
+    COUNT_COUNT
+};
+
+enum MetricGauge : uint8_t {
+    GAUGE_BOOT_FIRST_SAMPLE,                            // Boot until the first temperature sample (µs)
+    GAUGE_COUNT
+};
+
+void metricsBegin(AsyncWebServer &server);              // Register /metrics
+void metricsObserve(MetricHistogram histogram, uint32_t us);    // Record a duration (any task)
+void metricsIncrement(MetricCounter counter);           // Count an event (any task)
+void metricsSet(MetricGauge gauge, uint32_t us);        // Set a duration gauge (any task)
+void metricsStats(JsonDocument &sys);                   // Add current heap and Wi-Fi counters
@@ -0,0 +1,516 @@
+#include "mqtt.h"
+#include <atomic>
+#include <time.h>
+#include <esp_idf_version.h>
+#include <mqtt_client.h>
+#include "config_schema.h"
+#include "outbox.h"
+#include "probes.h"
+#include "response_format.h"
+#include "debug.h"
+
+// Buffered sample, the epoch time is derived when it is published
+struct __attribute__((packed)) MqttSample {
+    uint32_t ms;                                        // millis() of the reading
+    uint8_t probe;                                      // Sensor index
+    int16_t temp;                                       // 1/10 °C
+};
+
+// Sample moved to the outbox, with its epoch time since millis() does not survive a reboot
+struct __attribute__((packed)) MqttStoredSample {
+    uint32_t ts;
+    uint8_t probe;
+    int16_t temp;
+};
+static_assert(MQTT_STORED_SAMPLES * sizeof(MqttStoredSample) <= OUTBOX_DATA_MAX, "stored samples do not fit an outbox record");
+static_assert(MQTT_STORED_SAMPLES <= MQTT_BATCH_RECORDS, "a stored block is published as one batch");
+
+// Alarm transition waiting for the broker
+struct MqttAlarmEvent {
+    uint32_t ms;                                        // millis() of the transition
+    uint8_t probe;
+    bool alarm;                                         // Raised or cleared
+    int16_t temp;                                       // 1/10 °C
+    int8_t threshold;                                   // Effective TARGET_TEMP in °C
+};
+
+static esp_mqtt_client_handle_t client = nullptr;
+static bool enabled = false;                            // mqttBegin() was called (NORMAL mode with Wi-Fi)
+
+// Written by the MQTT task (event handler) or /getdata, read by loop()
+static std::atomic<bool> connected{false};
+static std::atomic<bool> announce{false};               // Connected: status, discovery and state due
+static std::atomic<bool> reconfigure{false};            // MQTT_* changed
+static std::atomic<int> batchId{-1};                    // msg_id of the batch in flight
+static std::atomic<int> batchAcked{0};                  // msg_id of the last batch the broker acknowledged
+static std::atomic<int> lastAcked{0};                   // msg_id of the last PUBACK, 0 = none (QoS 0 has no id)
+static std::atomic<uint32_t> connects{0};
+
+// Settings of the running client, esp-mqtt copies them on init
+static char prefix[48];
+static char nodeId[20];                                 // Client id and discovery unique id
+static char willTopic[64];
+
+// loop() only
+static MqttSample samples[MQTT_BUFFER_SAMPLES];         // Ring, oldest first
+static uint16_t sampleHead = 0;                         // Oldest sample
+static uint16_t sampleCount = 0;
+static MqttAlarmEvent alarms[MQTT_ALARM_EVENTS];
+static uint8_t alarmHead = 0;
+static uint8_t alarmCount = 0;
+static uint16_t batchRecords = 0;                       // Oldest samples covered by the batch in flight
+static bool batchStored = false;                        // The batch in flight is the oldest outbox record
+static Outbox stored;                                   // Samples the RAM ring had no room for
+static uint32_t batchSentMs = 0;
+static uint32_t lastBatchMs = 0;
+static uint32_t lastHealthMs = 0;
+static bool healthSent = false;
+static bool stateDue = false;                           // New values for <prefix>/state
+static char payload[MQTT_PAYLOAD_MAX];
+
+// Statistics
+static uint32_t samplesPublished = 0;
+static uint32_t batches = 0;
+static uint32_t retries = 0;                            // Batches sent again (no ack within MQTT_ACK_TIMEOUT_MS)
+static uint32_t dropped = 0;                            // Samples and alarm transitions lost to a full buffer
+static uint32_t samplesStored = 0;                      // Samples moved to the outbox
+
+// connection state and acks from the MQTT task
+static void onEvent(void *args, esp_event_base_t base, int32_t id, void *data) {
+    esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)data;
+    switch ((esp_mqtt_event_id_t)id) {
+    case MQTT_EVENT_CONNECTED:
+        connected = true;
+        announce = true;
+        connects++;
+        debugln("✅ MQTT connected");
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        if (connected.exchange(false)) {
+            debugln("❌ MQTT disconnected");
+        }
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        lastAcked = event->msg_id;                      // First: publishBatch() checks it after setting batchId
+        if (event->msg_id == batchId.load()) {
+            batchAcked = event->msg_id;                 // An id, so a late ack cannot confirm the next batch
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// enqueue a message for the MQTT task, false if its outbox is full
+static bool publishTopic(const char *topic, const char *data, size_t len, bool retain) {
+    return esp_mqtt_client_enqueue(client, topic, data, len, config.mqttQos, retain, true) >= 0;
+}
+
+// enqueue a message below MQTT_PREFIX, returns the msg_id (0 with QoS 0) or -1
+static int publish(const char *subtopic, const char *data, size_t len, bool retain) {
+    char topic[sizeof(prefix) + 16];
+    snprintf(topic, sizeof(topic), "%s/%s", prefix, subtopic);
+    return esp_mqtt_client_enqueue(client, topic, data, len, config.mqttQos, retain, true);
+}
+
+// serialize a document into the payload buffer and publish it
+static int publishJson(const char *subtopic, const JsonDocument &doc, bool retain) {
+    size_t len = serializeJson(doc, payload, sizeof(payload));
+    return len > 0 ? publish(subtopic, payload, len, retain) : -1;
+}
+
+// epoch seconds of a millis() stamp, 0 while the clock is not set
+static uint32_t epochAt(uint32_t ms) {
+    time_t now = time(nullptr);
+    if (now <= 1600000000) {
+        return 0;
+    }
+    return (uint32_t)now - (millis() - ms) / 1000;
+}
+
+// remove the oldest samples from the ring
+static void dropSamples(uint16_t count) {
+    count = count < sampleCount ? count : sampleCount;
+    sampleHead = (sampleHead + count) % MQTT_BUFFER_SAMPLES;
+    sampleCount -= count;
+}
+
+// remove the batch that was delivered from the outbox or the ring
+static void releaseBatch(uint16_t records, bool fromOutbox) {
+    if (fromOutbox) {
+        outboxPop(stored);
+    } else {
+        dropSamples(records);
+    }
+    samplesPublished += records;
+}
+
+// move the oldest samples to the outbox, false if the clock is not set or the write failed
+static bool storeSamples() {
+    if (time(nullptr) <= 1600000000) {                  // Stored samples need an epoch timestamp
+        return false;
+    }
+    MqttStoredSample block[MQTT_STORED_SAMPLES];
+    uint16_t count = 0;
+    while (count < MQTT_STORED_SAMPLES && count < sampleCount) {
+        const MqttSample &sample = samples[(sampleHead + count) % MQTT_BUFFER_SAMPLES];
+        block[count].ts = epochAt(sample.ms);
+        block[count].probe = sample.probe;
+        block[count].temp = sample.temp;
+        count++;
+    }
+    uint32_t before = outboxCount(stored);
+    if (!outboxAppend(stored, block, count * sizeof(MqttStoredSample))) {
+        return false;
+    }
+    if (batchId.load() >= 0 && (!batchStored || outboxCount(stored) <= before)) {
+        batchId = -1;                                   // Its records moved or were dropped: sent again from flash (at least once)
+        batchRecords = 0;
+    }
+    dropSamples(count);
+    samplesStored += count;
+    return true;
+}
+
+// stop and free the client
+static void stop() {
+    if (client == nullptr) {
+        return;
+    }
+    esp_mqtt_client_stop(client);
+    esp_mqtt_client_destroy(client);
+    client = nullptr;
+    connected = false;
+    batchId = -1;
+    lastAcked = 0;                                      // A new client starts its msg_ids again
+    batchAcked = 0;
+    batchRecords = 0;
+}
+
+// start the client with the current settings
+static void start() {
+    static char host[sizeof(config.mqttHost)];
+    static char user[sizeof(config.mqttUser)];
+    static char password[sizeof(config.mqttPassword)];
+    configLock();                                       // /getdata may be writing the strings
+    strlcpy(host, config.mqttHost, sizeof(host));
+    strlcpy(user, config.mqttUser, sizeof(user));
+    strlcpy(password, config.mqttPassword, sizeof(password));
+    strlcpy(prefix, config.mqttPrefix, sizeof(prefix));
+    configUnlock();
+    if (host[0] == '\0') {
+        return;
+    }
+    snprintf(nodeId, sizeof(nodeId), "aldo_%012llx", ESP.getEfuseMac());
+    snprintf(willTopic, sizeof(willTopic), "%s/status", prefix);
+
+    esp_mqtt_client_config_t cfg = {};
+#if ESP_IDF_VERSION_MAJOR >= 5
+    cfg.broker.address.hostname = host;
+    cfg.broker.address.port = config.mqttPort;
+    cfg.broker.address.transport = MQTT_TRANSPORT_OVER_TCP;
+    cfg.credentials.client_id = nodeId;
+    cfg.credentials.username = user[0] != '\0' ? user : nullptr;
+    cfg.credentials.authentication.password = password[0] != '\0' ? password : nullptr;
+    cfg.session.keepalive = MQTT_KEEPALIVE_S;
+    cfg.session.last_will.topic = willTopic;
+    cfg.session.last_will.msg = "offline";
+    cfg.session.last_will.qos = 1;
+    cfg.session.last_will.retain = 1;
+#else
+    cfg.host = host;
+    cfg.port = config.mqttPort;
+    cfg.transport = MQTT_TRANSPORT_OVER_TCP;
+    cfg.client_id = nodeId;
+    cfg.username = user[0] != '\0' ? user : nullptr;
+    cfg.password = password[0] != '\0' ? password : nullptr;
+    cfg.keepalive = MQTT_KEEPALIVE_S;
+    cfg.lwt_topic = willTopic;
+    cfg.lwt_msg = "offline";
+    cfg.lwt_qos = 1;
+    cfg.lwt_retain = 1;
+#endif
+    client = esp_mqtt_client_init(&cfg);
+    if (client == nullptr) {
+        debugln("❌ MQTT client init failed");
+        return;
+    }
+    esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, onEvent, nullptr);
+    esp_mqtt_client_start(client);
+    debugf("📡 MQTT: %s:%i, topics %s/...\n", host, config.mqttPort, prefix);
+}
+
+// device block shared by all discovery configs
+static void addDevice(JsonDocument &doc) {
+    JsonObject dev = doc["dev"].to<JsonObject>();
+    dev["ids"] = nodeId;
+    dev["name"] = config.hostname;
+    dev["mf"] = "AlDo";
+    dev["mdl"] = "MoPro-Kühltheke";
+    dev["sw"] = config.version;
+}
+
+// Home Assistant discovery: one temperature sensor per probe and the alarm
+static void publishDiscovery() {
+    char stateTopic[sizeof(prefix) + 8];
+    char topic[96];
+    char id[40];
+    snprintf(stateTopic, sizeof(stateTopic), "%s/state", prefix);
+
+    for (uint8_t i = 0; i < probesCount(); i++) {
+        Probe probe;
+        probesGet(i, probe);
+        char tpl[32];
+        snprintf(id, sizeof(id), "%s_t%u", nodeId, i);
+        snprintf(tpl, sizeof(tpl), "{{ value_json.t[%u] }}", i);
+        JsonDocument doc;
+        doc["name"] = probe.name;
+        doc["uniq_id"] = id;
+        doc["stat_t"] = stateTopic;
+        doc["val_tpl"] = tpl;
+        doc["unit_of_meas"] = "°C";
+        doc["dev_cla"] = "temperature";
+        doc["stat_cla"] = "measurement";
+        doc["avty_t"] = willTopic;
+        addDevice(doc);
+        snprintf(topic, sizeof(topic), "%s/sensor/%s/config", MQTT_DISCOVERY_PREFIX, id);
+        size_t len = serializeJson(doc, payload, sizeof(payload));
+        publishTopic(topic, payload, len, true);
+    }
+
+    snprintf(id, sizeof(id), "%s_alarm", nodeId);
+    JsonDocument doc;
+    doc["name"] = "Alarm";
+    doc["uniq_id"] = id;
+    doc["stat_t"] = stateTopic;
+    doc["val_tpl"] = "{{ 'ON' if value_json.alarm else 'OFF' }}";
+    doc["dev_cla"] = "problem";
+    doc["avty_t"] = willTopic;
+    addDevice(doc);
+    snprintf(topic, sizeof(topic), "%s/binary_sensor/%s/config", MQTT_DISCOVERY_PREFIX, id);
+    size_t len = serializeJson(doc, payload, sizeof(payload));
+    publishTopic(topic, payload, len, true);
+}
+
+// retained latest values of all sensors, false if the client outbox is full
+static bool publishState() {
+    JsonDocument doc;
+    JsonArray temps = doc["t"].to<JsonArray>();
+    for (uint8_t i = 0; i < probesCount(); i++) {
+        Probe probe;
+        probesGet(i, probe);
+        if (probe.online) {
+            temps.add(probe.temp / 10.0f);
+        } else {
+            temps.add(nullptr);
+        }
+    }
+    doc["alarm"] = config.alarm;
+    doc["pre_alarm"] = config.preAlarmActive;
+    return publishJson("state", doc, true) >= 0;
+}
+
+// retained alarm transition, false if the client outbox is full
+static bool publishAlarm(const MqttAlarmEvent &event) {
+    Probe probe;
+    probesGet(event.probe, probe);
+    JsonDocument doc;
+    doc["ts"] = epochAt(event.ms);
+    doc["sensor"] = event.probe;
+    doc["name"] = probe.name;
+    doc["alarm"] = event.alarm;
+    doc["temp"] = event.temp / 10.0f;
+    doc["threshold"] = event.threshold;
+    return publishJson("alarm", doc, true) >= 0;
+}
+
+// publish the oldest samples as [[ts,sensor,temp_x10],...], the outbox before the RAM ring
+static void publishBatch() {
+    MqttStoredSample block[MQTT_STORED_SAMPLES];
+    uint16_t available = outboxPeek(stored, block, sizeof(block)) / sizeof(MqttStoredSample);
+    bool fromOutbox = available > 0;
+    if (!fromOutbox) {
+        if (time(nullptr) <= 1600000000) {              // Timestamps need the clock
+            return;
+        }
+        available = sampleCount;
+    }
+
+    size_t len = 0;
+    uint16_t records = 0;
+    payload[len++] = '[';
+    while (records < available && records < MQTT_BATCH_RECORDS) {
+        MqttStoredSample sample;
+        if (fromOutbox) {
+            sample = block[records];
+        } else {
+            const MqttSample &buffered = samples[(sampleHead + records) % MQTT_BUFFER_SAMPLES];
+            sample.ts = epochAt(buffered.ms);
+            sample.probe = buffered.probe;
+            sample.temp = buffered.temp;
+        }
+        int n = snprintf(payload + len, sizeof(payload) - len, "%s[%lu,%u,%d]", records > 0 ? "," : "",
+                         (unsigned long)sample.ts, sample.probe, sample.temp);
+        if (n < 0 || len + n + 2 > sizeof(payload)) {   // Room for "]" and the terminator
+            break;
+        }
+        len += n;
+        records++;
+    }
+    payload[len++] = ']';
+    payload[len] = '\0';
+
+    int id = publish("samples", payload, len, false);
+    if (id < 0) {                                       // Outbox full, next loop
+        return;
+    }
+    lastBatchMs = millis();
+    batches++;
+    stateDue = true;
+    if (config.mqttQos == 0) {                          // Handed over, no ack to wait for
+        releaseBatch(records, fromOutbox);
+        return;
+    }
+    batchRecords = records;
+    batchStored = fromOutbox;
+    batchSentMs = millis();
+    batchId = id;
+    if (lastAcked.load() == id) {                       // PUBACK arrived before batchId was set
+        batchAcked = id;
+    }
+}
+
+// start the client (NORMAL mode, after the first Wi-Fi connect)
+void mqttBegin() {
+    if (!enabled) {
+        outboxBegin(stored, MQTT_OUTBOX_DIR);           // Samples of the last outage, published first
+    }
+    enabled = true;
+    if (client == nullptr) {
+        start();
+    }
+}
+
+// MQTT_* changed: reconnect with the new settings from loop()
+void mqttReconfigure() {
+    reconfigure = true;
+}
+
+// buffer a sample, the oldest move to the outbox (or are dropped) when the ring is full
+void mqttSample(uint8_t probe, int16_t temp) {
+    if (config.mqttHost[0] == '\0') {
+        return;
+    }
+    if (sampleCount == MQTT_BUFFER_SAMPLES && !storeSamples()) {
+        dropSamples(1);
+        dropped++;
+        if (batchRecords > 0) {                         // The dropped sample was part of the batch in flight
+            batchRecords--;
+        }
+    }
+    MqttSample &sample = samples[(sampleHead + sampleCount) % MQTT_BUFFER_SAMPLES];
+    sample.ms = millis();
+    sample.probe = probe;
+    sample.temp = temp;
+    sampleCount++;
+}
+
+// queue an alarm transition, the oldest is dropped when the queue is full
+void mqttAlarm(uint8_t probe, bool alarm, int16_t temp, int threshold) {
+    if (config.mqttHost[0] == '\0') {
+        return;
+    }
+    if (alarmCount == MQTT_ALARM_EVENTS) {
+        alarmHead = (alarmHead + 1) % MQTT_ALARM_EVENTS;
+        alarmCount--;
+        dropped++;
+    }
+    MqttAlarmEvent &event = alarms[(alarmHead + alarmCount) % MQTT_ALARM_EVENTS];
+    event.ms = millis();
+    event.probe = probe;
+    event.alarm = alarm;
+    event.temp = temp;
+    event.threshold = threshold;
+    alarmCount++;
+}
+
+// publish the health subset of /getsys, at most once per MQTT_HEALTH_INTERVAL_MS
+void mqttHealth(const JsonDocument &sys) {
+    if (client == nullptr || !connected || (healthSent && millis() - lastHealthMs < MQTT_HEALTH_INTERVAL_MS)) {
+        return;
+    }
+    JsonDocument filter;
+    responseFilter(MQTT_HEALTH_FIELDS, filter);
+    JsonDocument doc;
+    for (JsonPairConst field : filter.as<JsonObjectConst>()) {
+        JsonVariantConst value = sys[field.key()];
+        if (!value.isNull()) {
+            doc[field.key()] = value;
+        }
+    }
+    doc["uptime_s"] = millis() / 1000;
+    if (publishJson("sys", doc, true) >= 0) {
+        healthSent = true;
+        lastHealthMs = millis();
+    }
+}
+
+// publish due batches and alarm transitions, handle acks and reconnects
+void mqttLoop() {
+    if (reconfigure.exchange(false) && enabled) {
+        stop();
+        start();
+    }
+    if (client == nullptr) {
+        return;
+    }
+    if (!connected) {                                   // esp-mqtt sends an unacknowledged batch again itself
+        return;
+    }
+
+    if (announce.exchange(false)) {
+        batchSentMs = millis();                         // Give the resent batch the full ack timeout
+        publish("status", "online", 6, true);
+        publishDiscovery();
+        stateDue = true;
+        healthSent = false;                             // Health right away
+    }
+
+    while (alarmCount > 0 && publishAlarm(alarms[alarmHead])) {
+        alarmHead = (alarmHead + 1) % MQTT_ALARM_EVENTS;
+        alarmCount--;
+        stateDue = true;
+    }
+
+    if (batchId.load() >= 0) {
+        if (batchAcked.load() == batchId.load()) {
+            releaseBatch(batchRecords, batchStored);
+            batchId = -1;
+        } else if (millis() - batchSentMs >= MQTT_ACK_TIMEOUT_MS) {
+            batchId = -1;                               // Send again below
+            retries++;
+        }
+    }
+    bool due = outboxCount(stored) > 0 ? millis() - lastBatchMs >= MQTT_DRAIN_INTERVAL_MS :     // Stored samples first
+               (sampleCount >= MQTT_BATCH_RECORDS || (sampleCount > 0 && millis() - lastBatchMs >= (uint32_t)config.mqttBatch * 1000));
+    if (batchId.load() < 0 && due) {
+        publishBatch();
+    }
+
+    if (stateDue) {
+        stateDue = !publishState();
+    }
+}
+
+// add connection state and buffer counters
+void mqttStats(JsonDocument &sys) {
+    sys["mqtt_connected"] = connected.load();
+    sys["mqtt_connects"] = connects.load();
+    sys["mqtt_buffered"] = sampleCount;
+    sys["mqtt_samples_published"] = samplesPublished;
+    sys["mqtt_batches"] = batches;
+    sys["mqtt_retries"] = retries;
+    sys["mqtt_dropped"] = dropped;
+    sys["mqtt_stored"] = samplesStored;
+    outboxStats(stored, sys, "mqtt_outbox");
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// MQTT telemetry
+// ======================================================================
+// Publishes to the broker in MQTT_HOST (off while empty) with the
+// esp-mqtt client of the core, which connects, reconnects and sends
+// from its own task; loop() only enqueues, the sensing task is never
+// involved. Topics below MQTT_PREFIX:
+//
+//   <prefix>/samples  [[ts,sensor,temp_x10],...] batch every MQTT_BATCH s
+//   <prefix>/state    {"t":[..],"alarm":..} latest values (retained)
+//   <prefix>/alarm    last alarm transition (retained)
+//   <prefix>/sys      health subset of /getsys (retained)
+//   <prefix>/status   online/offline, offline is the last will (retained)
+//
+// Samples wait in a RAM ring while the broker is unreachable. When it is
+// full, the oldest are moved to an outbox on LittleFS (outbox.h) in
+// blocks of MQTT_STORED_SAMPLES, so a night without Wi-Fi survives a
+// reboot as well; they are dropped only while the clock is not set or
+// the outbox cannot be written. After a reconnect the stored blocks are
+// published first, one batch per MQTT_DRAIN_INTERVAL_MS, then the RAM
+// ring. A batch is removed only once the broker has acknowledged it
+// (QoS 1/2) or it was handed to the client (QoS 0). State, alarm and
+// health topics are retained latest values and are not stored; alarm
+// notifications have their own outbox (notify.h). Home Assistant
+// discovery configs are published on every connect below homeassistant/.
+
+#define MQTT_BUFFER_SAMPLES 1024                        // RAM ring (~2.8 h of one sensor at 10 s)
+#define MQTT_BATCH_RECORDS 64                           // Samples per message
+#define MQTT_OUTBOX_DIR "/mqtt_outbox"                  // Samples the RAM ring had no room for
+#define MQTT_STORED_SAMPLES 44                          // Samples per outbox record (7 bytes each)
+#define MQTT_DRAIN_INTERVAL_MS 1000                     // Stored batches at most once a second after a reconnect
+#define MQTT_ALARM_EVENTS 16                            // Alarm transitions waiting for the broker
+#define MQTT_PAYLOAD_MAX 1536                           // Longest payload (batch, discovery config)
+#define MQTT_ACK_TIMEOUT_MS 10000                       // Send a batch again if not acknowledged
+#define MQTT_HEALTH_INTERVAL_MS 60000                   // <prefix>/sys at most once a minute
+#define MQTT_KEEPALIVE_S 30
+#define MQTT_DISCOVERY_PREFIX "homeassistant"
+#define MQTT_HEALTH_FIELDS "RSSI,heap_free,heap_min_free,heap_largest_block,heap_fragmentation,wifi_reconnects," \
+                           "notify_sent,notify_failed,notify_stored,sensing_events_dropped,sampling_period_s"
+
+void mqttBegin();                                       // Start the client (NORMAL mode, after the first Wi-Fi connect)
+void mqttReconfigure();                                 // MQTT_* changed: reconnect with the new settings (any task)
+void mqttSample(uint8_t probe, int16_t temp);           // Buffer a sample in 1/10 °C (loop)
+void mqttAlarm(uint8_t probe, bool alarm, int16_t temp, int threshold);  // Queue an alarm transition (loop)
+void mqttHealth(const JsonDocument &sys);               // Publish the health subset, rate limited (loop)
+void mqttLoop();                                        // Publish due batches and alarm transitions, handle acks (loop)
+void mqttStats(JsonDocument &sys);                      // Add connection state and buffer counters
@@ -0,0 +1,108 @@
+#include "format_bench.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../config_store.h"
+#include "../probes.h"
+#include "../response_format.h"
+#include "../sensor.h"
+#include "sim.h"
+
+// mean duration of fn in µs
+template <typename Fn>
+static double meanUs(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FORMAT_BENCH_ITERATIONS; i++) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / FORMAT_BENCH_ITERATIONS;
+}
+
+// decode a payload like the poller
+static void parse(JsonDocument &doc, const std::vector<char> &payload, ResponseFormat format) {
+    if (format == FORMAT_MSGPACK) {
+        deserializeMsgPack(doc, payload.data(), payload.size());
+    } else {
+        deserializeJson(doc, payload.data(), payload.size());
+    }
+}
+
+// full document in one format, the way snapshotPublish() serializes it
+FormatBenchResult formatBenchFull(const JsonDocument &doc, ResponseFormat format) {
+    std::vector<char> payload(responseMeasure(doc, format) + 1);
+    FormatBenchResult result = {};
+    result.serializeUs = meanUs([&] { result.bytes = responseSerialize(doc, format, payload.data(), payload.size()); });
+    payload.resize(result.bytes);
+    result.parseUs = meanUs([&] { JsonDocument parsed; parse(parsed, payload, format); });
+    return result;
+}
+
+// ?fields= selection, the way snapshotSend() decodes it from the MessagePack copy
+FormatBenchResult formatBenchSelection(const JsonDocument &doc, const JsonDocument &filter, ResponseFormat format) {
+    std::vector<char> packed(measureMsgPack(doc) + 1);
+    packed.resize(serializeMsgPack(doc, packed.data(), packed.size()));
+    std::vector<char> payload(responseMeasure(doc, format) + 1);
+    FormatBenchResult result = {};
+    result.serializeUs = meanUs([&] {
+        JsonDocument part;
+        deserializeMsgPack(part, packed.data(), packed.size(), DeserializationOption::Filter(filter));
+        result.bytes = responseSerialize(part, format, payload.data(), payload.size());
+    });
+    payload.resize(result.bytes);
+    result.parseUs = meanUs([&] { JsonDocument parsed; parse(parsed, payload, format); });
+    return result;
+}
+
+// one table row
+static void printRow(const char *name, const char *format, const FormatBenchResult &r, size_t reference) {
+    printf("%-22s %-8s %8zu %7.0f%% %12.2f %10.2f\n", name, format, r.bytes, reference > 0 ? 100.0 * r.bytes / reference : 0,
+           r.serializeUs, r.parseUs);
+}
+
+// run --bench-formats with the other arguments
+int formatBenchMain(int argc, char **argv) {
+    uint8_t sensors = 1;
+    const char *fields = FORMAT_BENCH_FIELDS;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--sensors=", 10) == 0) { sensors = atoi(argv[i] + 10); continue; }
+        if (strncmp(argv[i], "--fields=", 9) == 0) { fields = argv[i] + 9; continue; }
+    }
+
+    simPutFile(CONFIG_FILE, "{\"TARGET_TEMP\":7,\"HYSTERESIS\":2,\"REMINDER\":30}");
+    configLoad(config, "native");
+    simSetSensorCount(sensors);
+    for (uint8_t i = 0; i < sensors; i++) {
+        simSetSensorTemperature(i, 3.5f + 0.5f * i);
+    }
+    sensorBegin(config.sensorResolution);
+    probesBegin();
+    float tempC;
+    simAdvance(sensorStart());
+    while (sensorPoll(tempC) == SENSOR_CONVERTING) {
+        simAdvance(10);
+    }
+    probesUpdate();
+    config.fridgeTemp = tempC;
+
+    JsonDocument doc;                                   // Same content as buildData()
+    configToJson(config, doc, 0, CFG_SECRET);
+    probesToJson(doc);
+    JsonDocument filter;
+    if (!responseFilter(fields, filter)) {
+        fprintf(stderr, "❌ No keys in --fields=%s\n", fields);
+        return 2;
+    }
+
+    fprintf(stderr, "⏱️  /getdata with %u sensor(s), mean of %d runs\n", sensors, FORMAT_BENCH_ITERATIONS);
+    printf("%-22s %-8s %8s %8s %12s %10s\n", "response", "format", "bytes", "size", "serialize_us", "parse_us");
+    FormatBenchResult json = formatBenchFull(doc, FORMAT_JSON);
+    std::string selection = std::string("fields=") + fields;
+    printRow("/getdata", "json", json, json.bytes);
+    printRow("/getdata", "msgpack", formatBenchFull(doc, FORMAT_MSGPACK), json.bytes);
+    printRow(selection.c_str(), "json", formatBenchSelection(doc, filter, FORMAT_JSON), json.bytes);
+    printRow(selection.c_str(), "msgpack", formatBenchSelection(doc, filter, FORMAT_MSGPACK), json.bytes);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// ======================================================================
+// Response format benchmark
+// ======================================================================
+// Builds the /getdata document like the firmware (config without
+// secrets + sensor table) and reports payload size, serialize time on
+// the device side and parse time on the poller side for JSON and
+// MessagePack, with and without a ?fields= selection. A selection is
+// served by decoding the MessagePack copy of the snapshot with a
+// filter, so its serialize time includes that decode.
+//
+//   .pio/build/native/program --bench-formats --sensors=8
+//   .pio/build/native/program --bench-formats --fields=FRIDGE_TEMP,ALARM,TREND
+
+#include <ArduinoJson.h>
+#include "../response_format.h"
+
+#define FORMAT_BENCH_ITERATIONS 2000                    // Runs per measurement, the mean is reported
+#define FORMAT_BENCH_FIELDS "FRIDGE_TEMP,ALARM"         // Default --fields= selection
+
+struct FormatBenchResult {
+    size_t bytes;                                       // Payload size
+    double serializeUs;                                 // Device: build the response body
+    double parseUs;                                     // Poller: decode it
+};
+
+FormatBenchResult formatBenchFull(const JsonDocument &doc, ResponseFormat format);     // Whole document, like snapshotPublish()
+FormatBenchResult formatBenchSelection(const JsonDocument &doc, const JsonDocument &filter, ResponseFormat format);   // ?fields=, like snapshotSend()
+int formatBenchMain(int argc, char **argv);             // Run --bench-formats with the other arguments, returns the exit code
@@ -0,0 +1,204 @@
+#include "../hal.h"
+#include "sim.h"
+#include <map>
+#include <set>
+#include <cstring>
+
+// ======================================================================
+// Simulated state
+// ======================================================================
+
+static uint32_t virtualMs = 0;                          // Virtual clock
+static uint32_t epochBase = 0;                          // Wall clock at epochSetMs, 0 = not set
+static uint32_t epochSetMs = 0;
+static float sensorTemp[8] = { 4.0f, 4.0f, 4.0f, 4.0f, 4.0f, 4.0f, 4.0f, 4.0f };  // Temperatures of the simulated DS18B20s
+static uint8_t sensorCount = 1;                         // DS18B20s on the simulated bus
+static bool sensorConnected = true;                     // Probe connected
+static bool sensorStalled = false;                      // Conversions never complete
+static uint8_t sensorResolution = 12;                   // Resolution of the simulated DS18B20
+static uint32_t conversionStart = 0;                    // Virtual time of the last conversion request
+static float convertedTemp[8];                          // Results of the last conversion
+static bool converted = false;                          // A conversion has been requested
+static int httpResponse = 200;                          // Response code of the simulated endpoint
+static std::vector<std::string> httpLog;                // URLs posted so far
+static std::map<std::string, std::string> files;        // In-memory filesystem
+static std::set<std::string> dirs;                      // Directories of the in-memory filesystem
+static bool filesFull = false;                          // Writes fail
+static std::map<uint8_t, bool> pins;                    // GPIO levels
+
+void simAdvance(uint32_t ms) { virtualMs += ms; }
+void simSetEpoch(uint32_t epoch) { epochBase = epoch; epochSetMs = virtualMs; }
+void simSetTemperature(float tempC) { sensorTemp[0] = tempC; }
+void simSetSensorCount(uint8_t count) { sensorCount = count < 8 ? count : 8; }
+void simSetSensorTemperature(uint8_t index, float tempC) { if (index < 8) { sensorTemp[index] = tempC; } }
+void simSetSensorConnected(bool connected) { sensorConnected = connected; }
+void simSetSensorStalled(bool stalled) { sensorStalled = stalled; }
+void simSetHttpResponse(int code) { httpResponse = code; }
+void simPutFile(const char *path, const std::string &content) { files[path] = content; }
+std::string simGetFile(const char *path) { return files.count(path) ? files[path] : std::string(); }
+void simSetFileFull(bool full) { filesFull = full; }
+void simClearFiles() { files.clear(); dirs.clear(); }
+const std::vector<std::string> &simHttpLog() { return httpLog; }
+bool simPinLevel(uint8_t pin) { return pins[pin]; }
+
+// ======================================================================
+// Clock
+// ======================================================================
+
+uint32_t halMillis() {
+    return virtualMs;
+}
+
+uint32_t halMicros() {
+    return virtualMs * 1000;
+}
+
+uint32_t halEpoch() {
+    return epochBase != 0 ? epochBase + (virtualMs - epochSetMs) / 1000 : 0;
+}
+
+void halDelay(uint32_t ms) {
+    virtualMs += ms;
+}
+
+// ======================================================================
+// DS18B20 sensor bus (rounds to the resolution like the real chip)
+// ======================================================================
+
+uint8_t halSensorBegin(uint8_t resolution) {
+    sensorResolution = resolution;
+    return sensorConnected ? sensorCount : 0;
+}
+
+bool halSensorAddress(uint8_t index, uint8_t address[8]) {
+    static const uint8_t rom[8] = { 0x28, 0xff, 0x64, 0x1e, 0x00, 0x00, 0x00, 0x00 };
+    memcpy(address, rom, 8);
+    address[6] = index;                                 // Unique per simulated sensor
+    address[7] = 0x5a ^ index;
+    return index < sensorCount;
+}
+
+void halSensorSetResolution(uint8_t resolution) {
+    sensorResolution = resolution;
+}
+
+uint32_t halSensorConversionMs(uint8_t resolution) {
+    return 750 / (1 << (12 - resolution));
+}
+
+void halSensorRequest() {
+    float step = 0.0625f * (1 << (12 - sensorResolution));
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        convertedTemp[i] = (int)(sensorTemp[i] / step) * step;
+    }
+    conversionStart = virtualMs;
+    converted = true;
+}
+
+bool halSensorComplete() {
+    return converted && !sensorStalled && virtualMs - conversionStart >= halSensorConversionMs(sensorResolution);
+}
+
+bool halSensorRead(const uint8_t address[8], float &tempC) {
+    uint8_t index = address[6];
+    bool present = sensorConnected && index < sensorCount;
+    tempC = present ? convertedTemp[index] : -127.0f;
+    return present;
+}
+
+// ======================================================================
+// GPIO
+// ======================================================================
+
+void halPinWrite(uint8_t pin, bool level) {
+    pins[pin] = level;
+}
+
+bool halPinRead(uint8_t pin) {
+    return pins[pin];
+}
+
+// ======================================================================
+// Filesystem (in memory)
+// ======================================================================
+
+bool halFileExists(const char *path) {
+    return files.count(path) > 0;
+}
+
+size_t halFileRead(const char *path, char *buffer, size_t maxLen) {
+    if (!files.count(path)) {
+        return 0;
+    }
+    const std::string &content = files[path];
+    size_t len = content.size() < maxLen ? content.size() : maxLen;
+    memcpy(buffer, content.data(), len);
+    return len;
+}
+
+size_t halFileWrite(const char *path, const char *data, size_t len) {
+    if (filesFull) {
+        return 0;
+    }
+    files[path] = std::string(data, len);
+    return len;
+}
+
+bool halFileRename(const char *from, const char *to) {
+    if (!files.count(from)) {
+        return false;
+    }
+    files[to] = files[from];
+    files.erase(from);
+    return true;
+}
+
+bool halFileRemove(const char *path) {
+    return files.erase(path) > 0;
+}
+
+size_t halFileSize(const char *path) {
+    return files.count(path) ? files[path].size() : 0;
+}
+
+size_t halFileReadAt(const char *path, size_t offset, char *buffer, size_t maxLen) {
+    if (!files.count(path) || offset > files[path].size()) {
+        return 0;
+    }
+    return files[path].copy(buffer, maxLen, offset);
+}
+
+size_t halFileAppend(const char *path, const char *data, size_t len) {
+    if (filesFull) {
+        return 0;
+    }
+    files[path].append(data, len);
+    return len;
+}
+
+bool halDirCreate(const char *path) {
+    dirs.insert(path);
+    return true;
+}
+
+bool halDirList(const char *path, void (*visit)(const char *name, void *context), void *context) {
+    if (!dirs.count(path)) {
+        return false;
+    }
+    std::string prefix = std::string(path) + "/";
+    for (const auto &file : files) {
+        if (file.first.compare(0, prefix.size(), prefix) == 0 && file.first.find('/', prefix.size()) == std::string::npos) {
+            visit(file.first.c_str() + prefix.size(), context);
+        }
+    }
+    return true;
+}
+
+// ======================================================================
+// HTTP
+// ======================================================================
+
+int halHttpPost(const char *url) {
+    httpLog.push_back(url);
+    return httpResponse;
+}
@@ -0,0 +1,259 @@
+// ======================================================================
+// Native simulation of the alarm logic
+// ======================================================================
+// Runs the portable firmware logic (config file handling, /getdata
+// parameter coercion, non-blocking sensor state machine, alarm
+// hysteresis, trend pre-alarm) on Linux against the simulated DS18B20
+// and virtual clock.
+//
+//   pio run -e native -t exec                        (default scenario)
+//   .pio/build/native/program TARGET_TEMP=7 HYSTERESIS=1 --hours=12
+//   .pio/build/native/program --sensors=3 SENSOR_2_TARGET=3     (failure on sensor 1 only)
+//   .pio/build/native/program PRE_ALARM=30                      (pre-alarm lead time)
+//   .pio/build/native/program SAMPLE_MIN=10 SAMPLE_MAX=10       (fixed period, compare samples and alarm times)
+//   .pio/build/native/program --replay=history.csv TARGET_TEMP=6:9 HYSTERESIS=1,2   (recorded trace, see replay.h)
+//   .pio/build/native/program --bench-formats --sensors=8                (JSON/MessagePack sizes, see format_bench.h)
+//   .pio/build/native/program 'RULES=[{"when":"above","temp":10,"for":300}]'   (alarm rules, see rules.h)
+//   .pio/build/native/program --bench-rules --rules=8 --sensors=4        (rule evaluation time, see rules_bench.h)
+
+#include <ArduinoJson.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "../alarm.h"
+#include "../config_store.h"
+#include "../probes.h"
+#include "../rules.h"
+#include "../sampling.h"
+#include "../sensor.h"
+#include "../trend.h"
+#include "../hal.h"
+#include "sim.h"
+#include "replay.h"
+#include "format_bench.h"
+#include "rules_bench.h"
+
+#define VERSION "native"
+#define PIN_ALARM_OUTPUT 32                             // IO32 for LED green
+
+// Fridge temperature over time: stable, compressor failure, recovery
+static float scenarioTemp(uint32_t ms) {
+    float minutes = ms / 60000.0f;
+    float noise = 0.2f * sinf(minutes / 3.0f);
+    if (minutes < 60) { return 4.0f + noise; }                                      // Stable
+    if (minutes < 240) { return 4.0f + 0.05f * (minutes - 60) + noise; }            // Compressor failure
+    return fmaxf(4.0f, 13.0f - 0.1f * (minutes - 240)) + noise;                     // Recovery
+}
+
+// print virtual time as hh:mm:ss
+static const char *clockText(uint32_t ms) {
+    static char text[16];
+    uint32_t s = ms / 1000;
+    snprintf(text, sizeof(text), "%02u:%02u:%02u", s / 3600, (s / 60) % 60, s % 60);
+    return text;
+}
+
+// simulated notification, same URL layout as the dispatcher
+static void notify(const char *text) {
+    if (!config.notification) {
+        return;
+    }
+    char url[512];
+    snprintf(url, sizeof(url), "%s?phone=%s&apikey=%s&text=%s", config.notifyUrl, config.phoneNumber1, config.apiKey1, text);
+    int code = halHttpPost(url);
+    printf("%s  📦 notification (HTTP %d): %s\n", clockText(halMillis()), code, text);
+}
+
+#ifndef PIO_UNIT_TESTING                                 // pio test -e native links test/test_native instead
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {                    // Recorded trace or benchmark instead of the scenario
+        if (strncmp(argv[i], "--replay=", 9) == 0) {
+            return replayMain(argc, argv);
+        }
+        if (strcmp(argv[i], "--bench-formats") == 0) {
+            return formatBenchMain(argc, argv);
+        }
+        if (strcmp(argv[i], "--bench-rules") == 0) {
+            return rulesBenchMain(argc, argv);
+        }
+    }
+
+    uint32_t hours = 6;
+    uint8_t sensors = 1;
+
+    std::string initial = "{\"TARGET_TEMP\":7,\"HYSTERESIS\":2,\"REMINDER\":30,\"NOTIFICATION\":true}";
+    std::ifstream file("config.json");                  // Project config as initial file content
+    if (file) {
+        std::stringstream content;
+        content << file.rdbuf();
+        initial = content.str();
+    }
+    simPutFile(CONFIG_FILE, initial);
+
+    configLoad(config, VERSION);
+
+    for (int i = 1; i < argc; i++) {                    // NAME=VALUE like /getdata parameters
+        if (strncmp(argv[i], "--hours=", 8) == 0) {
+            hours = atoi(argv[i] + 8);
+            continue;
+        }
+        if (strncmp(argv[i], "--sensors=", 10) == 0) {
+            sensors = atoi(argv[i] + 10);
+            simSetSensorCount(sensors);
+            continue;
+        }
+        const char *eq = strchr(argv[i], '=');
+        if (eq == nullptr) {
+            continue;
+        }
+        std::string name(argv[i], eq - argv[i]);
+        if (configApplyParam(name.c_str(), eq + 1)) {
+            printf("⚙️  %s = %s\n", name.c_str(), eq + 1);
+        }
+    }
+
+    char buffer[CONFIG_FILE_MAX];                       // Round trip through the config file
+    configSave(buffer, configSerialize(config, buffer, sizeof(buffer)));
+    configLoad(config, VERSION);
+
+    sensorBegin(config.sensorResolution);
+    probesBegin();
+    for (int i = 1; i < argc; i++) {                    // SENSOR_<n>_... need the sensor table
+        const char *eq = strchr(argv[i], '=');
+        std::string name(argv[i], eq != nullptr ? eq - argv[i] : 0);
+        if (eq != nullptr && probesApplyParam(name.c_str(), eq + 1)) {
+            printf("⚙️  %s = %s\n", name.c_str(), eq + 1);
+        }
+    }
+    probesCommitNow();                                  // Round trip through /sensors.json
+    probesBegin();
+    rulesBegin();
+    for (int i = 1; i < argc; i++) {                    // RULES=[...] compiled for the sensor table
+        const char *eq = strchr(argv[i], '=');
+        std::string name(argv[i], eq != nullptr ? eq - argv[i] : 0);
+        if (eq != nullptr && rulesApplyParam(name.c_str(), eq + 1)) {
+            printf("⚙️  %s = %s\n", name.c_str(), eq + 1);
+        }
+    }
+    rulesLoop();                                        // Round trip through /rules.json
+    rulesBegin();
+
+    int targetTemp = config.targetTemp;
+    int hysteresis = config.hysteresis;
+    uint32_t reminderMs = config.reminder * 60000;
+    bool alarm = false;                                 // Any sensor in alarm (alarm output, reminder)
+    uint32_t alarms = 0;
+    bool preAlarm = false;
+    uint32_t preAlarms = 0;
+    uint32_t preAlarmAt = 0;                            // Virtual time of the last pre-alarm
+    float leadMinutes = 0;                              // Pre-alarm ahead of the alarm
+    Trend trend;
+    trendReset(trend);
+    AlarmReminder reminder = {};
+    uint32_t samples = 0;
+    uint32_t end = hours * 3600000;
+
+    printf("🌡️ Simulating %u h: TARGET_TEMP=%d HYSTERESIS=%d REMINDER=%u min\n", hours, targetTemp, hysteresis, reminderMs / 60000);
+
+    while (halMillis() < end) {
+        uint32_t tick = halMillis();
+        simSetTemperature(scenarioTemp(tick));
+        for (uint8_t i = 1; i < sensors; i++) {         // The other display cases stay cold
+            simSetSensorTemperature(i, 3.0f + 0.5f * i + 0.1f * sinf(tick / 180000.0f + i));
+        }
+
+        float tempC;
+        simAdvance(sensorStart());                      // Conversion_timer fires after the conversion time
+        SensorState state;
+        while ((state = sensorPoll(tempC)) == SENSOR_CONVERTING) {
+            simAdvance(10);
+        }
+
+        char text[128];
+        if (state == SENSOR_READY) {
+            samples++;
+            trendAdd(trend, halMillis(), tempC);
+            float eta = trendMinutesTo(trend, config.targetTemp);
+            if (preAlarmEvaluate(preAlarm, eta, config.preAlarm, config.preAlarmHysteresis) == ALARM_RAISED) {
+                preAlarms++;
+                preAlarmAt = halMillis();
+                float slope = 0;
+                trendSlope(trend, slope);
+                printf("%s  ⏳ PRE-ALARM at %.1f °C, %+.2f °C/min, target in %.0f min\n", clockText(halMillis()), tempC, slope, eta);
+                snprintf(text, sizeof(text), "VORALARM: Temperatur steigt um %.2f°C/min, Schwellwert %d°C in ca. %.0f Minuten", slope, config.targetTemp, eta);
+                notify(text);
+            }
+        }
+        probesUpdate();
+
+        bool anyAlarm = false;
+        RuleInput inputs[SENSOR_MAX];
+        for (uint8_t i = 0; i < probesCount(); i++) {
+            Probe probe;
+            AlarmEvent event = probesEvaluate(i, probe);
+            inputs[i] = {probe.temp, probe.online};
+            float probeTemp = probe.temp / 10.0f;
+            if (event == ALARM_RAISED) {
+                alarms++;
+                if (preAlarm && i == 0) {
+                    leadMinutes = (halMillis() - preAlarmAt) / 60000.0f;
+                }
+                printf("%s  🚨 ALARM raised at %.1f °C (%s)\n", clockText(halMillis()), probeTemp, probe.name);
+                snprintf(text, sizeof(text), "ALARM: %s Temperatur %.1f°C (Schwellwert: %d°C)", probe.name, probeTemp, probesTarget(probe));
+                notify(text);
+            } else if (event == ALARM_CLEARED) {
+                printf("%s  ✅ ALARM cleared at %.1f °C (%s)\n", clockText(halMillis()), probeTemp, probe.name);
+            }
+            anyAlarm |= probe.alarm;
+        }
+        alarm = anyAlarm;
+
+        RuleEvent ruleEvents[RULES_EVENTS_MAX];         // Same evaluation as the sensing task
+        uint8_t ruleCount = rulesEvaluate(inputs, probesCount(), halMillis(), ruleEvents, RULES_EVENTS_MAX);
+        for (uint8_t i = 0; i < ruleCount; i++) {
+            static const char *const names[] = {"raised", "cleared", "reminder"};
+            RuleDef def;
+            Probe probe;
+            rulesGet(ruleEvents[i].rule, ruleEvents[i].generation, def);
+            probesGet(ruleEvents[i].probe, probe);
+            printf("%s  📏 Rule %s %s at %.1f °C (%s)\n", clockText(halMillis()), def.name, names[ruleEvents[i].type],
+                   ruleEvents[i].temp / 10.0f, probe.name);
+            if (ruleEvents[i].type != RULE_CLEARED && def.severity != RULE_INFO &&
+                rulesFormat(def, ruleEvents[i], probe.name, text, sizeof(text)) > 0) {
+                notify(text);
+            }
+        }
+        alarmReminderUpdate(reminder, alarm, halMillis(), reminderMs);
+        halPinWrite(PIN_ALARM_OUTPUT, alarm);
+
+        if (alarmReminderDue(reminder, halMillis(), reminderMs)) {      // Same schedule as loop()
+            snprintf(text, sizeof(text), "Erinnerung: immer noch zu warm");
+            notify(text);
+        }
+
+        float slope = 0;                                // Same period as the sensing task
+        trendSlope(trend, slope);
+        uint32_t periodMs = samplingProbesPeriodMs(slope, config.sampleMin * 1000, config.sampleMax * 1000);
+        samplingRecord(tick, periodMs, halMillis() - tick);
+        simAdvance(tick + periodMs - halMillis());      // Next sample
+    }
+
+    JsonDocument stats;
+    sensorStats(stats);
+    probesToJson(stats);
+    stats["samples"] = samples;
+    samplingStats(stats);
+    stats["alarms"] = alarms;
+    stats["pre_alarms"] = preAlarms;
+    stats["pre_alarm_lead_min"] = roundf(leadMinutes * 10) / 10;
+    rulesStats(stats);
+    stats["notifications"] = simHttpLog().size();
+    stats["alarm_output"] = simPinLevel(PIN_ALARM_OUTPUT);
+    serializeJsonPretty(stats, std::cout);
+    std::cout << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,288 @@
+#include "replay.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../alarm.h"
+#include "../config_store.h"
+#include "../trend.h"
+#include "sim.h"
+
+struct TraceSample {
+    uint32_t ms;                                        // Virtual time since the first sample
+    float temp;
+};
+
+struct Excursion {
+    uint32_t startMs;                                   // First sample above the reference
+    uint32_t endMs;                                     // Last sample above the reference
+};
+
+// Swept parameter: NAME and its values as /getdata strings
+struct Sweep {
+    std::string name;
+    std::vector<std::string> values;
+};
+
+struct ReplayResult {
+    uint32_t alarms = 0;                                // Alarm output raised
+    double alarmMinutes = 0;                            // Time with the alarm output on
+    uint32_t notifications = 0;                         // Alarm, reminder and pre-alarm messages
+    uint32_t reminders = 0;
+    uint32_t preAlarms = 0;                             // Pre-alarm messages (not sent while the alarm is out)
+    uint32_t excursions = 0;                            // Reference excursions
+    uint32_t detected = 0;                              // ... with a warning
+    uint32_t falseAlarms = 0;                           // Alarm episodes outside every excursion
+    double delaySum = 0;                                // Detection delay in minutes, negative = warned ahead
+    double delayMax = 0;
+    uint32_t chatter = 0;                               // Re-raised shortly after a clear
+    uint32_t shortAlarms = 0;                           // Episodes shorter than --min-excursion
+};
+
+// read timestamp,temp_c lines, skips the header and anything unparsable
+static bool loadTrace(const char *path, std::vector<TraceSample> &trace) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    bool first = true;
+    uint32_t firstTs = 0, lastTs = 0;
+    while (std::getline(file, line)) {
+        char *end;
+        unsigned long ts = strtoul(line.c_str(), &end, 10);
+        if (end == line.c_str() || *end != ',') {
+            continue;
+        }
+        float temp = strtof(end + 1, nullptr);
+        if (!first && ts <= lastTs) {                   // Keep the clock monotonic
+            continue;
+        }
+        if (first) {
+            firstTs = ts;
+            first = false;
+        }
+        lastTs = ts;
+        if (ts - firstTs > UINT32_MAX / 1000) {         // millis() wraps after 49 days
+            fprintf(stderr, "⚠️  Trace cut after 49 days\n");
+            break;
+        }
+        trace.push_back({ (uint32_t)(ts - firstTs) * 1000, temp });
+    }
+    return !trace.empty();
+}
+
+// values of a sweep argument: a,b,c or lo:hi[:step]
+static std::vector<std::string> sweepValues(const char *text) {
+    std::vector<std::string> values;
+    double lo, hi, step = 1;
+    if (strchr(text, ':') != nullptr && sscanf(text, "%lf:%lf:%lf", &lo, &hi, &step) >= 2 && step > 0) {
+        for (double v = lo; v <= hi + step / 1000; v += step) {
+            char value[24];
+            snprintf(value, sizeof(value), "%g", v);
+            values.push_back(value);
+        }
+        return values;
+    }
+    std::stringstream list(text);
+    std::string value;
+    while (std::getline(list, value, ',')) {
+        values.push_back(value);
+    }
+    return values;
+}
+
+// runs above the reference lasting at least minMs
+static std::vector<Excursion> findExcursions(const std::vector<TraceSample> &trace, float reference, uint32_t minMs) {
+    std::vector<Excursion> excursions;
+    bool above = false;
+    Excursion current = {};
+    for (const TraceSample &sample : trace) {
+        if (sample.temp > reference && !above) {
+            above = true;
+            current.startMs = sample.ms;
+        }
+        if (sample.temp > reference) {
+            current.endMs = sample.ms;
+        } else if (above) {
+            above = false;
+            if (current.endMs - current.startMs >= minMs) {
+                excursions.push_back(current);
+            }
+        }
+    }
+    if (above && current.endMs - current.startMs >= minMs) {
+        excursions.push_back(current);
+    }
+    return excursions;
+}
+
+// one pass over the trace with the current config, same order as loop()
+static ReplayResult replay(const std::vector<TraceSample> &trace, float reference, uint32_t minExcursionMs, uint32_t chatterMs) {
+    ReplayResult result;
+    uint32_t reminderMs = config.reminder * 60000;
+    bool alarm = false;
+    bool preAlarm = false;
+    AlarmReminder reminder = {};
+    Trend trend;
+    trendReset(trend);
+
+    std::vector<uint32_t> warnings;                     // Alarm and pre-alarm notifications
+    std::vector<Excursion> episodes;                    // Alarm output on .. off
+    uint32_t raisedMs = 0;
+    uint32_t clearedMs = 0;
+    bool clearedOnce = false;
+
+    for (const TraceSample &sample : trace) {
+        while (reminder.running && (int32_t)(sample.ms - reminder.nextMs) >= 0) {  // Reminders due before this sample
+            alarmReminderDue(reminder, reminder.nextMs, reminderMs);
+            result.reminders++;
+        }
+
+        trendAdd(trend, sample.ms, sample.temp);        // processTemp()
+        float eta = trendMinutesTo(trend, config.targetTemp);
+
+        if (alarmEvaluate(alarm, roundf(sample.temp * 10) / 10.0f, config.targetTemp, config.hysteresis) == ALARM_RAISED) {
+            warnings.push_back(sample.ms);              // Alarm notification
+        }
+        if (preAlarmEvaluate(preAlarm, eta, config.preAlarm, config.preAlarmHysteresis) == ALARM_RAISED && !alarm) {
+            warnings.push_back(sample.ms);
+            result.preAlarms++;
+        }
+
+        AlarmEvent output = alarmReminderUpdate(reminder, alarm, sample.ms, reminderMs);
+        if (output == ALARM_RAISED) {
+            result.alarms++;
+            raisedMs = sample.ms;
+            if (clearedOnce && sample.ms - clearedMs < chatterMs) {
+                result.chatter++;
+            }
+        } else if (output == ALARM_CLEARED) {
+            episodes.push_back({ raisedMs, sample.ms });
+            clearedMs = sample.ms;
+            clearedOnce = true;
+        }
+    }
+    if (alarm) {                                        // Still on at the end of the trace
+        episodes.push_back({ raisedMs, trace.back().ms });
+    }
+    result.notifications = warnings.size() + result.reminders;
+
+    std::vector<Excursion> excursions = findExcursions(trace, reference, minExcursionMs);
+    uint32_t leadMs = config.preAlarm > 0 ? (config.preAlarm + config.preAlarmHysteresis) * 60000 : 0;
+    result.excursions = excursions.size();
+    for (const Excursion &excursion : excursions) {     // Earliest warning from the lead window until the end
+        for (uint32_t at : warnings) {
+            if (at + leadMs >= excursion.startMs && at <= excursion.endMs) {
+                double delay = ((double)at - excursion.startMs) / 60000;
+                result.detected++;
+                result.delaySum += delay;
+                result.delayMax = result.detected == 1 ? delay : fmax(result.delayMax, delay);
+                break;
+            }
+        }
+    }
+    for (const Excursion &episode : episodes) {
+        result.alarmMinutes += (episode.endMs - episode.startMs) / 60000.0;
+        if (episode.endMs - episode.startMs < minExcursionMs) {
+            result.shortAlarms++;
+        }
+        bool overlaps = false;
+        for (const Excursion &excursion : excursions) {
+            overlaps |= episode.startMs <= excursion.endMs && excursion.startMs <= episode.endMs;
+        }
+        result.falseAlarms += !overlaps;
+    }
+    return result;
+}
+
+// run --replay=<file> with the other arguments
+int replayMain(int argc, char **argv) {
+    const char *path = nullptr;
+    float reference = NAN;
+    uint32_t minExcursionMs = REPLAY_MIN_EXCURSION_MIN * 60000;
+    uint32_t chatterMs = REPLAY_CHATTER_MIN * 60000;
+    std::vector<Sweep> sweeps;
+
+    std::string initial = "{\"TARGET_TEMP\":7,\"HYSTERESIS\":2,\"REMINDER\":30}";
+    std::ifstream file("config.json");                  // Project config as the base set
+    if (file) {
+        std::stringstream content;
+        content << file.rdbuf();
+        initial = content.str();
+    }
+    simPutFile(CONFIG_FILE, initial);
+    configLoad(config, "native");
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--replay=", 9) == 0) { path = argv[i] + 9; continue; }
+        if (strncmp(argv[i], "--reference=", 12) == 0) { reference = atof(argv[i] + 12); continue; }
+        if (strncmp(argv[i], "--min-excursion=", 16) == 0) { minExcursionMs = atoi(argv[i] + 16) * 60000; continue; }
+        if (strncmp(argv[i], "--chatter=", 10) == 0) { chatterMs = atoi(argv[i] + 10) * 60000; continue; }
+        const char *eq = strchr(argv[i], '=');
+        if (eq == nullptr) {
+            continue;
+        }
+        Sweep sweep = { std::string(argv[i], eq - argv[i]), sweepValues(eq + 1) };
+        if (configFind(sweep.name.c_str()) < 0 || sweep.values.empty()) {
+            fprintf(stderr, "❌ Unknown parameter or no values: %s\n", argv[i]);
+            return 2;
+        }
+        if (sweep.values.size() == 1) {                 // Fixed for all sets
+            configApplyParam(sweep.name.c_str(), sweep.values[0].c_str());
+        } else {
+            sweeps.push_back(sweep);
+        }
+    }
+
+    std::vector<TraceSample> trace;
+    if (path == nullptr || !loadTrace(path, trace)) {
+        fprintf(stderr, "❌ No samples in trace %s\n", path != nullptr ? path : "(none)");
+        return 1;
+    }
+
+    size_t sets = 1;
+    for (const Sweep &sweep : sweeps) {
+        sets *= sweep.values.size();
+        if (sets > REPLAY_MAX_SETS) {
+            fprintf(stderr, "❌ More than %d parameter sets\n", REPLAY_MAX_SETS);
+            return 2;
+        }
+    }
+    double traceHours = trace.back().ms / 3600000.0;
+    fprintf(stderr, "🎞️  Replaying %zu samples (%.1f h) with %zu parameter sets\n", trace.size(), traceHours, sets);
+
+    printf("TARGET_TEMP,HYSTERESIS,REMINDER,PRE_ALARM,PRE_ALARM_HYSTERESIS,alarms,alarm_min,notifications,reminders,pre_alarms,"
+           "excursions,detected,missed,false_alarms,delay_mean_min,delay_max_min,chatter,short_alarms\n");
+
+    AppConfig base = config;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t set = 0; set < sets; set++) {
+        config = base;
+        size_t index = set;                             // Mixed-radix digits select one value per sweep
+        for (const Sweep &sweep : sweeps) {
+            configApplyParam(sweep.name.c_str(), sweep.values[index % sweep.values.size()].c_str());
+            index /= sweep.values.size();
+        }
+
+        float setReference = std::isnan(reference) ? config.targetTemp : reference;
+        ReplayResult r = replay(trace, setReference, minExcursionMs, chatterMs);
+        printf("%d,%d,%d,%d,%d,%u,%.1f,%u,%u,%u,%u,%u,%u,%u,", config.targetTemp, config.hysteresis, config.reminder,
+               config.preAlarm, config.preAlarmHysteresis, r.alarms, r.alarmMinutes, r.notifications, r.reminders, r.preAlarms,
+               r.excursions, r.detected, r.excursions - r.detected, r.falseAlarms);
+        if (r.detected > 0) {
+            printf("%.1f,%.1f,", r.delaySum / r.detected, r.delayMax);
+        } else {
+            printf(",,");
+        }
+        printf("%u,%u\n", r.chatter, r.shortAlarms);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "⏱️  %.3f s, %.0fx real time\n", seconds, seconds > 0 ? traceHours * 3600 * sets / seconds : 0);
+    return 0;
+}
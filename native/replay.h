@@ -0,0 +1,22 @@
+#pragma once
+
+// ======================================================================
+// Trace replay
+// ======================================================================
+// Replays a recorded temperature trace (the /history CSV export:
+// timestamp,temp_c) through the alarm hysteresis, trend pre-alarm and
+// reminder schedule of loop() under a virtual clock taken from the
+// trace, once per parameter set. NAME=a,b,c or NAME=lo:hi[:step] sweeps
+// a parameter, every combination is run. One CSV line per set with
+// alarms, detection delay, notifications and chattering; the reference
+// excursions are the runs above --reference (default: TARGET_TEMP of
+// the set) lasting at least --min-excursion minutes.
+//
+//   .pio/build/native/program --replay=history.csv TARGET_TEMP=6:9 HYSTERESIS=1,2,3 REMINDER=30,60
+//   .pio/build/native/program --replay=history.csv --reference=8 PRE_ALARM=0,15,30 --chatter=30
+
+#define REPLAY_MIN_EXCURSION_MIN 5                      // Default --min-excursion: shorter runs above the reference are noise
+#define REPLAY_CHATTER_MIN 30                           // Default --chatter: re-raised within 30 min of a clear
+#define REPLAY_MAX_SETS 10000                           // Upper limit for the sweep product
+
+int replayMain(int argc, char **argv);                  // Run --replay=<file> with the other arguments, returns the exit code
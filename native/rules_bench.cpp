@@ -0,0 +1,148 @@
+#include "rules_bench.h"
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "../rules.h"
+#include "../sensor.h"
+
+struct BenchResult {
+    uint8_t entries;                                    // Rule x sensor pairs evaluated per sample
+    double evalNs;                                      // One sample of all sensors
+    uint32_t events;                                    // Raised/cleared/reminders over all runs
+};
+
+static volatile uint32_t sink;                          // Keeps the JSON baseline from being optimized away
+
+// deterministic trace: random walk between 2 and 12 °C per sensor, 1 % failed readings
+static std::vector<RuleInput> makeTrace(uint8_t sensors) {
+    std::vector<RuleInput> trace(RULES_BENCH_TRACE * sensors);
+    std::vector<int> temps(sensors, 60);
+    uint32_t seed = 12345;
+    for (size_t s = 0; s < RULES_BENCH_TRACE; s++) {
+        for (uint8_t p = 0; p < sensors; p++) {
+            seed = seed * 1103515245u + 12345u;
+            int temp = temps[p] + (int)((seed >> 16) % 7) - 3;
+            temps[p] = temp < 20 ? 20 : (temp > 120 ? 120 : temp);
+            trace[s * sensors + p] = {(int16_t)temps[p], (seed >> 8) % 100 != 0};
+        }
+    }
+    return trace;
+}
+
+// rule set of one kind ("above", "below", "offline") or "mixed", as JSON like /rules.json
+static std::string makeRules(const char *kind, uint8_t count) {
+    static const char *const mixed[] = {
+        "{\"when\":\"above\",\"temp\":%d,\"hysteresis\":1,\"for\":300,\"reminder\":30}",
+        "{\"when\":\"below\",\"temp\":%d,\"hysteresis\":1,\"samples\":2}",
+        "{\"when\":\"offline\",\"samples\":3}",
+        "{\"when\":\"above\",\"temp\":%d,\"severity\":\"critical\"}"
+    };
+    std::string json = "[";
+    for (uint8_t i = 0; i < count; i++) {
+        char rule[128];
+        const char *format = mixed[i % 4];
+        if (strcmp(kind, "above") == 0) { format = mixed[0]; }
+        if (strcmp(kind, "below") == 0) { format = mixed[1]; }
+        if (strcmp(kind, "offline") == 0) { format = mixed[2]; }
+        snprintf(rule, sizeof(rule), format, format == mixed[1] ? 3 + i % 3 : 7 + i % 4);
+        json += (i > 0 ? "," : "");
+        json += rule;
+    }
+    return json + "]";
+}
+
+// mean time of one evaluation of the compiled table, false if the rules do not parse
+static bool benchTable(const std::string &json, uint8_t sensors, const std::vector<RuleInput> &trace, BenchResult &result) {
+    static RuleDef defs[RULES_MAX];
+    static RuleTable table;
+    uint8_t count = 0;
+    if (!rulesParse(json.c_str(), json.size(), defs, count) || count == 0) {     // An empty table would be timed as "fast"
+        return false;
+    }
+    rulesCompile(defs, count, sensors, table);
+
+    RuleEvent events[RULES_EVENTS_MAX];
+    result = {table.size, 0, 0};
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < RULES_BENCH_ITERATIONS; i++) {
+        const RuleInput *inputs = &trace[(i % RULES_BENCH_TRACE) * sensors];
+        result.events += rulesEvaluateTable(table, inputs, sensors, i * RULES_BENCH_PERIOD_MS, events, RULES_EVENTS_MAX);
+    }
+    result.evalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RULES_BENCH_ITERATIONS;
+    return true;
+}
+
+// the bare conditions read from the JSON definitions on every sample (no state machine)
+static BenchResult benchJson(const std::string &json, uint8_t sensors, const std::vector<RuleInput> &trace) {
+    JsonDocument doc;
+    deserializeJson(doc, json.c_str(), json.size());
+    JsonArrayConst rules = doc.as<JsonArrayConst>();
+    BenchResult result = {0, 0, 0};
+    uint32_t met = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < RULES_BENCH_ITERATIONS; i++) {
+        const RuleInput *inputs = &trace[(i % RULES_BENCH_TRACE) * sensors];
+        uint8_t entries = 0;
+        for (JsonObjectConst rule : rules) {
+            const char *when = rule["when"] | "above";
+            int16_t limit = (int16_t)lroundf((rule["temp"] | 0.0f) * 10);
+            uint8_t sensor = rule["sensor"] | 0;
+            for (uint8_t p = sensor > 0 ? sensor - 1 : 0; p < (sensor > 0 ? sensor : sensors) && entries < RULES_ENTRIES_MAX; p++, entries++) {
+                const RuleInput &input = inputs[p];
+                if (strcmp(when, "offline") == 0) {
+                    met += !input.online;
+                } else if (input.online) {
+                    met += strcmp(when, "above") == 0 ? input.temp > limit : input.temp < limit;
+                }
+            }
+        }
+        result.entries = entries;
+    }
+    result.evalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RULES_BENCH_ITERATIONS;
+    sink = met;
+    return result;
+}
+
+// one table row
+static void printRow(const char *name, const BenchResult &r, bool events) {
+    printf("%-16s %8u %10.1f %10.2f", name, r.entries, r.evalNs, r.entries > 0 ? r.evalNs / r.entries : 0);
+    if (events) {
+        printf(" %8u\n", r.events);
+    } else {
+        printf(" %8s\n", "-");
+    }
+}
+
+// run --bench-rules with the other arguments
+int rulesBenchMain(int argc, char **argv) {
+    uint8_t rules = RULES_MAX;
+    uint8_t sensors = 4;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--rules=", 8) == 0) { rules = atoi(argv[i] + 8); continue; }
+        if (strncmp(argv[i], "--sensors=", 10) == 0) { sensors = atoi(argv[i] + 10); continue; }
+    }
+    if (rules < 1 || rules > RULES_MAX || sensors < 1 || sensors > SENSOR_MAX) {
+        fprintf(stderr, "❌ --rules=1..%d, --sensors=1..%d\n", RULES_MAX, SENSOR_MAX);
+        return 2;
+    }
+
+    std::vector<RuleInput> trace = makeTrace(sensors);
+    fprintf(stderr, "⏱️  %u rule(s) on %u sensor(s), mean of %d samples\n", rules, sensors, RULES_BENCH_ITERATIONS);
+    printf("%-16s %8s %10s %10s %8s\n", "rules", "entries", "ns/sample", "ns/entry", "events");
+    for (const char *kind : {"above", "below", "offline", "mixed"}) {
+        BenchResult result;
+        if (!benchTable(makeRules(kind, rules), sensors, trace, result)) {
+            fprintf(stderr, "❌ Generated %s rules do not parse\n", kind);
+            return 1;
+        }
+        printRow(kind, result, true);
+    }
+    printRow("mixed (json)", benchJson(makeRules("mixed", rules), sensors, trace), false);
+    return 0;
+}
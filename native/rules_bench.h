@@ -0,0 +1,20 @@
+#pragma once
+
+// ======================================================================
+// Alarm rule benchmark
+// ======================================================================
+// Compiles a rule set the way rulesBegin() does and measures the
+// evaluation of one sample of all sensors over a synthetic trace (random
+// walk around the limits with dropouts), in total and per table entry,
+// for each kind of rule and for the mixed set. The last row reads the
+// same conditions from the JSON definitions on every sample, the cost
+// the compiled table avoids on the sensing task.
+//
+//   .pio/build/native/program --bench-rules
+//   .pio/build/native/program --bench-rules --rules=8 --sensors=4
+
+#define RULES_BENCH_ITERATIONS 200000                   // Evaluations per measurement, the mean is reported
+#define RULES_BENCH_TRACE 4096                          // Samples per sensor in the trace, repeated
+#define RULES_BENCH_PERIOD_MS 10000                     // Virtual time between samples
+
+int rulesBenchMain(int argc, char **argv);              // Run --bench-rules with the other arguments, returns the exit code
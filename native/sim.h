@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// ======================================================================
+// Simulation controls for the native HAL
+// ======================================================================
+
+void simAdvance(uint32_t ms);                           // Advance the virtual clock
+void simSetEpoch(uint32_t epoch);                       // Set the wall clock now (0 = not set, like before SNTP)
+void simSetTemperature(float tempC);                    // Temperature the simulated DS18B20 will convert
+void simSetSensorCount(uint8_t count);                  // DS18B20s on the bus (1..8)
+void simSetSensorTemperature(uint8_t index, float tempC);   // Temperature of one of them
+void simSetSensorConnected(bool connected);             // Simulate a disconnected probe
+void simSetSensorStalled(bool stalled);                 // Conversions never complete (timeout)
+void simSetHttpResponse(int code);                      // Response code of the simulated HTTP endpoint
+void simPutFile(const char *path, const std::string &content);   // Create a file in the in-memory filesystem
+std::string simGetFile(const char *path);               // Content of a file in the in-memory filesystem
+void simSetFileFull(bool full);                         // Writes fail (flash full)
+void simClearFiles();                                   // Empty filesystem, like a freshly formatted partition
+const std::vector<std::string> &simHttpLog();           // URLs posted so far
+bool simPinLevel(uint8_t pin);                          // Level of an output pin
@@ -0,0 +1,258 @@
+#include "notify.h"
+#include <WiFi.h>
+#include "config_schema.h"
+#include "hal.h"
+#include "metrics.h"
+#include "outbox.h"
+#include "debug.h"
+
+// Queued message, copied into the queue (no pointers into config)
+struct NotifyMessage {
+    char phone[20];                                     // Phone number incl. country code
+    char apiKey[24];                                    // CallMeBot API key
+    char text[NOTIFY_TEXT_LEN];                         // Message text
+    uint32_t hash;                                      // Hash of phone + text for deduplication
+    unsigned long enqueuedAt;                           // millis() when queued
+};
+
+#define NOTIFY_STORED_LEN offsetof(NotifyMessage, hash)  // Phone, key and text go to the outbox
+static_assert(NOTIFY_STORED_LEN <= OUTBOX_DATA_MAX, "notification does not fit an outbox record");
+
+static QueueHandle_t queue = nullptr;                   // Pending messages
+static TaskHandle_t task = nullptr;                     // Dispatcher task
+static char endpoint[128] = CONFIG_DEFAULT_NOTIFY_URL;  // Endpoint URL
+static uint32_t pending[NOTIFY_QUEUE_LEN + 1];          // Hashes of queued + in-flight messages
+static portMUX_TYPE notifyMux = portMUX_INITIALIZER_UNLOCKED;
+static Outbox outbox;                                   // Undelivered messages on LittleFS, used by the dispatcher task
+
+// Dispatcher statistics
+static uint32_t sent = 0;                               // Messages delivered
+static uint32_t failed = 0;                             // Messages rejected by the endpoint (4xx), not retried
+static uint32_t stored = 0;                             // Messages moved to the outbox (offline, attempts exhausted)
+static uint32_t retries = 0;                            // Retried attempts
+static uint32_t deduplicated = 0;                       // Messages dropped as duplicates of pending ones
+static uint32_t dropped = 0;                            // Messages dropped because the queue was full
+static uint32_t lastLatencyMs = 0;                      // Enqueue -> delivered of the last message
+static uint32_t maxLatencyMs = 0;                       // Longest latency
+static uint32_t lastRoundTripMs = 0;                    // Duration of the last HTTP POST
+
+// FNV-1a hash over phone and text
+static uint32_t messageHash(const char *phone, const char *text) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = phone; *p; p++) { hash = (hash ^ (uint8_t)*p) * 16777619u; }
+    hash = (hash ^ '|') * 16777619u;
+    for (const char *p = text; *p; p++) { hash = (hash ^ (uint8_t)*p) * 16777619u; }
+    return hash == 0 ? 1 : hash;                        // 0 marks a free slot
+}
+
+// remove a hash from the pending list
+static void releasePending(uint32_t hash) {
+    portENTER_CRITICAL(&notifyMux);
+    for (size_t i = 0; i <= NOTIFY_QUEUE_LEN; i++) {
+        if (pending[i] == hash) { pending[i] = 0; break; }
+    }
+    portEXIT_CRITICAL(&notifyMux);
+}
+
+// append text at len, percent-encoded except the unreserved characters (RFC 3986)
+static void urlAppend(char *url, size_t size, size_t &len, const char *text, bool encode) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (const char *p = text; *p && len + 4 <= size; p++) {
+        uint8_t c = *p;
+        if (!encode || isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            url[len++] = c;
+        } else {
+            url[len++] = '%';
+            url[len++] = hex[c >> 4];
+            url[len++] = hex[c & 0x0F];
+        }
+    }
+    url[len] = '\0';
+}
+
+// send one message, returns the HTTP response code
+static int postMessage(const NotifyMessage &msg) {
+    static char url[sizeof(endpoint) + 32 + 3 * NOTIFY_STORED_LEN];  // Dispatcher task only, every message fits encoded
+    char base[sizeof(endpoint)];                        // notifySetEndpoint() runs in the web task
+    portENTER_CRITICAL(&notifyMux);
+    memcpy(base, endpoint, sizeof(base));
+    portEXIT_CRITICAL(&notifyMux);
+    size_t len = 0;
+    urlAppend(url, sizeof(url), len, base, false);
+    urlAppend(url, sizeof(url), len, "?phone=", false);
+    urlAppend(url, sizeof(url), len, msg.phone, true);
+    urlAppend(url, sizeof(url), len, "&apikey=", false);
+    urlAppend(url, sizeof(url), len, msg.apiKey, true);
+    urlAppend(url, sizeof(url), len, "&text=", false);
+    urlAppend(url, sizeof(url), len, msg.text, true);
+    return halHttpPost(url);                            // Connection to the endpoint is reused
+}
+
+// one POST, returns the HTTP response code
+static int attemptMessage(const NotifyMessage &msg) {
+    uint32_t start = micros();
+    int httpResponseCode = postMessage(msg);
+    uint32_t roundTripUs = micros() - start;
+    lastRoundTripMs = roundTripUs / 1000;
+    metricsObserve(HIST_NOTIFY_RTT, roundTripUs);
+
+    if (httpResponseCode == 200) {
+        debugf("📦 WHATSAPP Notification sent to <+%s> (%lu ms)\n", msg.phone, (unsigned long)lastRoundTripMs);
+    } else {
+        debugf("❌ WHATSAPP Notification -> ERROR: HTTP response code: %i\n", httpResponseCode);
+    }
+    return httpResponseCode;
+}
+
+// endpoint rejected the message itself (wrong key/number), retrying does not help
+static bool rejected(int httpResponseCode) {
+    return httpResponseCode >= 400 && httpResponseCode < 500;
+}
+
+// delivered message
+static void delivered(const NotifyMessage &msg) {
+    sent++;
+    lastLatencyMs = millis() - msg.enqueuedAt;
+    maxLatencyMs = max(maxLatencyMs, lastLatencyMs);
+}
+
+// send a new message with a few quick retries, false if it has to be stored
+static bool deliverNow(const NotifyMessage &msg) {
+    for (uint8_t attempt = 0; attempt < NOTIFY_MAX_ATTEMPTS && WiFi.status() == WL_CONNECTED; attempt++) {
+        if (attempt > 0) {
+            retries++;
+            vTaskDelay(pdMS_TO_TICKS(NOTIFY_RETRY_BASE_MS << (attempt - 1)));   // Exponential backoff
+        }
+        int httpResponseCode = attemptMessage(msg);
+        if (httpResponseCode == 200) {
+            delivered(msg);
+            return true;
+        }
+        if (rejected(httpResponseCode)) {
+            failed++;
+            return true;                                // Not stored, it would block the outbox
+        }
+    }
+    return false;
+}
+
+// send the oldest stored message, returns the delay until the next one
+static uint32_t drainOne(uint8_t &failures) {
+    NotifyMessage msg = {};
+    if (outboxPeek(outbox, &msg, NOTIFY_STORED_LEN) != NOTIFY_STORED_LEN) {
+        return NOTIFY_DRAIN_INTERVAL_MS;
+    }
+    msg.enqueuedAt = millis();                          // Latency of stored messages is not tracked across reboots
+
+    int httpResponseCode = attemptMessage(msg);
+    if (httpResponseCode == 200 || rejected(httpResponseCode)) {
+        outboxPop(outbox);
+        if (httpResponseCode == 200) { sent++; } else { failed++; }
+        failures = 0;
+        return NOTIFY_DRAIN_INTERVAL_MS;                // Rate limit of the endpoint
+    }
+    retries++;
+    failures = min<uint8_t>(failures + 1, 6);
+    return NOTIFY_RETRY_BASE_MS << failures;            // 2 s .. 64 s
+}
+
+// dispatcher task
+static void notifyTask(void *parameter) {
+    NotifyMessage msg;
+    uint32_t nextDrain = 0;                             // millis() of the next outbox delivery
+    uint8_t drainFailures = 0;
+
+    while (true) {
+        TickType_t wait = outboxCount(outbox) > 0 ? pdMS_TO_TICKS(NOTIFY_DRAIN_POLL_MS) : portMAX_DELAY;
+        if (xQueueReceive(queue, &msg, wait) == pdTRUE) {
+            if (outboxCount(outbox) > 0 || !deliverNow(msg)) {     // Behind stored messages, keeps the order
+                if (outboxAppend(outbox, &msg, NOTIFY_STORED_LEN)) {
+                    stored++;
+                    debugf("💾 Notification stored for later delivery (%lu waiting)\n", (unsigned long)outboxCount(outbox));
+                } else {
+                    failed++;
+                }
+            }
+            releasePending(msg.hash);
+        }
+
+        if (outboxCount(outbox) > 0 && WiFi.status() == WL_CONNECTED && (int32_t)(millis() - nextDrain) >= 0) {
+            nextDrain = millis() + drainOne(drainFailures);
+        }
+    }
+}
+
+// create the queue and the dispatcher task
+void notifyBegin() {
+    if (queue != nullptr) {
+        return;
+    }
+    outboxBegin(outbox, NOTIFY_OUTBOX_DIR);             // Messages of the last outage, sent once online
+    queue = xQueueCreate(NOTIFY_QUEUE_LEN, sizeof(NotifyMessage));
+    if (queue == nullptr || xTaskCreatePinnedToCore(notifyTask, "Notify", 8192, nullptr, 1, &task, 0) != pdPASS) {
+        debugln("❌ Failed to start notification dispatcher!");
+        return;
+    }
+    debugln("✅ Notification dispatcher started");
+}
+
+// set the endpoint URL
+void notifySetEndpoint(const char *url) {
+    if (url != nullptr && url[0] != '\0') {
+        char copy[sizeof(endpoint)];
+        strlcpy(copy, url, sizeof(copy));               // Outside the spinlock
+        portENTER_CRITICAL(&notifyMux);
+        memcpy(endpoint, copy, sizeof(endpoint));
+        portEXIT_CRITICAL(&notifyMux);
+    }
+}
+
+// queue a message
+bool notifyEnqueue(const char *phone, const char *apiKey, const char *text) {
+    if (queue == nullptr) {
+        return false;
+    }
+
+    NotifyMessage msg;
+    strlcpy(msg.phone, phone, sizeof(msg.phone));
+    strlcpy(msg.apiKey, apiKey, sizeof(msg.apiKey));
+    strlcpy(msg.text, text, sizeof(msg.text));
+    msg.hash = messageHash(msg.phone, msg.text);
+    msg.enqueuedAt = millis();
+
+    portENTER_CRITICAL(&notifyMux);
+    int freeSlot = -1;
+    for (size_t i = 0; i <= NOTIFY_QUEUE_LEN; i++) {
+        if (pending[i] == msg.hash) { freeSlot = -2; break; }
+        if (pending[i] == 0 && freeSlot == -1) { freeSlot = i; }
+    }
+    if (freeSlot >= 0) { pending[freeSlot] = msg.hash; }
+    portEXIT_CRITICAL(&notifyMux);
+
+    if (freeSlot == -2) {                               // Same message already pending
+        deduplicated++;
+        return true;
+    }
+    if (freeSlot == -1 || xQueueSend(queue, &msg, 0) != pdTRUE) {
+        dropped++;
+        if (freeSlot >= 0) { releasePending(msg.hash); }
+        debugln("❌ Notification queue full, message dropped");
+        return false;
+    }
+    return true;
+}
+
+// add latency and failure counters
+void notifyStats(JsonDocument &sys) {
+    sys["notify_queued"] = queue ? uxQueueMessagesWaiting(queue) : 0;
+    sys["notify_sent"] = sent;
+    sys["notify_failed"] = failed;
+    sys["notify_stored"] = stored;
+    sys["notify_retries"] = retries;
+    sys["notify_deduplicated"] = deduplicated;
+    sys["notify_dropped"] = dropped;
+    sys["notify_latency_ms"] = lastLatencyMs;
+    sys["notify_latency_max_ms"] = maxLatencyMs;
+    sys["notify_roundtrip_ms"] = lastRoundTripMs;
+    outboxStats(outbox, sys, "notify_outbox");
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Notification dispatcher
+// ======================================================================
+// Notifications are queued and sent by a dedicated task, so loop() and
+// the timer task never wait for a HTTPS POST. The connection to the
+// endpoint is kept open between messages, failed messages are retried
+// with exponential backoff and identical pending messages are dropped.
+// Messages that cannot be delivered (offline, endpoint down) go to a
+// persistent outbox and are sent in order, rate limited, once the
+// connection is back; new messages queue up behind them.
+
+#define NOTIFY_QUEUE_LEN 8                              // Pending messages
+#define NOTIFY_MAX_ATTEMPTS 5                           // Attempts per message
+#define NOTIFY_RETRY_BASE_MS 1000                       // First retry after 1 s, then 2 s, 4 s, ...
+#define NOTIFY_TEXT_LEN 256                             // Max. message length (UTF-8 bytes)
+#define NOTIFY_OUTBOX_DIR "/outbox"                     // Undelivered messages on LittleFS
+#define NOTIFY_DRAIN_INTERVAL_MS 3000                   // At most one stored message every 3 s (endpoint rate limit)
+#define NOTIFY_DRAIN_POLL_MS 1000                       // Check the connection while messages are stored
+
+void notifyBegin();                                     // Create the queue and the dispatcher task
+void notifySetEndpoint(const char *url);                // Set the endpoint URL (e.g. a local HTTP stand-in)
+bool notifyEnqueue(const char *phone, const char *apiKey, const char *text); // Queue a message, false if dropped
+void notifyStats(JsonDocument &sys);                    // Add latency and failure counters
@@ -0,0 +1,284 @@
+#include "outbox.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal.h"
+#include "debug.h"
+
+#ifdef ARDUINO
+static bool lockCreate(Outbox &box) { box.lock = xSemaphoreCreateMutex(); return box.lock != nullptr; }
+static void lock(Outbox &box) { xSemaphoreTake(box.lock, portMAX_DELAY); }
+static void unlock(Outbox &box) { xSemaphoreGive(box.lock); }
+#else
+static bool lockCreate(Outbox &) { return true; }       // Native build is single threaded
+static void lock(Outbox &) {}
+static void unlock(Outbox &) {}
+#endif
+
+#define OUTBOX_MAGIC 0x0B0C                             // Marks a completely written record
+
+struct __attribute__((packed)) OutboxHeader {
+    uint16_t magic;
+    uint16_t len;                                       // Payload bytes
+    uint32_t createdAt;                                 // halEpoch() when stored, 0 = clock was not set
+    uint32_t crc;                                       // CRC32 of the payload
+};
+static_assert(sizeof(OutboxHeader) + OUTBOX_DATA_MAX == OUTBOX_RECORD_SIZE, "OUTBOX_DATA_MAX does not match the header");
+
+// build the path of a segment file
+static void segmentPath(const Outbox &box, char *path, size_t len, uint32_t segment) {
+    snprintf(path, len, "%s/%08lu.bin", box.dir, (unsigned long)segment);
+}
+
+// complete records in a segment file
+static uint32_t segmentRecords(const Outbox &box, uint32_t segment) {
+    char path[48];
+    segmentPath(box, path, sizeof(path), segment);
+    return halFileSize(path) / OUTBOX_RECORD_SIZE;
+}
+
+// CRC32 of a payload (zlib polynomial, same value as the ROM esp_rom_crc32_le(0, ...))
+static uint32_t crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) { crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1))); }
+    }
+    return ~crc;
+}
+
+// save the read position (temp file + rename)
+static void writeCursor(const Outbox &box) {
+    char path[48], tmp[48], text[24];
+    snprintf(path, sizeof(path), "%s/cursor", box.dir);
+    snprintf(tmp, sizeof(tmp), "%s/cursor.tmp", box.dir);
+    int len = snprintf(text, sizeof(text), "%lu %u", (unsigned long)box.segFirst, box.headIndex);
+
+    if (halFileWrite(tmp, text, len) != (size_t)len || !halFileRename(tmp, path)) {
+        debugf("❌ Outbox: Failed to write %s\n", path);
+    }
+}
+
+// delete the oldest segment and move the read position to the next one
+static void dropFirstSegment(Outbox &box) {
+    char path[48];
+    segmentPath(box, path, sizeof(path), box.segFirst);
+    halFileRemove(path);
+    if (box.segFirst == box.segLast) {                  // Last one -> start over with an empty segment
+        box.segLast++;
+        box.tailCount = 0;
+    }
+    box.segFirst++;
+    box.headIndex = 0;
+}
+
+// advance the read position by one record
+static void advance(Outbox &box) {
+    box.headIndex++;
+    box.count--;
+    uint32_t records = box.segFirst == box.segLast ? box.tailCount : segmentRecords(box, box.segFirst);
+    if (box.headIndex >= records && (box.segFirst != box.segLast || box.count == 0)) {
+        dropFirstSegment(box);                          // Deleted before the cursor moves: a power cut in between only skips ahead
+    }
+    writeCursor(box);
+    box.headSeenMs = halMillis();
+    box.headCreatedAt = 0;
+}
+
+// read the oldest valid record, corrupt ones are skipped
+static size_t readHead(Outbox &box, void *data, size_t maxLen) {
+    uint8_t record[OUTBOX_RECORD_SIZE];
+    while (box.count > 0) {
+        char path[48];
+        segmentPath(box, path, sizeof(path), box.segFirst);
+        bool ok = halFileReadAt(path, (size_t)box.headIndex * OUTBOX_RECORD_SIZE, (char *)record, sizeof(record)) == sizeof(record);
+
+        const OutboxHeader *header = (const OutboxHeader *)record;
+        const uint8_t *payload = record + sizeof(OutboxHeader);
+        if (ok && header->magic == OUTBOX_MAGIC && header->len <= OUTBOX_DATA_MAX && header->len <= maxLen &&
+            crc32(payload, header->len) == header->crc) {
+            memcpy(data, payload, header->len);
+            box.headCreatedAt = header->createdAt;
+            return header->len;
+        }
+        box.dropped++;                                  // Torn by a power cut or missing segment
+        debugf("❌ Outbox: Skipped corrupt record %lu/%u\n", (unsigned long)box.segFirst, box.headIndex);
+        advance(box);
+    }
+    return 0;
+}
+
+// Oldest and newest segment number found in the directory
+struct SegmentRange {
+    uint32_t first;
+    uint32_t last;
+    bool found;
+};
+
+// find the segments and the read position
+bool outboxBegin(Outbox &box, const char *dir) {
+    memset(&box, 0, sizeof(box));
+    snprintf(box.dir, sizeof(box.dir), "%s", dir);
+    if (!lockCreate(box) || !halDirCreate(dir)) {
+        debugf("❌ Outbox: Failed to create %s\n", dir);
+        return false;
+    }
+
+    SegmentRange range = {};
+    bool listed = halDirList(dir, [](const char *name, void *context) {
+        SegmentRange &r = *(SegmentRange *)context;
+        if (isdigit((unsigned char)name[0])) {          // Skip the cursor
+            uint32_t segment = strtoul(name, nullptr, 10);
+            if (!r.found || segment < r.first) { r.first = segment; }
+            if (!r.found || segment > r.last) { r.last = segment; }
+            r.found = true;
+        }
+    }, &range);
+    if (!listed) {
+        debugf("❌ Outbox: Failed to open %s\n", dir);
+        return false;
+    }
+    bool found = range.found;
+    box.segFirst = range.first;
+    box.segLast = range.last;
+
+    char path[48], text[24] = "";
+    snprintf(path, sizeof(path), "%s/cursor", dir);
+    text[halFileRead(path, text, sizeof(text) - 1)] = '\0';
+    char *end;
+    uint32_t cursorSegment = strtoul(text, &end, 10);
+    uint32_t cursorIndex = strtoul(end, nullptr, 10);
+
+    if (found) {
+        while (box.segFirst < cursorSegment && box.segFirst < box.segLast) {   // Delivered, deletion was cut off
+            char old[48];
+            segmentPath(box, old, sizeof(old), box.segFirst);
+            halFileRemove(old);
+            box.segFirst++;
+        }
+        if (cursorSegment == box.segFirst) {            // Else the segment was dropped meanwhile, start at its beginning
+            box.headIndex = cursorIndex;
+        }
+
+        char last[48];
+        segmentPath(box, last, sizeof(last), box.segLast);
+        size_t size = halFileSize(last);
+        box.tailCount = size / OUTBOX_RECORD_SIZE;
+        if (size % OUTBOX_RECORD_SIZE != 0) {           // Torn append -> continue in a new segment
+            box.segLast++;
+            box.tailCount = 0;
+        }
+
+        for (uint32_t segment = box.segFirst; segment <= box.segLast; segment++) {
+            box.count += segment == box.segLast ? box.tailCount : segmentRecords(box, segment);
+        }
+        box.count = box.count > box.headIndex ? box.count - box.headIndex : 0;
+    }
+
+    box.headSeenMs = halMillis();
+    box.ready = true;
+    uint8_t scratch[OUTBOX_DATA_MAX];
+    readHead(box, scratch, sizeof(scratch));            // Age of the oldest record, skips a corrupt head
+    debugf("✅ Outbox %s: %lu records waiting\n", dir, (unsigned long)box.count);
+    return true;
+}
+
+// store a record at the end
+bool outboxAppend(Outbox &box, const void *data, size_t len) {
+    if (!box.ready || len > OUTBOX_DATA_MAX) {
+        return false;
+    }
+    uint8_t record[OUTBOX_RECORD_SIZE] = {};
+    OutboxHeader *header = (OutboxHeader *)record;
+    header->magic = OUTBOX_MAGIC;
+    header->len = len;
+    header->createdAt = halEpoch();
+    header->crc = crc32((const uint8_t *)data, len);
+    memcpy(record + sizeof(OutboxHeader), data, len);
+
+    lock(box);
+    if (box.tailCount >= OUTBOX_SEGMENT_RECORDS) {      // Segment full -> start the next one
+        box.segLast++;
+        box.tailCount = 0;
+    }
+    while (box.segLast - box.segFirst >= OUTBOX_SEGMENTS) {    // Full -> drop the oldest segment
+        uint32_t lost = segmentRecords(box, box.segFirst) - box.headIndex;
+        box.count -= lost;
+        box.dropped += lost;
+        dropFirstSegment(box);
+        writeCursor(box);
+        box.headSeenMs = halMillis();
+        box.headCreatedAt = 0;
+        debugf("❌ Outbox %s full, %lu oldest records dropped\n", box.dir, (unsigned long)lost);
+    }
+
+    char path[48];
+    segmentPath(box, path, sizeof(path), box.segLast);
+    bool ok = halFileAppend(path, (const char *)record, sizeof(record)) == sizeof(record);    // One write of the whole record
+    if (ok) {
+        box.tailCount++;
+        if (box.count++ == 0) {
+            box.headSeenMs = halMillis();
+            box.headCreatedAt = header->createdAt;
+        }
+        box.appended++;
+    } else {
+        debugf("❌ Outbox: Failed to write %s\n", path);
+    }
+    unlock(box);
+    return ok;
+}
+
+// copy the oldest record
+size_t outboxPeek(Outbox &box, void *data, size_t maxLen) {
+    if (!box.ready) {
+        return 0;
+    }
+    lock(box);
+    size_t len = readHead(box, data, maxLen);
+    unlock(box);
+    return len;
+}
+
+// remove the oldest record
+void outboxPop(Outbox &box) {
+    if (!box.ready) {
+        return;
+    }
+    lock(box);
+    if (box.count > 0) {
+        advance(box);
+        box.delivered++;
+    }
+    unlock(box);
+}
+
+// records waiting
+uint32_t outboxCount(const Outbox &box) {
+    return box.count;
+}
+
+// add depth, age of the oldest record and drop counter
+void outboxStats(Outbox &box, JsonDocument &sys, const char *prefix) {
+    uint32_t ageS = 0;
+    if (box.ready) {
+        lock(box);
+        uint32_t now = halEpoch();
+        if (box.count > 0) {                            // Stored with a set clock -> real age, else since it became the oldest
+            ageS = box.headCreatedAt != 0 && now != 0 ? now - box.headCreatedAt : (halMillis() - box.headSeenMs) / 1000;
+        }
+        unlock(box);
+    }
+    char key[48];
+    snprintf(key, sizeof(key), "%s_depth", prefix);
+    sys[key] = box.count;
+    snprintf(key, sizeof(key), "%s_oldest_age_s", prefix);
+    sys[key] = ageS;
+    snprintf(key, sizeof(key), "%s_appended", prefix);
+    sys[key] = box.appended;
+    snprintf(key, sizeof(key), "%s_delivered", prefix);
+    sys[key] = box.delivered;
+    snprintf(key, sizeof(key), "%s_dropped", prefix);
+    sys[key] = box.dropped;
+}
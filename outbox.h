@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+// ======================================================================
+// Store-and-forward outbox
+// ======================================================================
+// Bounded FIFO of outbound records that could not be delivered, kept on
+// LittleFS so they survive a network outage and a reboot. Records have
+// a fixed size and a CRC and are appended to segment files
+// (<dir>/<n>.bin); a record torn by a power cut is skipped. The read
+// position is kept in <dir>/cursor (temp file + rename), a segment is
+// deleted once it has been delivered completely. When the outbox is
+// full the oldest segment is dropped. Delivery is at-least-once: a
+// power cut between delivery and outboxPop() sends a record again.
+// Files and clock go through hal.h, so the native tests run it too.
+
+#define OUTBOX_RECORD_SIZE 320                          // Bytes per record on flash, incl. header
+#define OUTBOX_SEGMENT_RECORDS 16                       // Records per segment file
+#define OUTBOX_SEGMENTS 4                               // Segment files kept (64 records, 20 KB)
+#define OUTBOX_DATA_MAX (OUTBOX_RECORD_SIZE - 12)       // Payload bytes per record (header: magic, len, time, CRC)
+
+// One outbox (directory), fields are private to outbox.cpp
+struct Outbox {
+    char dir[24];                                       // Directory of the segment files
+    uint32_t segFirst;                                  // Oldest segment (holds the read position)
+    uint32_t segLast;                                   // Newest segment (appended to)
+    uint16_t headIndex;                                 // Next record to deliver in segFirst
+    uint16_t tailCount;                                 // Records in segLast
+    uint32_t count;                                     // Records waiting
+    uint32_t headCreatedAt;                             // halEpoch() of the oldest record, 0 = clock was not set
+    uint32_t headSeenMs;                                // halMillis() when the oldest record became the oldest
+    uint32_t appended;                                  // Statistics
+    uint32_t delivered;
+    uint32_t dropped;                                   // Dropped as the oldest when full, or corrupt
+#ifdef ARDUINO
+    SemaphoreHandle_t lock;                             // File access from several tasks
+#endif
+    bool ready;
+};
+
+bool outboxBegin(Outbox &box, const char *dir);         // Find the segments and the read position (after mounting LittleFS)
+bool outboxAppend(Outbox &box, const void *data, size_t len);   // Store a record at the end, drops the oldest when full
+size_t outboxPeek(Outbox &box, void *data, size_t maxLen);      // Copy the oldest record, 0 if empty
+void outboxPop(Outbox &box);                            // Remove the oldest record (after it was delivered)
+uint32_t outboxCount(const Outbox &box);                // Records waiting
+void outboxStats(Outbox &box, JsonDocument &sys, const char *prefix);   // Add <prefix>_depth, _oldest_age_s, _dropped
@@ -0,0 +1,189 @@
+#include "persist.h"
+#include <Preferences.h>
+#include "config_store.h"
+#include "hal.h"
+#include "metrics.h"
+#include "debug.h"
+
+// Persistence state and counters
+static uint64_t configDirtyMask = 0;                    // Dirty CFG_PERSIST fields (bit = schema index)
+static uint64_t runtimeDirtyMask = 0;                   // Dirty CFG_NVS fields (bit = schema index)
+static unsigned long configFirstDirty = 0;              // millis() of the first uncommitted config change
+static unsigned long configLastDirty = 0;               // millis() of the last uncommitted config change
+static unsigned long runtimeFirstDirty = 0;             // millis() of the first uncommitted runtime change
+static uint32_t configCrc = 0;                          // CRC of the config file content on flash
+static uint32_t commits = 0;                            // Number of commits to flash/NVS
+static uint32_t commitsSkipped = 0;                     // Commits skipped because the content was unchanged
+static uint32_t bytesWritten = 0;                       // Bytes written to flash/NVS
+static uint32_t lastCommitUs = 0;                       // Duration of the last commit
+static uint32_t maxCommitUs = 0;                        // Longest commit
+static portMUX_TYPE persistMux = portMUX_INITIALIZER_UNLOCKED;
+
+static char fileBuffer[CONFIG_FILE_MAX];                 // Serialized config file
+static AppConfig snapshot;                              // Consistent copy of config for a commit
+
+// CRC32 of a buffer
+static uint32_t crc32(const char *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint8_t)data[i];
+        for (int k = 0; k < 8; k++) { crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1))); }
+    }
+    return crc;
+}
+
+// write the settings to the config file (temp file + rename)
+static bool commitConfig() {
+    configCopy(snapshot);
+    size_t written = configSerialize(snapshot, fileBuffer, sizeof(fileBuffer));
+    if (written == 0) {
+        debugln("❌ Configuration too large for " CONFIG_FILE);
+        return false;
+    }
+
+    uint32_t crc = crc32(fileBuffer, written);
+    if (crc == configCrc) {                             // Same content as on flash, e.g. value set back and forth
+        commitsSkipped++;
+        return true;
+    }
+
+    unsigned long start = micros();
+    if (!configSave(fileBuffer, written)) {             // Temp file + rename
+        return false;
+    }
+
+    configCrc = crc;
+    lastCommitUs = micros() - start;
+    metricsObserve(HIST_FLASH_WRITE, lastCommitUs);
+    maxCommitUs = max(maxCommitUs, lastCommitUs);
+    bytesWritten += written;
+    commits++;
+    debugf("💾 Configuration saved (%u bytes, %lu µs)\n", written, (unsigned long)lastCommitUs);
+    return true;
+}
+
+// write the runtime fields to NVS, returns the fields that could not be written
+static uint64_t commitRuntime(uint64_t mask) {
+    unsigned long start = micros();
+    Preferences prefs;
+    if (!prefs.begin("runtime", false)) {
+        debugln("❌ Failed to open NVS namespace <runtime>");
+        return mask;
+    }
+    configCopy(snapshot);                               // The sensing task updates MIN/MAX meanwhile
+    size_t written = 0;
+    uint64_t failed = 0;
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const ConfigField &field = CONFIG_SCHEMA[i];
+        if ((mask & (1ull << i)) && field.type == FIELD_FLOAT) {
+            size_t n = prefs.putFloat(field.key, *(const float *)((const uint8_t *)&snapshot + field.offset));
+            if (n == 0) {                               // NVS full or write error
+                debugf("❌ Failed to write %s to NVS\n", field.key);
+                failed |= 1ull << i;
+            }
+            written += n;
+        }
+    }
+    prefs.end();
+
+    lastCommitUs = micros() - start;
+    metricsObserve(HIST_FLASH_WRITE, lastCommitUs);
+    maxCommitUs = max(maxCommitUs, lastCommitUs);
+    bytesWritten += written;
+    commits++;
+    debugf("💾 Runtime values saved (%u bytes, %lu µs)\n", written, (unsigned long)lastCommitUs);
+    return failed;
+}
+
+// restore runtime values from NVS
+void persistBegin() {
+    Preferences prefs;
+    if (prefs.begin("runtime", true)) {
+        for (const ConfigField &field : CONFIG_SCHEMA) {
+            if ((field.flags & CFG_NVS) && field.type == FIELD_FLOAT) {
+                float *value = (float *)((uint8_t *)&config + field.offset);
+                *value = prefs.getFloat(field.key, *value);
+            }
+        }
+        prefs.end();
+    }
+
+    configCrc = crc32(fileBuffer, configSerialize(config, fileBuffer, sizeof(fileBuffer)));
+    halFileRemove(CONFIG_TMP_FILE);                     // Leftover of an interrupted write
+}
+
+// mark a field as changed
+void persistMarkDirty(const char *key) {
+    int index = configFind(key);
+    if (index < 0) {
+        return;
+    }
+    uint8_t flags = CONFIG_SCHEMA[index].flags;
+    unsigned long now = millis();
+
+    portENTER_CRITICAL(&persistMux);
+    if (flags & CFG_NVS) {
+        if (runtimeDirtyMask == 0) { runtimeFirstDirty = now; }
+        runtimeDirtyMask |= 1ull << index;
+    } else if (flags & CFG_PERSIST) {
+        if (configDirtyMask == 0) { configFirstDirty = now; }
+        configLastDirty = now;
+        configDirtyMask |= 1ull << index;
+    }
+    portEXIT_CRITICAL(&persistMux);
+}
+
+// commit due groups
+void persistLoop() {
+    unsigned long now = millis();
+    portENTER_CRITICAL(&persistMux);                    // 64 bit masks, written from other tasks
+    bool configDue = configDirtyMask != 0 && (now - configLastDirty >= CONFIG_COMMIT_QUIET_MS || now - configFirstDirty >= CONFIG_COMMIT_MAX_MS);
+    bool runtimeDue = runtimeDirtyMask != 0 && now - runtimeFirstDirty >= RUNTIME_COMMIT_MS;
+    portEXIT_CRITICAL(&persistMux);
+
+    if (configDue || runtimeDue) {
+        persistCommitNow();
+    }
+}
+
+// commit everything dirty now
+void persistCommitNow() {
+    portENTER_CRITICAL(&persistMux);
+    uint64_t configMask = configDirtyMask;
+    uint64_t runtimeMask = runtimeDirtyMask;
+    configDirtyMask = 0;
+    runtimeDirtyMask = 0;
+    portEXIT_CRITICAL(&persistMux);
+
+    bool configFailed = configMask != 0 && !commitConfig();
+    uint64_t runtimeFailed = runtimeMask != 0 ? commitRuntime(runtimeMask) : 0;
+    if (!configFailed && runtimeFailed == 0) {
+        return;
+    }
+
+    unsigned long now = millis();                       // Keep the changes, retry after the usual delay
+    portENTER_CRITICAL(&persistMux);
+    if (configFailed) {
+        if (configDirtyMask == 0) { configFirstDirty = now; }
+        configLastDirty = now;
+        configDirtyMask |= configMask;
+    }
+    if (runtimeFailed != 0) {
+        if (runtimeDirtyMask == 0) { runtimeFirstDirty = now; }
+        runtimeDirtyMask |= runtimeFailed;
+    }
+    portEXIT_CRITICAL(&persistMux);
+}
+
+// add write counters to the system parameters
+void persistStats(JsonDocument &sys) {
+    portENTER_CRITICAL(&persistMux);
+    int dirty = __builtin_popcountll(configDirtyMask) + __builtin_popcountll(runtimeDirtyMask);
+    portEXIT_CRITICAL(&persistMux);
+    sys["persist_commits"] = commits;
+    sys["persist_commits_skipped"] = commitsSkipped;
+    sys["persist_bytes_written"] = bytesWritten;
+    sys["persist_last_commit_us"] = lastCommitUs;
+    sys["persist_max_commit_us"] = maxCommitUs;
+    sys["persist_dirty_fields"] = dirty;
+}
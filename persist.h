@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Persistence
+// ======================================================================
+// Changes are only marked dirty and committed later from loop(), batched
+// per group. Settings (CFG_PERSIST) go to /config.json (written to a temp
+// file and renamed, so a power cut keeps the old file), runtime values
+// (CFG_NVS) like MIN_TEMP/MAX_TEMP go to NVS and are never written to the
+// config file.
+
+#define CONFIG_COMMIT_QUIET_MS 5000                     // Commit settings 5 s after the last change ...
+#define CONFIG_COMMIT_MAX_MS 30000                      // ... but at the latest 30 s after the first one
+#define RUNTIME_COMMIT_MS 600000                        // Commit MIN/MAX at most every 10 minutes
+
+void persistBegin();                                    // Restore runtime values from NVS (after configLoad)
+void persistMarkDirty(const char *key);                 // Mark a field as changed (safe from any task)
+void persistLoop();                                     // Commit due groups, call from loop()
+void persistCommitNow();                                // Commit everything dirty now (before restart/sleep)
+void persistStats(JsonDocument &sys);                   // Add write counters to the system parameters
@@ -0,0 +1,322 @@
+#include "probes.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_schema.h"
+#include "sensor.h"
+#include "hal.h"
+#include "debug.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static portMUX_TYPE probesMux = portMUX_INITIALIZER_UNLOCKED;
+static void probesLock() { portENTER_CRITICAL(&probesMux); }
+static void probesUnlock() { portEXIT_CRITICAL(&probesMux); }
+#else
+static void probesLock() {}                             // Native build is single threaded
+static void probesUnlock() {}
+#endif
+
+static Probe probes[SENSOR_MAX];                        // Index = sensor index on the bus
+static uint8_t count = 0;
+static bool dirty = false;                              // Names/thresholds changed, not yet saved
+static uint32_t lastChange = 0;                         // halMillis() of the last change
+
+// Reading the rise of a sensor is measured from, sensing task only
+struct RiseAnchor {
+    int16_t temp;
+    uint32_t ms;
+    bool valid;
+};
+static RiseAnchor anchors[SENSOR_MAX];
+
+// clamp a threshold to the range of TARGET_TEMP/HYSTERESIS
+static int8_t clampSetting(long value, long lo, long hi) {
+    return (int8_t)(value < lo ? lo : (value > hi ? hi : value));
+}
+
+// reset min/max of an entry
+static void resetMinMax(Probe &probe) {
+    probe.minTemp = 1000;
+    probe.maxTemp = -1000;
+}
+
+// apply the settings of a file entry
+static void applyEntry(Probe &probe, JsonObjectConst entry) {
+    if (entry["name"].is<const char *>()) {
+        strncpy(probe.name, entry["name"].as<const char *>(), sizeof(probe.name) - 1);
+    }
+    probe.targetTemp = entry["target"].is<int>() ? clampSetting(entry["target"].as<int>(), 0, 25) : PROBE_GLOBAL;
+    probe.hysteresis = entry["hysteresis"].is<int>() ? clampSetting(entry["hysteresis"].as<int>(), 0, 10) : PROBE_GLOBAL;
+}
+
+// build the table from the sensors found, load names/thresholds
+void probesBegin() {
+    JsonDocument doc;
+    if (halFileExists(PROBES_FILE)) {
+        static char buffer[PROBES_FILE_MAX];
+        size_t len = halFileRead(PROBES_FILE, buffer, sizeof(buffer));
+        DeserializationError error = deserializeJson(doc, buffer, len);
+        if (error) {
+            debugf("❌ " PROBES_FILE ": %s\n", error.c_str());
+        }
+    }
+
+    count = sensorCount();
+    for (uint8_t i = 0; i < count; i++) {
+        Probe &probe = probes[i];
+        memset(&probe, 0, sizeof(probe));
+        anchors[i].valid = false;
+        const uint8_t *address = sensorAddress(i);
+        for (uint8_t b = 0; b < 8; b++) {
+            snprintf(probe.id + 2 * b, 3, "%02x", address[b]);
+        }
+        snprintf(probe.name, sizeof(probe.name), "Sensor %u", i + 1);
+        resetMinMax(probe);
+        applyEntry(probe, doc[probe.id].as<JsonObjectConst>());
+        debugf("🌡️ Sensor %u: %s (%s)\n", i + 1, probe.id, probe.name);
+    }
+}
+
+// number of entries
+uint8_t probesCount() {
+    return count;
+}
+
+// take over the last readings, rise per sensor over PROBES_RISE_SPAN_MS
+void probesUpdate() {
+    uint32_t now = halMillis();
+    for (uint8_t i = 0; i < count; i++) {
+        float tempC;
+        bool online = sensorValue(i, tempC);
+        int16_t temp = online ? (int16_t)lroundf(tempC * 10) : 0;
+
+        RiseAnchor &anchor = anchors[i];
+        bool riseDue = online && anchor.valid && now - anchor.ms >= PROBES_RISE_SPAN_MS;
+        int32_t rise = riseDue ? (int32_t)((temp - anchor.temp) * 600000LL / (int32_t)(now - anchor.ms)) : 0;  // 1/10 °C per ms -> 1/100 °C per min
+        if (online && (!anchor.valid || riseDue)) {
+            anchor = { temp, now, true };
+        } else if (!online) {
+            anchor.valid = false;
+        }
+
+        probesLock();
+        Probe &probe = probes[i];
+        probe.online = online;
+        if (online) {
+            probe.temp = temp;
+            if (temp < probe.minTemp) { probe.minTemp = temp; }
+            if (temp > probe.maxTemp) { probe.maxTemp = temp; }
+        }
+        if (riseDue || !online) {
+            probe.rise = (int16_t)(rise < -32768 ? -32768 : (rise > 32767 ? 32767 : rise));
+        }
+        probesUnlock();
+    }
+}
+
+// effective threshold
+int probesTarget(const Probe &probe) {
+    return probe.targetTemp != PROBE_GLOBAL ? probe.targetTemp : config.targetTemp;
+}
+
+// effective hysteresis
+int probesHysteresis(const Probe &probe) {
+    return probe.hysteresis != PROBE_GLOBAL ? probe.hysteresis : config.hysteresis;
+}
+
+// hysteresis state machine of one sensor
+AlarmEvent probesEvaluate(uint8_t index, Probe &probe) {
+    if (index >= count) {
+        return ALARM_NONE;
+    }
+    AlarmEvent event = ALARM_NONE;
+    probesLock();
+    Probe &entry = probes[index];
+    if (entry.online) {                                 // A failed reading keeps the state
+        event = alarmEvaluate(entry.alarm, entry.temp / 10.0f, probesTarget(entry), probesHysteresis(entry));
+    }
+    probe = entry;
+    probesUnlock();
+    return event;
+}
+
+// copy of an entry
+bool probesGet(uint8_t index, Probe &probe) {
+    if (index >= count) {
+        return false;
+    }
+    probesLock();
+    probe = probes[index];
+    probesUnlock();
+    return true;
+}
+
+// SENSOR_<n>_NAME/_TARGET/_HYSTERESIS (n = 1..count), SENSORS_RESET
+bool probesApplyParam(const char *key, const char *value) {
+    if (strcmp(key, "SENSORS_RESET") == 0) {
+        probesLock();
+        for (uint8_t i = 0; i < count; i++) { resetMinMax(probes[i]); }
+        probesUnlock();
+        return true;
+    }
+
+    unsigned n;
+    char field[16];
+    if (sscanf(key, "SENSOR_%u_%15s", &n, field) != 2 || n < 1 || n > count) {
+        return false;
+    }
+
+    Probe &probe = probes[n - 1];
+    char *end;
+    long number = strtol(value, &end, 10);
+    bool global = *value == '\0' || end == value;       // Empty -> follow TARGET_TEMP/HYSTERESIS
+
+    probesLock();
+    if (strcmp(field, "NAME") == 0) {
+        strncpy(probe.name, value, sizeof(probe.name) - 1);
+        probe.name[sizeof(probe.name) - 1] = '\0';
+    } else if (strcmp(field, "TARGET") == 0) {
+        probe.targetTemp = global ? PROBE_GLOBAL : clampSetting(number, 0, 25);
+    } else if (strcmp(field, "HYSTERESIS") == 0) {
+        probe.hysteresis = global ? PROBE_GLOBAL : clampSetting(number, 0, 10);
+    } else {
+        probesUnlock();
+        return false;
+    }
+    dirty = true;
+    lastChange = halMillis();
+    probesUnlock();
+    return true;
+}
+
+// add the "SENSORS" array
+void probesToJson(JsonDocument &doc) {
+    JsonArray array = doc["SENSORS"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+        Probe probe;
+        probesGet(i, probe);
+        JsonObject entry = array.add<JsonObject>();
+        entry["id"] = probe.id;
+        entry["name"] = probe.name;
+        entry["online"] = probe.online;
+        if (probe.online) { entry["temp"] = probe.temp / 10.0f; }
+        entry["min"] = probe.minTemp / 10.0f;           // 100 / -100 = no reading yet, like MIN_TEMP/MAX_TEMP
+        entry["max"] = probe.maxTemp / 10.0f;
+        entry["target"] = probesTarget(probe);
+        entry["hysteresis"] = probesHysteresis(probe);
+        entry["global"] = probe.targetTemp == PROBE_GLOBAL;
+        entry["alarm"] = probe.alarm;
+    }
+}
+
+// add "SENSOR_TEMPS": [temp, min, max] per sensor in 1/10 °C, temp null while offline
+void probesReadingsToJson(JsonDocument &doc) {
+    JsonArray array = doc["SENSOR_TEMPS"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+        Probe probe;
+        probesGet(i, probe);
+        JsonArray entry = array.add<JsonArray>();
+        if (probe.online) { entry.add(probe.temp); } else { entry.add(nullptr); }
+        entry.add(probe.minTemp);
+        entry.add(probe.maxTemp);
+    }
+}
+
+// FNV-1a over some bytes
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) { hash = (hash ^ p[i]) * 16777619u; }
+    return hash;
+}
+
+// changes with a name/threshold/online/alarm change, not with every reading
+uint32_t probesChecksum() {
+    uint32_t hash = 2166136261u;
+    probesLock();
+    for (uint8_t i = 0; i < count; i++) {
+        const Probe &probe = probes[i];
+        hash = fnv1a(hash, probe.id, sizeof(probe.id));
+        hash = fnv1a(hash, probe.name, sizeof(probe.name));
+        hash = fnv1a(hash, &probe.targetTemp, sizeof(probe.targetTemp));
+        hash = fnv1a(hash, &probe.hysteresis, sizeof(probe.hysteresis));
+        hash = fnv1a(hash, &probe.online, sizeof(probe.online));
+        hash = fnv1a(hash, &probe.alarm, sizeof(probe.alarm));
+    }
+    probesUnlock();
+    return hash;
+}
+
+// changes with any reading or min/max
+uint32_t probesReadingsChecksum() {
+    uint32_t hash = 2166136261u;
+    probesLock();
+    for (uint8_t i = 0; i < count; i++) {
+        const Probe &probe = probes[i];
+        hash = fnv1a(hash, &probe.temp, sizeof(probe.temp));
+        hash = fnv1a(hash, &probe.minTemp, sizeof(probe.minTemp));
+        hash = fnv1a(hash, &probe.maxTemp, sizeof(probe.maxTemp));
+    }
+    probesUnlock();
+    return hash;
+}
+
+// save names/thresholds after the quiet time
+void probesLoop() {
+    probesLock();
+    bool due = dirty && halMillis() - lastChange >= PROBES_COMMIT_QUIET_MS;
+    probesUnlock();
+    if (due) {
+        probesCommitNow();
+    }
+}
+
+// keep the change for the next attempt after the quiet time (write failed)
+static void probesRetryLater() {
+    probesLock();
+    dirty = true;
+    lastChange = halMillis();
+    probesUnlock();
+}
+
+// save now if changed, entries of absent sensors are kept
+void probesCommitNow() {
+    probesLock();
+    bool changed = dirty;
+    dirty = false;                                      // Changes from now on are saved next time
+    probesUnlock();
+    if (!changed) {
+        return;
+    }
+
+    static char buffer[PROBES_FILE_MAX];
+    JsonDocument doc;
+    if (halFileExists(PROBES_FILE)) {
+        size_t len = halFileRead(PROBES_FILE, buffer, sizeof(buffer));
+        deserializeJson(doc, buffer, len);
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        Probe probe;
+        probesGet(i, probe);
+        JsonObject entry = doc[probe.id].to<JsonObject>();
+        entry["name"] = probe.name;
+        if (probe.targetTemp != PROBE_GLOBAL) { entry["target"] = probe.targetTemp; }
+        if (probe.hysteresis != PROBE_GLOBAL) { entry["hysteresis"] = probe.hysteresis; }
+    }
+
+    if (measureJson(doc) >= sizeof(buffer)) {
+        debugln("❌ " PROBES_FILE " too large");
+        probesRetryLater();
+        return;
+    }
+    size_t len = serializeJson(doc, buffer, sizeof(buffer));
+    if (halFileWrite(PROBES_TMP_FILE, buffer, len) != len || !halFileRename(PROBES_TMP_FILE, PROBES_FILE)) {
+        debugln("❌ Failed to write " PROBES_FILE);
+        halFileRemove(PROBES_TMP_FILE);
+        probesRetryLater();
+        return;
+    }
+    debugf("💾 Sensor settings saved (%u bytes)\n", (unsigned)len);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "alarm.h"
+
+// ======================================================================
+// Per-sensor table
+// ======================================================================
+// One entry per DS18B20 on the bus, keyed by its ROM address: name,
+// threshold, hysteresis, min/max and alarm state. Names and thresholds
+// are kept in /sensors.json (entries of sensors not currently on the
+// bus are preserved). A sensor without its own threshold follows
+// TARGET_TEMP/HYSTERESIS. Min/max are RAM only; the first sensor also
+// drives FRIDGE_TEMP, MIN_TEMP/MAX_TEMP and the history as before.
+
+#define PROBES_FILE "/sensors.json"                     // Names and thresholds by ROM address
+#define PROBES_TMP_FILE "/sensors.json.tmp"             // Written first, then renamed
+#define PROBES_FILE_MAX 1024                            // Max. size of the file
+#define PROBES_COMMIT_QUIET_MS 5000                     // Save 5 s after the last change
+#define PROBE_NAME_LEN 16                               // Incl. terminator
+#define PROBE_GLOBAL -128                               // targetTemp/hysteresis: follow TARGET_TEMP/HYSTERESIS
+#define PROBES_RISE_SPAN_MS 120000                      // Rise per sensor over at least 2 min (readings step by 1/16 °C)
+
+// Compact entry, temperatures in 1/10 °C
+struct Probe {
+    char id[17];                                        // ROM address as hex
+    char name[PROBE_NAME_LEN];                          // Display name
+    int8_t targetTemp;                                  // Alarm threshold in °C or PROBE_GLOBAL
+    int8_t hysteresis;                                  // Hysteresis in °C or PROBE_GLOBAL
+    int16_t temp;                                       // Last reading
+    int16_t minTemp;                                    // Lowest reading since reset (1000 = none)
+    int16_t maxTemp;                                    // Highest reading since reset (-1000 = none)
+    int16_t rise;                                       // °C/min in 1/100 over the last PROBES_RISE_SPAN_MS, 0 until known
+    bool online;                                        // Last reading succeeded
+    bool alarm;                                         // Alarm state
+};
+
+void probesBegin();                                     // Build the table from the sensors found, load names/thresholds
+uint8_t probesCount();                                  // Number of entries
+void probesUpdate();                                    // Take over the last readings (after sensorPoll)
+AlarmEvent probesEvaluate(uint8_t index, Probe &probe); // Hysteresis state machine of one sensor, copy of the entry
+bool probesGet(uint8_t index, Probe &probe);            // Copy of an entry
+int probesTarget(const Probe &probe);                   // Effective threshold in °C
+int probesHysteresis(const Probe &probe);               // Effective hysteresis in °C
+bool probesApplyParam(const char *key, const char *value);  // SENSOR_<n>_NAME/_TARGET/_HYSTERESIS, SENSORS_RESET
+void probesToJson(JsonDocument &doc);                   // Add the "SENSORS" array
+void probesReadingsToJson(JsonDocument &doc);           // Add "SENSOR_TEMPS": [temp, min, max] per sensor in 1/10 °C
+uint32_t probesChecksum();                              // Changes with a name/threshold/online/alarm change (table refetch)
+uint32_t probesReadingsChecksum();                      // Changes with any reading or min/max (SENSOR_TEMPS push)
+void probesLoop();                                      // Save names/thresholds after the quiet time
+void probesCommitNow();                                 // Save now if changed (before restart/sleep)
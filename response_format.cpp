@@ -0,0 +1,57 @@
+#include "response_format.h"
+#include <string.h>
+
+// pick the format from ?fmt= or the Accept header
+ResponseFormat responseFormat(const char *fmt, const char *accept) {
+    if (fmt != nullptr && fmt[0] != '\0') {
+        return strcmp(fmt, "msgpack") == 0 ? FORMAT_MSGPACK : FORMAT_JSON;
+    }
+    if (accept != nullptr && strstr(accept, FORMAT_MSGPACK_TYPE) != nullptr) {
+        return FORMAT_MSGPACK;
+    }
+    return FORMAT_JSON;
+}
+
+// content type of a format
+const char *responseContentType(ResponseFormat format) {
+    return format == FORMAT_MSGPACK ? FORMAT_MSGPACK_TYPE : "application/json";
+}
+
+// build the filter document for a comma separated key list, false if nothing is selected
+bool responseFilter(const char *fields, JsonDocument &filter) {
+    if (fields == nullptr) {
+        return false;
+    }
+    uint8_t keys = 0;
+    const char *start = fields;
+    while (*start != '\0' && keys < FORMAT_FIELDS_MAX) {
+        const char *end = strchr(start, ',');
+        size_t len = end != nullptr ? (size_t)(end - start) : strlen(start);
+        if (len > 0) {
+            char key[32];
+            len = len < sizeof(key) ? len : sizeof(key) - 1;
+            memcpy(key, start, len);
+            key[len] = '\0';
+            filter[key] = true;
+            keys++;
+        }
+        if (end == nullptr) {
+            break;
+        }
+        start = end + 1;
+    }
+    return keys > 0;
+}
+
+// serialized size of a document
+size_t responseMeasure(const JsonDocument &doc, ResponseFormat format) {
+    return format == FORMAT_MSGPACK ? measureMsgPack(doc) : measureJson(doc);
+}
+
+// serialize a document, returns the length (0 if it does not fit)
+size_t responseSerialize(const JsonDocument &doc, ResponseFormat format, char *buffer, size_t size) {
+    if (responseMeasure(doc, format) >= size) {         // Room for the terminator of JSON
+        return 0;
+    }
+    return format == FORMAT_MSGPACK ? serializeMsgPack(doc, buffer, size) : serializeJson(doc, buffer, size);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Response formats
+// ======================================================================
+// /getdata, /getsys and /history answer in JSON (CSV for /history) by
+// default and in MessagePack with ?fmt=msgpack or an Accept header that
+// lists application/msgpack; ?fmt= wins over the header. ?fields=A,B
+// selects top-level keys, so a poller that only needs FRIDGE_TEMP and
+// ALARM does not transfer and parse the whole document.
+
+#define FORMAT_MSGPACK_TYPE "application/msgpack"
+#define FORMAT_FIELDS_MAX 16                            // Keys per ?fields= selection
+
+enum ResponseFormat : uint8_t {
+    FORMAT_JSON,
+    FORMAT_MSGPACK
+};
+
+ResponseFormat responseFormat(const char *fmt, const char *accept);   // ?fmt= value and Accept header, either may be null
+const char *responseContentType(ResponseFormat format);
+bool responseFilter(const char *fields, JsonDocument &filter);  // Filter document for ?fields=, false: all fields
+size_t responseMeasure(const JsonDocument &doc, ResponseFormat format);
+size_t responseSerialize(const JsonDocument &doc, ResponseFormat format, char *buffer, size_t size);
@@ -0,0 +1,175 @@
+#include "rtc_state.h"
+#include <esp_rom_crc.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include "config_schema.h"
+#include "history.h"
+#include "persist.h"
+#include "sampling.h"
+#include "sensor.h"
+#include "debug.h"
+
+// State carried from one wake to the next, valid while magic and crc match
+struct RtcState {
+    uint32_t magic;
+    int16_t targetTemp;                                 // TARGET_TEMP
+    uint16_t sleepMin;                                  // DEEP_SLEEP_MIN_INTERVAL in minutes
+    uint16_t sleepMax;                                  // DEEP_SLEEP_INTERVAL in minutes
+    uint8_t sensorResolution;                           // SENSOR_RESOLUTION
+    uint8_t count;                                      // Samples in the ring
+    float minTemp;                                      // MIN_TEMP
+    float maxTemp;                                      // MAX_TEMP
+    float lastTemp;                                     // FRIDGE_TEMP of the newest sample
+    uint32_t tsBase;                                    // History timestamp at clockBase (clock not set)
+    uint32_t clockBase;                                 // time() when the state was seeded
+    HistorySample ring[RTC_RING_SAMPLES];               // Samples not yet on flash
+    uint32_t crc;                                       // CRC32 of everything above
+};
+
+// Awake time per cycle, kept separately so it survives the drain
+struct RtcCycleStats {
+    uint32_t magic;
+    uint32_t fastWakes;                                 // Cycles that did not touch flash
+    uint32_t fullWakes;                                 // Cycles through the full setup() path
+    uint32_t lastAwakeUs;                               // Awake time of the last cycle
+    uint32_t fastAwakeUs;                               // Average awake time of fast cycles (EWMA 1/8)
+    uint32_t fullAwakeUs;                               // Average awake time of full cycles (EWMA 1/8)
+    uint16_t sleepMinutes;                              // Wake interval chosen by the last cycle
+};
+
+RTC_DATA_ATTR static RtcState rtc;
+RTC_DATA_ATTR static RtcCycleStats cycles;
+
+// CRC32 of the state (ROM function, no table in flash)
+static uint32_t stateCrc() {
+    return esp_rom_crc32_le(0, (const uint8_t *)&rtc, offsetof(RtcState, crc));
+}
+
+// history timestamp for a sample taken now
+static uint32_t rtcNow() {
+    time_t now = time(nullptr);                         // Keeps running in deep sleep (RTC timer)
+    uint32_t ts = now > 1600000000 ? (uint32_t)now : rtc.tsBase + (uint32_t)(now - rtc.clockBase);
+    uint32_t last = rtc.count > 0 ? rtc.ring[rtc.count - 1].ts : rtc.tsBase;
+    return ts > last ? ts : last + 1;                   // Strictly increasing like historyAdd()
+}
+
+// wake interval for a sample, same policy as the sensing task (slope of the last two RTC samples)
+static uint16_t sleepMinutes(float fridgeTemp) {
+    float slope = 0;
+    if (rtc.count >= 2) {
+        const HistorySample &previous = rtc.ring[rtc.count - 2];
+        const HistorySample &last = rtc.ring[rtc.count - 1];
+        slope = (last.temp - previous.temp) / 10.0f / ((last.ts - previous.ts) / 60.0f);   // Timestamps strictly increase
+    }
+    return samplingPeriodMs(rtc.targetTemp - fridgeTemp, slope, rtc.sleepMin * 60000, rtc.sleepMax * 60000) / 60000;
+}
+
+// record the awake time and enter deep sleep
+static void sleepNow(uint16_t minutes, bool fast) {
+    if (cycles.magic != RTC_STATE_MAGIC) {
+        memset(&cycles, 0, sizeof(cycles));
+        cycles.magic = RTC_STATE_MAGIC;
+    }
+    uint32_t awakeUs = (uint32_t)esp_timer_get_time();
+    uint32_t &average = fast ? cycles.fastAwakeUs : cycles.fullAwakeUs;
+    uint32_t &wakes = fast ? cycles.fastWakes : cycles.fullWakes;
+    average = wakes == 0 ? awakeUs : average - average / 8 + awakeUs / 8;
+    wakes++;
+    cycles.lastAwakeUs = awakeUs;
+    cycles.sleepMinutes = minutes;
+
+    debugf("💤 Awake %lu ms (%s), sleeping %u minutes\n", (unsigned long)(awakeUs / 1000), fast ? "fast" : "full", minutes);
+    esp_sleep_enable_timer_wakeup((uint64_t)minutes * 60 * 1000000);
+    esp_deep_sleep_start();
+}
+
+// timer wake: sample and sleep again without touching flash
+bool rtcFastPath() {
+    if (rtc.magic != RTC_STATE_MAGIC || rtc.crc != stateCrc()) {
+        memset(&rtc, 0, sizeof(rtc));                   // Power-on or corrupted -> full path
+        return false;
+    }
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) {
+        return false;                                   // Reset/restart: full path, rtcDrain() keeps the samples
+    }
+
+    sensorBegin(rtc.sensorResolution);
+    float tempC;
+    if (sensorReadBlocking(tempC) != SENSOR_READY) {
+        rtc.crc = stateCrc();
+        sleepNow(rtc.sleepMin, true);                   // Try again soon, the full path would not do better
+    }
+
+    float fridgeTemp = roundf(tempC * 10) / 10.0f;
+    rtc.ring[rtc.count].ts = rtcNow();
+    rtc.ring[rtc.count].temp = (int16_t)lroundf(fridgeTemp * 10);
+    rtc.count++;
+    rtc.lastTemp = fridgeTemp;
+    rtc.minTemp = min(rtc.minTemp, fridgeTemp);
+    rtc.maxTemp = max(rtc.maxTemp, fridgeTemp);
+    rtc.crc = stateCrc();
+    debugf("🌡️ Fast wake: %.1f °C (%u samples in RTC memory)\n", fridgeTemp, rtc.count);
+
+    if (fridgeTemp <= rtc.targetTemp && rtc.count < RTC_RING_SAMPLES) {
+        sleepNow(sleepMinutes(fridgeTemp), true);       // Nothing for flash -> back to sleep
+    }
+    return true;                                        // Alarm or ring full -> full path
+}
+
+// move RTC samples and MIN/MAX to history + config
+void rtcDrain() {
+    if (rtc.magic != RTC_STATE_MAGIC) {
+        return;
+    }
+    for (uint8_t i = 0; i < rtc.count; i++) {
+        historyAddAt(rtc.ring[i].ts, rtc.ring[i].temp / 10.0f);
+    }
+    if (rtc.count > 0) {
+        config.fridgeTemp = rtc.lastTemp;
+    }
+    if (rtc.minTemp != config.minTemp) {
+        config.minTemp = rtc.minTemp;
+        persistMarkDirty("MIN_TEMP");
+    }
+    if (rtc.maxTemp != config.maxTemp) {
+        config.maxTemp = rtc.maxTemp;
+        persistMarkDirty("MAX_TEMP");
+    }
+    debugf("💾 %u samples from RTC memory\n", rtc.count);
+    rtc.magic = 0;                                      // Consumed, rtcDeepSleep() seeds it again
+}
+
+// seed the RTC state from config and sleep
+void rtcDeepSleep() {
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.magic = RTC_STATE_MAGIC;
+    rtc.targetTemp = config.targetTemp;
+    rtc.sleepMin = config.deepSleepMinInterval;
+    rtc.sleepMax = config.deepSleepInterval;
+    rtc.sensorResolution = config.sensorResolution;
+    rtc.minTemp = config.minTemp;
+    rtc.maxTemp = config.maxTemp;
+    rtc.lastTemp = config.fridgeTemp;
+    rtc.tsBase = historyLastTimestamp();
+    rtc.clockBase = (uint32_t)time(nullptr);
+    rtc.crc = stateCrc();
+    sleepNow(sleepMinutes(config.fridgeTemp), false);
+}
+
+// add awake times per wake cycle
+void rtcStats(JsonDocument &sys) {
+    if (cycles.magic != RTC_STATE_MAGIC) {
+        return;                                         // Never been in DEEP_SLEEP mode since power-on
+    }
+    sys["deep_sleep_fast_wakes"] = cycles.fastWakes;
+    sys["deep_sleep_full_wakes"] = cycles.fullWakes;
+    sys["deep_sleep_last_awake_ms"] = cycles.lastAwakeUs / 1000;
+    sys["deep_sleep_fast_awake_ms"] = cycles.fastAwakeUs / 1000;
+    sys["deep_sleep_full_awake_ms"] = cycles.fullAwakeUs / 1000;
+    if (cycles.sleepMinutes > 0) {                      // Fast wakes per hour at the current interval, radio off
+        float wakesPerHour = 60.0f / cycles.sleepMinutes;
+        sys["deep_sleep_interval_min"] = cycles.sleepMinutes;
+        sys["deep_sleep_samples_per_hour"] = roundf(wakesPerHour * 10) / 10;
+        sys["deep_sleep_energy_mj_per_hour"] = roundf(wakesPerHour * cycles.fastAwakeUs / 1000 * SAMPLING_ACTIVE_MW / 1000);
+    }
+}
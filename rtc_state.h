@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// DEEP_SLEEP fast path
+// ======================================================================
+// Thresholds, MIN/MAX and the samples since the last flush are kept in
+// RTC slow memory (CRC protected), so a timer wake only reads the sensor
+// and goes back to sleep: no LittleFS mount, no config parsing, no
+// timers. The full setup() path runs only when flash has to be touched:
+// alarm (switch to NORMAL), RTC ring full or state invalid. The wake
+// interval adapts like the NORMAL mode period (sampling.h).
+
+#define RTC_RING_SAMPLES 32                             // Samples kept before a flush (8 hours at 15 minutes)
+#define RTC_STATE_MAGIC 0x52544302                      // "RTC" + layout version, change with RtcState
+
+bool rtcFastPath();                                     // Timer wake: sample + sleep, returns (true if sampled) when flash is needed
+void rtcDrain();                                        // Move RTC samples and MIN/MAX to history + config (full path)
+void rtcDeepSleep();                                    // Seed the RTC state from config, record the awake time and sleep
+void rtcStats(JsonDocument &sys);                       // Add awake times per wake cycle
@@ -0,0 +1,407 @@
+#include "rules.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "probes.h"
+#include "sensor.h"
+#include "hal.h"
+#include "debug.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static portMUX_TYPE rulesMux = portMUX_INITIALIZER_UNLOCKED;
+static void rulesLock() { portENTER_CRITICAL(&rulesMux); }
+static void rulesUnlock() { portEXIT_CRITICAL(&rulesMux); }
+#else
+static void rulesLock() {}                              // Native build is single threaded
+static void rulesUnlock() {}
+#endif
+
+static const char *const whenNames[] = {"above", "below", "offline"};
+static const char *const severityNames[] = {"info", "warning", "critical"};
+static const char *const severityTexts[] = {"Info", "Warnung", "Kritisch"};
+
+// Definitions and compiled table of the firmware, written by /getdata, evaluated by the sensing task
+static RuleDef defs[RULES_MAX];
+static uint8_t defCount = 0;
+static RuleTable table;
+static bool dirty = false;                              // Definitions changed, not yet saved
+static uint32_t raised = 0;                             // RULE_RAISED events since boot
+
+// index of a name in a list, -1 if missing or unknown
+static int lookup(const char *name, const char *const *names, int count) {
+    for (int i = 0; name != nullptr && i < count; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// limit a setting to its range
+static long clampSetting(long value, long lo, long hi) {
+    return value < lo ? lo : (value > hi ? hi : value);
+}
+
+// °C to 1/10 °C in the range of the sensors
+static int16_t tenths(float value) {
+    long t = lroundf(value * 10);
+    return (int16_t)(t < -1270 ? -1270 : (t > 1250 ? 1250 : t));
+}
+
+// definitions from JSON, false if invalid
+bool rulesParse(const char *json, size_t len, RuleDef *out, uint8_t &count) {
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, json, len);
+    if (error) {
+        debugf("❌ Rules: %s\n", error.c_str());
+        return false;
+    }
+    JsonArrayConst array = doc.as<JsonArrayConst>();
+    if (array.isNull() || array.size() > RULES_MAX) {
+        debugf("❌ Rules: array of at most %u rules expected\n", RULES_MAX);
+        return false;
+    }
+
+    count = 0;
+    for (JsonObjectConst rule : array) {
+        RuleDef &def = out[count];
+        memset(&def, 0, sizeof(def));                   // Comparable with memcmp()
+        int when = lookup(rule["when"].as<const char *>(), whenNames, 3);
+        int severity = rule["severity"].isNull() ? RULE_WARNING : lookup(rule["severity"].as<const char *>(), severityNames, 3);
+        if (when < 0 || severity < 0 || (when != RULE_OFFLINE && !rule["temp"].is<float>())) {
+            debugf("❌ Rules: rule %u needs when=above/below/offline, temp and a known severity\n", count + 1);
+            return false;
+        }
+        if (rule["name"].is<const char *>()) {
+            strncpy(def.name, rule["name"].as<const char *>(), sizeof(def.name) - 1);
+        } else {
+            snprintf(def.name, sizeof(def.name), "Regel %u", count + 1);
+        }
+        if (rule["text"].is<const char *>()) {
+            strncpy(def.text, rule["text"].as<const char *>(), sizeof(def.text) - 1);
+        }
+        def.when = (RuleWhen)when;
+        def.severity = (RuleSeverity)severity;
+        def.sensor = (uint8_t)clampSetting(rule["sensor"] | 0, 0, SENSOR_MAX);
+        def.temp = tenths(rule["temp"] | 0.0f);
+        def.hysteresis = tenths(fabsf(rule["hysteresis"] | 1.0f));
+        def.samples = (uint16_t)clampSetting(rule["samples"] | 1, 1, 1000);
+        def.forS = (uint32_t)clampSetting(rule["for"] | 0L, 0, 86400);
+        def.reminder = (uint16_t)clampSetting(rule["reminder"] | 0, 0, 1440);
+        count++;
+    }
+    return true;
+}
+
+// flat table, one entry per rule and sensor, all entries idle
+void rulesCompile(const RuleDef *in, uint8_t count, uint8_t probes, RuleTable &out) {
+    memset(&out, 0, sizeof(out));
+    for (uint8_t r = 0; r < count; r++) {
+        const RuleDef &def = in[r];
+        uint8_t first = def.sensor > 0 ? def.sensor - 1 : 0;
+        uint8_t last = def.sensor > 0 ? def.sensor : probes;
+        for (uint8_t p = first; p < last && p < probes && out.size < RULES_ENTRIES_MAX; p++) {
+            RuleEntry &entry = out.entries[out.size++];
+            entry.rule = r;
+            entry.probe = p;
+            entry.when = def.when;
+            entry.raise = def.temp;
+            entry.clear = def.when == RULE_BELOW ? def.temp + def.hysteresis : def.temp - def.hysteresis;
+            entry.samples = def.samples;
+            entry.forMs = def.forS * 1000;
+            entry.reminderMs = def.reminder * 60000;
+        }
+    }
+}
+
+// one sample of all sensors, returns the events
+uint8_t rulesEvaluateTable(RuleTable &t, const RuleInput *inputs, uint8_t probes, uint32_t nowMs,
+                           RuleEvent *events, uint8_t maxEvents) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < t.size; i++) {
+        const RuleEntry &entry = t.entries[i];
+        RuleState &state = t.state[i];
+        if (entry.probe >= probes) {
+            continue;
+        }
+        const RuleInput &input = inputs[entry.probe];
+        bool met;
+        if (entry.when == RULE_OFFLINE) {
+            met = !input.online;
+        } else if (!input.online) {                     // A failed reading keeps the state
+            continue;
+        } else if (entry.when == RULE_ABOVE) {
+            met = state.active ? input.temp >= entry.clear : input.temp > entry.raise;
+        } else {
+            met = state.active ? input.temp <= entry.clear : input.temp < entry.raise;
+        }
+
+        RuleEventType type;
+        if (!state.active) {
+            if (!met) {
+                state.samples = 0;
+                continue;
+            }
+            if (state.samples == 0) {
+                state.sinceMs = nowMs;
+            }
+            if (state.samples < UINT16_MAX) {
+                state.samples++;
+            }
+            if (state.samples < entry.samples || nowMs - state.sinceMs < entry.forMs) {   // Not long enough yet
+                continue;
+            }
+            state.active = true;
+            state.nextReminderMs = nowMs + entry.reminderMs;
+            type = RULE_RAISED;
+        } else if (!met) {
+            state.active = false;
+            state.samples = 0;
+            type = RULE_CLEARED;
+        } else if (entry.reminderMs > 0 && (int32_t)(nowMs - state.nextReminderMs) >= 0) {
+            state.nextReminderMs += entry.reminderMs;
+            if ((int32_t)(nowMs - state.nextReminderMs) >= 0) {     // Late by more than a period -> no burst
+                state.nextReminderMs = nowMs + entry.reminderMs;
+            }
+            type = RULE_REMINDER;
+        } else {
+            continue;
+        }
+
+        if (n < maxEvents) {
+            events[n++] = {type, entry.rule, entry.probe, input.temp, t.generation};
+        } else {
+            t.dropped++;
+        }
+    }
+    return n;
+}
+
+// pair each definition of "to" with an identical, not yet paired one of "from"
+void rulesMatch(const RuleDef *from, uint8_t fromCount, const RuleDef *to, uint8_t toCount, int8_t *map) {
+    bool paired[RULES_MAX] = {};
+    for (uint8_t r = 0; r < toCount; r++) {
+        map[r] = -1;
+        for (uint8_t f = 0; f < fromCount; f++) {
+            if (!paired[f] && memcmp(&from[f], &to[r], sizeof(RuleDef)) == 0) {
+                paired[f] = true;
+                map[r] = f;
+                break;
+            }
+        }
+    }
+}
+
+// state of the entries of unchanged definitions on the same sensor, returns the active entries without a successor
+uint8_t rulesCarryState(const RuleTable &from, RuleTable &to, const int8_t *map, RuleEvent *cleared) {
+    bool carried[RULES_ENTRIES_MAX] = {};
+    for (uint8_t i = 0; i < to.size; i++) {
+        const RuleEntry &entry = to.entries[i];
+        for (uint8_t j = 0; map[entry.rule] >= 0 && j < from.size; j++) {
+            if (!carried[j] && from.entries[j].rule == map[entry.rule] && from.entries[j].probe == entry.probe) {
+                to.state[i] = from.state[j];
+                carried[j] = true;
+                break;
+            }
+        }
+    }
+    to.dropped = from.dropped;
+
+    uint8_t n = 0;
+    for (uint8_t j = 0; j < from.size; j++) {
+        if (from.state[j].active && !carried[j]) {
+            cleared[n++] = {RULE_CLEARED, from.entries[j].rule, from.entries[j].probe, 0, from.generation};
+        }
+    }
+    return n;
+}
+
+// expand {rule} {sensor} {temp} {limit} {severity} in the template
+size_t rulesFormat(const RuleDef &def, const RuleEvent &event, const char *sensorName, char *text, size_t size) {
+    size_t len = 0;
+    for (const char *p = def.text; *p != '\0' && len + 1 < size; p++) {
+        const char *end = *p == '{' ? strchr(p, '}') : nullptr;
+        if (end != nullptr) {
+            char value[24];
+            const char *insert = nullptr;
+            size_t key = end - p - 1;
+            if (key == 4 && strncmp(p + 1, "rule", 4) == 0) {
+                insert = def.name;
+            } else if (key == 6 && strncmp(p + 1, "sensor", 6) == 0) {
+                insert = sensorName;
+            } else if (key == 4 && strncmp(p + 1, "temp", 4) == 0) {
+                if (def.when == RULE_OFFLINE) {
+                    insert = "-";
+                } else {
+                    snprintf(value, sizeof(value), "%.1f", event.temp / 10.0);
+                    insert = value;
+                }
+            } else if (key == 5 && strncmp(p + 1, "limit", 5) == 0) {
+                snprintf(value, sizeof(value), "%.1f", def.temp / 10.0);
+                insert = value;
+            } else if (key == 8 && strncmp(p + 1, "severity", 8) == 0) {
+                insert = severityTexts[def.severity];
+            }
+            if (insert != nullptr) {
+                len += snprintf(text + len, size - len, "%s", insert);
+                len = len < size ? len : size - 1;      // Truncated
+                p = end;
+                continue;
+            }
+        }
+        text[len++] = *p;
+    }
+    text[len] = '\0';
+    return len;
+}
+
+// add the definitions to an array, optionally with the active flag
+static void defsToJson(JsonArray array, bool withState) {
+    for (uint8_t r = 0; r < defCount; r++) {
+        const RuleDef &def = defs[r];
+        JsonObject rule = array.add<JsonObject>();
+        rule["name"] = def.name;
+        rule["when"] = whenNames[def.when];
+        if (def.when != RULE_OFFLINE) {
+            rule["temp"] = def.temp / 10.0f;
+            rule["hysteresis"] = def.hysteresis / 10.0f;
+        }
+        if (def.sensor > 0) { rule["sensor"] = def.sensor; }
+        if (def.forS > 0) { rule["for"] = def.forS; }
+        if (def.samples > 1) { rule["samples"] = def.samples; }
+        rule["severity"] = severityNames[def.severity];
+        if (def.text[0] != '\0') { rule["text"] = def.text; }
+        if (def.reminder > 0) { rule["reminder"] = def.reminder; }
+        if (withState) {
+            bool active = false;
+            rulesLock();
+            for (uint8_t i = 0; i < table.size; i++) {
+                active |= table.entries[i].rule == r && table.state[i].active;
+            }
+            rulesUnlock();
+            rule["active"] = active;
+        }
+    }
+}
+
+// load and compile /rules.json
+void rulesBegin() {
+    defCount = 0;
+    if (halFileExists(RULES_FILE)) {
+        static char buffer[RULES_FILE_MAX];
+        size_t len = halFileRead(RULES_FILE, buffer, sizeof(buffer));
+        if (!rulesParse(buffer, len, defs, defCount)) {
+            defCount = 0;
+        }
+    }
+    uint16_t generation = table.generation + 1;
+    rulesCompile(defs, defCount, probesCount(), table);
+    table.generation = generation;
+    if (defCount > 0) {
+        debugf("📏 %u rule(s), %u table entries\n", defCount, table.size);
+    }
+}
+
+// one sample of all sensors (sensing task)
+uint8_t rulesEvaluate(const RuleInput *inputs, uint8_t probes, uint32_t nowMs, RuleEvent *events, uint8_t maxEvents) {
+    rulesLock();
+    uint8_t n = rulesEvaluateTable(table, inputs, probes, nowMs, events, maxEvents);
+    rulesUnlock();
+    for (uint8_t i = 0; i < n; i++) {
+        raised += events[i].type == RULE_RAISED;
+    }
+    return n;
+}
+
+// copy of a definition of the table an event came from
+bool rulesGet(uint8_t rule, uint16_t generation, RuleDef &def) {
+    rulesLock();
+    bool valid = generation == table.generation && rule < defCount;
+    if (valid) {
+        def = defs[rule];
+    }
+    rulesUnlock();
+    return valid;
+}
+
+// RULES=[...]: parse, compile and swap in; unchanged definitions keep their state
+bool rulesApplyParam(const char *key, const char *value) {
+    if (strcmp(key, "RULES") != 0) {
+        return false;
+    }
+    static RuleDef parsed[RULES_MAX];                   // Only /getdata writes, too large for its stack
+    static RuleTable compiled;
+    uint8_t count = 0;
+    size_t len = strlen(value);
+    if (len >= RULES_FILE_MAX || !rulesParse(value, len, parsed, count)) {
+        return false;
+    }
+    if (count == defCount && memcmp(parsed, defs, count * sizeof(RuleDef)) == 0) {
+        return true;
+    }
+    rulesCompile(parsed, count, probesCount(), compiled);
+    static RuleDef previous[RULES_MAX];                 // Names of removed rules for the log
+    int8_t map[RULES_MAX];
+    memcpy(previous, defs, sizeof(previous));           // Only this function writes defs
+    rulesMatch(previous, defCount, parsed, count, map);
+
+    RuleEvent cleared[RULES_ENTRIES_MAX];
+    rulesLock();
+    uint8_t removed = rulesCarryState(table, compiled, map, cleared);   // The sensing task may have changed the state until now
+    compiled.generation = table.generation + 1;         // Events of the old table are dropped
+    memcpy(defs, parsed, sizeof(defs));
+    defCount = count;
+    table = compiled;
+    rulesUnlock();
+    dirty = true;
+    debugf("📏 %u rule(s), %u table entries\n", count, compiled.size);
+    for (uint8_t i = 0; i < removed; i++) {
+        debugf("📏 Rule %s cleared on sensor %u (changed or removed)\n", previous[cleared[i].rule].name, cleared[i].probe + 1);
+    }
+    return true;
+}
+
+// add the "RULES" array with the active flag of each rule
+void rulesToJson(JsonDocument &doc) {
+    defsToJson(doc["RULES"].to<JsonArray>(), true);
+}
+
+// save changed definitions
+void rulesLoop() {
+    if (!dirty) {
+        return;
+    }
+    dirty = false;
+
+    static char buffer[RULES_FILE_MAX];
+    JsonDocument doc;
+    defsToJson(doc.to<JsonArray>(), false);
+    if (measureJson(doc) >= sizeof(buffer)) {
+        debugln("❌ " RULES_FILE " too large");
+        return;
+    }
+    size_t len = serializeJson(doc, buffer, sizeof(buffer));
+    if (halFileWrite(RULES_TMP_FILE, buffer, len) != len || !halFileRename(RULES_TMP_FILE, RULES_FILE)) {
+        debugln("❌ Failed to write " RULES_FILE);
+        halFileRemove(RULES_TMP_FILE);
+        return;
+    }
+    debugf("💾 Rules saved (%u bytes)\n", (unsigned)len);
+}
+
+// add rule/entry counts and events
+void rulesStats(JsonDocument &sys) {
+    uint8_t active = 0;
+    rulesLock();
+    for (uint8_t i = 0; i < table.size; i++) {
+        active += table.state[i].active;
+    }
+    uint32_t dropped = table.dropped;
+    rulesUnlock();
+    sys["rules_defined"] = defCount;
+    sys["rules_entries"] = table.size;
+    sys["rules_active"] = active;
+    sys["rules_raised"] = raised;
+    sys["rules_events_dropped"] = dropped;
+}
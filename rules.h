@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Alarm rules
+// ======================================================================
+// Additional alarms next to the TARGET_TEMP alarm of each sensor, kept
+// in /rules.json and set with /getdata?RULES=[...]:
+//
+//   [{"name":"Warnung","when":"above","temp":7,"hysteresis":1},
+//    {"name":"Kritisch","when":"above","temp":10,"for":300,"severity":"critical","reminder":30,
+//     "text":"{sensor}: {temp}°C seit 5 Minuten über {limit}°C"},
+//    {"name":"Sensor weg","when":"offline","samples":3}]
+//
+//   sensor      1..n, 0 or missing = every sensor
+//   when        above, below or offline
+//   temp        limit in °C (above/below)
+//   hysteresis  °C past the limit before the rule clears (default 1)
+//   for         seconds the condition must hold (e.g. defrost excursions)
+//   samples     consecutive samples the condition must hold
+//   severity    info (log only), warning (default) or critical
+//   text        notification, {rule} {sensor} {temp} {limit} {severity}; empty: log only
+//   reminder    minutes between reminders while active, 0 = none
+//
+// Loading compiles the definitions into a flat table, one entry per rule
+// and sensor with the limits in 1/10 °C, so the sensing task evaluates
+// each sample in O(entries) without touching JSON. Every entry has its
+// own state machine and timers; a reading that failed keeps the state of
+// above/below entries. When the rules are replaced, entries whose
+// definition and sensor are unchanged keep their state; an active entry
+// that disappears is logged as cleared. Events carry the generation of the table they came from, so an
+// event still queued when the rules are replaced is dropped instead of
+// being reported with another rule's definition.
+
+#define RULES_FILE "/rules.json"
+#define RULES_TMP_FILE "/rules.json.tmp"                // Written first, then renamed
+#define RULES_FILE_MAX 2048                             // Max. size of the file and of ?RULES=
+#define RULES_MAX 8                                     // Definitions
+#define RULES_ENTRIES_MAX 32                            // Compiled entries (rules x sensors)
+#define RULES_EVENTS_MAX 8                              // Events per evaluation
+#define RULE_NAME_LEN 16                                // Incl. terminator
+#define RULE_TEXT_LEN 96                                // Notification template incl. terminator
+
+enum RuleWhen : uint8_t {
+    RULE_ABOVE,                                         // Reading above temp
+    RULE_BELOW,                                         // Reading below temp
+    RULE_OFFLINE                                        // Reading failed
+};
+
+enum RuleSeverity : uint8_t {
+    RULE_INFO,
+    RULE_WARNING,
+    RULE_CRITICAL
+};
+
+enum RuleEventType : uint8_t {
+    RULE_RAISED,
+    RULE_CLEARED,
+    RULE_REMINDER
+};
+
+// Definition as configured
+struct RuleDef {
+    char name[RULE_NAME_LEN];
+    char text[RULE_TEXT_LEN];                           // Notification template, empty = log only
+    RuleWhen when;
+    RuleSeverity severity;
+    uint8_t sensor;                                     // 1..n, 0 = every sensor
+    int16_t temp;                                       // Limit in 1/10 °C
+    int16_t hysteresis;                                 // 1/10 °C
+    uint16_t samples;                                   // Consecutive samples, at least 1
+    uint32_t forS;                                      // Minimum duration in s
+    uint16_t reminder;                                  // Minutes, 0 = none
+};
+
+// Compiled entry: one rule on one sensor
+struct RuleEntry {
+    uint8_t rule;                                       // Index of the definition
+    uint8_t probe;                                      // Sensor index
+    RuleWhen when;
+    int16_t raise;                                      // Condition while idle, 1/10 °C
+    int16_t clear;                                      // Condition while active (limit -/+ hysteresis)
+    uint16_t samples;
+    uint32_t forMs;
+    uint32_t reminderMs;                                // 0 = none
+};
+
+// State machine of an entry
+struct RuleState {
+    bool active;
+    uint16_t samples;                                   // Consecutive samples with the condition, saturates
+    uint32_t sinceMs;                                   // First of these samples
+    uint32_t nextReminderMs;
+};
+
+struct RuleTable {
+    RuleEntry entries[RULES_ENTRIES_MAX];
+    RuleState state[RULES_ENTRIES_MAX];
+    uint8_t size;
+    uint16_t generation;                                // Changes with every new table, copied into the events
+    uint32_t dropped;                                   // Events beyond maxEvents
+};
+
+// Reading of one sensor, input of an evaluation
+struct RuleInput {
+    int16_t temp;                                       // 1/10 °C
+    bool online;
+};
+
+struct RuleEvent {
+    RuleEventType type;
+    uint8_t rule;                                       // Index of the definition
+    uint8_t probe;                                      // Sensor index
+    int16_t temp;                                       // Reading, 1/10 °C
+    uint16_t generation;                                // Table the indices refer to
+};
+
+// Portable core, also used by the native benchmark
+bool rulesParse(const char *json, size_t len, RuleDef *defs, uint8_t &count);    // Definitions from JSON, false if invalid
+void rulesCompile(const RuleDef *defs, uint8_t count, uint8_t probes, RuleTable &table);  // Flat table, all entries idle
+uint8_t rulesEvaluateTable(RuleTable &table, const RuleInput *inputs, uint8_t probes, uint32_t nowMs,
+                           RuleEvent *events, uint8_t maxEvents);  // One sample of all sensors, returns the events
+void rulesMatch(const RuleDef *from, uint8_t fromCount, const RuleDef *to, uint8_t toCount, int8_t *map);  // map[rule of to] = same rule in from, -1 if new/changed
+uint8_t rulesCarryState(const RuleTable &from, RuleTable &to, const int8_t *map, RuleEvent *cleared);  // Keep the state of unchanged entries, returns the active ones of from that are gone
+size_t rulesFormat(const RuleDef &def, const RuleEvent &event, const char *sensorName, char *text, size_t size);  // Expand the template
+
+// Rules of the firmware
+void rulesBegin();                                      // Load and compile /rules.json (after probesBegin)
+uint8_t rulesEvaluate(const RuleInput *inputs, uint8_t probes, uint32_t nowMs, RuleEvent *events, uint8_t maxEvents);  // Sensing task
+bool rulesGet(uint8_t rule, uint16_t generation, RuleDef &def);  // Copy of a definition, false if the table was replaced since the event
+bool rulesApplyParam(const char *key, const char *value);   // RULES=[...], false if not RULES or invalid
+void rulesToJson(JsonDocument &doc);                    // Add the "RULES" array with the active flag of each rule
+void rulesLoop();                                       // Save changed definitions
+void rulesStats(JsonDocument &sys);                     // Add rule/entry counts and events
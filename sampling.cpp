@@ -0,0 +1,89 @@
+#include "sampling.h"
+#include <math.h>
+#include "probes.h"
+
+// Statistics, written by the sensing task only
+static uint32_t currentPeriodMs = 0;                    // Period chosen after the last sample
+static bool windowStarted = false;
+static uint32_t windowStart = 0;                        // Time of the first sample in the window
+static uint32_t windowSamples = 0;                      // Samples in the current window
+static uint32_t windowConversionMs = 0;                 // Conversion time in the current window
+static float samplesPerHour = 0;                        // Result of the last full window
+static float energyPerHour = 0;                         // mJ, result of the last full window
+static bool windowDone = false;                         // A full window has been completed
+
+// period for the margin to the threshold at the given rate of rise
+uint32_t samplingPeriodMs(float marginC, float risePerMin, uint32_t minMs, uint32_t maxMs) {
+    if (maxMs < minMs) {
+        maxMs = minMs;
+    }
+    if (!(marginC > 0)) {                               // At/above the threshold or no reading
+        return minMs;
+    }
+    float rise = fmaxf(risePerMin, SAMPLING_ASSUMED_RISE);
+    float periodMs = marginC / rise / SAMPLING_SAFETY * 60000;
+    if (periodMs <= minMs) {
+        return minMs;
+    }
+    return periodMs >= maxMs ? maxMs : (uint32_t)periodMs;
+}
+
+// period for the current readings of all sensors, each with its own margin and rise
+uint32_t samplingProbesPeriodMs(float slopePerMin, uint32_t minMs, uint32_t maxMs) {
+    uint32_t period = 0;                                // 0 = no sensor yet
+    for (uint8_t i = 0; i < probesCount(); i++) {
+        Probe probe;
+        if (!probesGet(i, probe)) {
+            continue;
+        }
+        if (probe.alarm || !probe.online) {             // Detect the clear / the sensor coming back quickly
+            return minMs;
+        }
+        float rise = probe.rise / 100.0f;
+        if (i == 0) {                                   // Regression slope of FRIDGE_TEMP, whichever is steeper
+            rise = fmaxf(rise, slopePerMin);
+        }
+        uint32_t p = samplingPeriodMs(probesTarget(probe) - probe.temp / 10.0f, rise, minMs, maxMs);
+        if (period == 0 || p < period) {
+            period = p;
+        }
+    }
+    return period == 0 ? minMs : period;
+}
+
+// one sample taken, the next one follows after periodMs
+void samplingRecord(uint32_t nowMs, uint32_t periodMs, uint32_t conversionMs) {
+    currentPeriodMs = periodMs;
+    if (!windowStarted) {
+        windowStarted = true;
+        windowStart = nowMs;
+    }
+    uint32_t elapsed = nowMs - windowStart;
+    if (elapsed >= SAMPLING_STATS_WINDOW_MS) {          // Samples up to now, this one opens the next window
+        samplesPerHour = windowSamples * 3600000.0f / elapsed;
+        energyPerHour = (windowConversionMs * SAMPLING_SENSOR_MW / 1000 + windowSamples * SAMPLING_WAKE_MJ) * 3600000.0f / elapsed;
+        windowDone = true;
+        windowStart = nowMs;
+        windowSamples = 0;
+        windowConversionMs = 0;
+    }
+    windowSamples++;
+    windowConversionMs += conversionMs;
+}
+
+// add period, samples and estimated sensing energy per hour
+void samplingStats(JsonDocument &sys) {
+    if (!windowStarted) {
+        return;
+    }
+    float perHour = samplesPerHour;
+    float energy = energyPerHour;
+    if (!windowDone) {                                  // First hour: estimate from the current period
+        perHour = 3600000.0f / currentPeriodMs;
+        float conversionMs = windowSamples > 0 ? (float)windowConversionMs / windowSamples : 0;
+        energy = perHour * (conversionMs * SAMPLING_SENSOR_MW / 1000 + SAMPLING_WAKE_MJ);
+    }
+    sys["sampling_period_s"] = roundf(currentPeriodMs / 100.0f) / 10;
+    sys["sampling_samples_per_hour"] = roundf(perHour * 10) / 10;
+    sys["sampling_energy_mj_per_hour"] = roundf(energy);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Adaptive sampling
+// ======================================================================
+// The sampling period follows the time the warmest sensor needs to reach
+// its threshold: far below it and flat, the sensors are read every
+// SAMPLE_MAX seconds, closer or rising faster down to SAMPLE_MIN, and at
+// SAMPLE_MIN while a sensor is in alarm or offline. Each sensor counts
+// with its own rise (Probe::rise, for the first one also the regression
+// slope) but never less than SAMPLING_ASSUMED_RISE, and a period covers
+// at most half the time to its threshold at that rate: the margin
+// at least halves per sample, so a crossing always falls into a
+// SAMPLE_MIN period and is detected as fast as with a fixed SAMPLE_MIN.
+// DEEP_SLEEP applies the same policy to the wake interval between
+// DEEP_SLEEP_MIN_INTERVAL and DEEP_SLEEP_INTERVAL.
+
+#define SAMPLING_ASSUMED_RISE 0.2f                      // °C/min a period has to cover even if the reading is flat (failed compressor)
+#define SAMPLING_SAFETY 2                               // Samples before the threshold can be reached at that rate
+#define SAMPLING_STATS_WINDOW_MS 3600000                // Samples and energy per hour over the last hour
+#define SAMPLING_SENSOR_MW 5.0f                         // DS18B20 converting: 1.5 mA at 3.3 V
+#define SAMPLING_WAKE_MJ 2.0f                           // CPU wake, bus reads and decisions per sample (NORMAL mode)
+#define SAMPLING_ACTIVE_MW 130.0f                       // CPU awake with the radio off (DEEP_SLEEP fast wake)
+
+uint32_t samplingPeriodMs(float marginC, float risePerMin, uint32_t minMs, uint32_t maxMs);  // marginC <= 0: minMs
+uint32_t samplingProbesPeriodMs(float slopePerMin, uint32_t minMs, uint32_t maxMs);  // Shortest period of all sensors, slopePerMin: first sensor
+void samplingRecord(uint32_t nowMs, uint32_t periodMs, uint32_t conversionMs);  // One sample taken, next one in periodMs
+void samplingStats(JsonDocument &sys);                  // Add period, samples and estimated sensing energy per hour
@@ -0,0 +1,140 @@
+#include "sensor.h"
+#include <algorithm>
+#include "hal.h"
+#include "debug.h"
+
+static volatile SensorState state = SENSOR_IDLE;        // State of the running conversion
+static uint8_t resolution = SENSOR_DEFAULT_RESOLUTION;  // Current resolution
+static uint32_t conversionMs = 750;                     // Nominal conversion time at the current resolution
+static uint32_t startedAt = 0;                          // halMillis() when the conversion was started
+static uint8_t addresses[SENSOR_MAX][8];                // Cached ROM addresses, no bus search per sample
+static float values[SENSOR_MAX];                        // Results of the last conversion
+static bool valid[SENSOR_MAX];                          // Result could be read
+static uint8_t count = 0;                               // Sensors found
+
+// Acquisition statistics
+static uint32_t lastLatencyMs = 0;                      // Latency of the last sample (request -> value)
+static uint32_t maxLatencyMs = 0;                       // Longest latency
+static uint32_t samples = 0;                            // Successful samples
+static uint32_t timeouts = 0;                           // Conversions that did not complete
+static uint32_t errors = 0;                             // Disconnected sensor / CRC errors
+
+// start up the bus and switch to non-blocking conversions
+void sensorBegin(uint8_t bits) {
+    resolution = std::min<uint8_t>(std::max<uint8_t>(bits, 9), 12);
+    uint8_t found = halSensorBegin(resolution);         // Start up the bus, conversions return immediately
+    conversionMs = halSensorConversionMs(resolution);
+
+    count = 0;
+    for (uint8_t i = 0; i < found && count < SENSOR_MAX; i++) {
+        if (halSensorAddress(i, addresses[count])) {    // Enumerate once, read by address afterwards
+            valid[count] = false;
+            count++;
+        }
+    }
+    if (found > SENSOR_MAX) {
+        debugf("❌ %u sensors on the bus, only %u are used\n", found, SENSOR_MAX);
+    }
+    debugf("✅ %u temperature sensor(s) found, %u bit resolution (%lu ms)\n", count, resolution, (unsigned long)conversionMs);
+}
+
+// number of sensors found
+uint8_t sensorCount() {
+    return count;
+}
+
+// cached ROM address
+const uint8_t *sensorAddress(uint8_t index) {
+    return addresses[index];
+}
+
+// result of the last conversion
+bool sensorValue(uint8_t index, float &tempC) {
+    if (index >= count || !valid[index]) {
+        return false;
+    }
+    tempC = values[index];
+    return true;
+}
+
+// change resolution
+void sensorSetResolution(uint8_t bits) {
+    bits = std::min<uint8_t>(std::max<uint8_t>(bits, 9), 12);
+    if (bits != resolution && state != SENSOR_CONVERTING) {
+        halSensorSetResolution(bits);
+        resolution = bits;
+        conversionMs = halSensorConversionMs(bits);
+        debugf("✅ Temperature resolution changed to %u bit (%lu ms)\n", resolution, (unsigned long)conversionMs);
+    }
+}
+
+// start a conversion
+uint32_t sensorStart() {
+    if (state == SENSOR_CONVERTING) {                   // Previous conversion still running
+        return conversionMs;
+    }
+    halSensorRequest();                                 // Temperaturmessung anstoßen
+    startedAt = halMillis();
+    state = SENSOR_CONVERTING;
+    return conversionMs;
+}
+
+// collect the result of the running conversion
+SensorState sensorPoll(float &tempC) {
+    if (state != SENSOR_CONVERTING) {
+        return state;
+    }
+
+    uint32_t elapsed = halMillis() - startedAt;
+    if (!halSensorComplete()) {
+        if (elapsed < conversionMs * SENSOR_TIMEOUT_FACTOR) {
+            return SENSOR_CONVERTING;
+        }
+        timeouts++;
+        state = SENSOR_TIMEOUT;
+        debugf("❌ Error: Temperature conversion timed out after %lu ms\n", (unsigned long)elapsed);
+        return state;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {               // Temperatur aller Sensoren per Adresse lesen
+        valid[i] = halSensorRead(addresses[i], values[i]);
+        if (!valid[i]) {
+            errors++;
+            debugf("❌ Error: Could not read temperature data of sensor %u\n", i + 1);
+        }
+    }
+
+    if (count == 0 || !valid[0]) {                      // First sensor drives FRIDGE_TEMP and the history
+        state = SENSOR_ERROR;
+        return state;
+    }
+    tempC = values[0];
+
+    lastLatencyMs = halMillis() - startedAt;
+    maxLatencyMs = std::max(maxLatencyMs, lastLatencyMs);
+    samples++;
+    state = SENSOR_READY;
+    return state;
+}
+
+// start a conversion and wait for it
+SensorState sensorReadBlocking(float &tempC) {
+    sensorStart();
+    SensorState result;
+    while ((result = sensorPoll(tempC)) == SENSOR_CONVERTING) {
+        halDelay(10);
+    }
+    return result;
+}
+
+// add acquisition latency and error counters
+void sensorStats(JsonDocument &sys) {
+    sys["sensor_count"] = count;
+    sys["sensor_resolution"] = resolution;
+    sys["sensor_conversion_ms"] = conversionMs;
+    sys["sensor_latency_ms"] = lastLatencyMs;
+    sys["sensor_latency_max_ms"] = maxLatencyMs;
+    sys["sensor_samples"] = samples;
+    sys["sensor_timeouts"] = timeouts;
+    sys["sensor_errors"] = errors;
+}
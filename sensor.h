@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// DS18B20 acquisition
+// ======================================================================
+// Conversions are started without waiting (setWaitForConversion(false))
+// and collected on a later tick, so the timer task is never blocked for
+// the up to 750 ms a 12-bit conversion takes. All DS18B20 on the bus are
+// found once at start, their ROM addresses are cached, one broadcast
+// conversion serves all of them and each is read by address.
+
+#define SENSOR_DEFAULT_RESOLUTION 12                    // 9..12 bit (94..750 ms conversion time)
+#define SENSOR_TIMEOUT_FACTOR 2                         // Give up after 2x the nominal conversion time
+#define SENSOR_MAX 8                                    // Sensors per bus (one per display case)
+
+enum SensorState : uint8_t {
+    SENSOR_IDLE,                                        // No conversion running
+    SENSOR_CONVERTING,                                  // Conversion started, result not yet available
+    SENSOR_READY,                                       // Result read, see value
+    SENSOR_TIMEOUT,                                     // Conversion did not complete in time
+    SENSOR_ERROR                                        // Sensor disconnected or CRC error
+};
+
+void sensorBegin(uint8_t resolution);                   // Start up the bus, cache the sensor addresses, non-blocking conversions
+uint8_t sensorCount();                                  // Number of sensors found
+const uint8_t *sensorAddress(uint8_t index);            // Cached ROM address (8 bytes)
+bool sensorValue(uint8_t index, float &tempC);          // Result of the last conversion, false if that sensor failed
+void sensorSetResolution(uint8_t resolution);           // Change resolution (applied to the next conversion)
+uint32_t sensorStart();                                 // Start a conversion, returns the ms to wait for the result
+SensorState sensorPoll(float &tempC);                   // Collect the results, tempC = first sensor
+SensorState sensorReadBlocking(float &tempC);           // Start a conversion and wait for it (DEEP_SLEEP mode)
+void sensorStats(JsonDocument &sys);                    // Add acquisition latency and error counters
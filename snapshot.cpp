@@ -0,0 +1,205 @@
+#include "snapshot.h"
+#include <memory>
+#include "response_format.h"
+#include "debug.h"
+
+// Double-buffered snapshot, front is published, the other one is written
+struct Snapshot {
+    char buffer[2][SNAPSHOT_BUFFER_SIZE];               // Serialized JSON, followed by the same document as MessagePack
+    size_t len[2];                                      // Length of the JSON, 0 = never published
+    size_t packLen[2];                                  // Length of the MessagePack after it
+    char tag[2][20];                                    // "<boot id>-<version>", quoted per format in the ETag
+    uint8_t readers[2];                                 // Responses still sending from a buffer
+    uint8_t front;                                      // Published buffer
+    uint32_t version;                                   // Increased with every changed content
+    uint32_t retryMs;                                   // Backoff after a failed publish, 0 = last one succeeded
+    uint32_t failedAt;                                  // millis() of the last failed publish
+};
+
+static Snapshot snapshots[SNAPSHOT_COUNT];
+static SemaphoreHandle_t writeLock = nullptr;           // One writer at a time (loop and /getdata)
+static portMUX_TYPE snapshotMux = portMUX_INITIALIZER_UNLOCKED;  // front + readers
+static uint32_t bootId = 0;                             // Versions restart at boot, the ETag must not repeat
+
+// Statistics
+static uint32_t published = 0;                          // New versions
+static uint32_t unchanged = 0;                          // Publishes with identical content
+static uint32_t busy = 0;                               // Publishes skipped, back buffer still sending
+static uint32_t tooLarge = 0;                           // Publishes skipped, document too large
+static uint32_t notModified = 0;                        // 304 responses
+static uint32_t packed = 0;                             // Responses in MessagePack
+static uint32_t selected = 0;                           // Responses with a ?fields= selection
+
+// Hold a buffer while a response is sending from it
+struct SnapshotRef {
+    Snapshot &snapshot;
+    uint8_t index;
+    SnapshotRef(Snapshot &s, uint8_t i) : snapshot(s), index(i) {}
+    ~SnapshotRef() {
+        portENTER_CRITICAL(&snapshotMux);
+        snapshot.readers[index]--;
+        portEXIT_CRITICAL(&snapshotMux);
+    }
+};
+
+// create the writer lock, pick the boot id for the ETags
+void snapshotBegin() {
+    writeLock = xSemaphoreCreateMutex();
+    bootId = esp_random();
+}
+
+// remember a failed publish, the next retry waits twice as long (under writeLock)
+static void publishFailed(Snapshot &s) {
+    s.retryMs = s.retryMs == 0 ? SNAPSHOT_RETRY_MIN_MS : min(s.retryMs * 2, (uint32_t)SNAPSHOT_RETRY_MAX_MS);
+    s.failedAt = millis();
+}
+
+// false while a failed publish is backing off
+bool snapshotRetryDue(SnapshotId id) {
+    const Snapshot &s = snapshots[id];
+    return s.retryMs == 0 || millis() - s.failedAt >= s.retryMs;
+}
+
+// serialize into the back buffer and publish it
+bool snapshotPublish(SnapshotId id, const JsonDocument &doc) {
+    Snapshot &s = snapshots[id];
+
+    xSemaphoreTake(writeLock, portMAX_DELAY);
+    size_t size = measureJson(doc) + measureMsgPack(doc);
+    if (size >= SNAPSHOT_BUFFER_SIZE) {
+        tooLarge++;
+        if (s.retryMs == 0) {                           // Once per failing streak, not per retry
+            debugf("❌ Snapshot %d too large (%u bytes JSON + MessagePack)\n", id, (unsigned)size);
+        }
+        publishFailed(s);
+        xSemaphoreGive(writeLock);
+        return false;
+    }
+
+    portENTER_CRITICAL(&snapshotMux);
+    uint8_t back = s.front ^ 1;
+    bool inUse = s.readers[back] > 0;
+    portEXIT_CRITICAL(&snapshotMux);
+
+    if (inUse) {                                        // A slow client is still reading the old version
+        busy++;
+        publishFailed(s);
+        xSemaphoreGive(writeLock);
+        return false;
+    }
+    s.retryMs = 0;
+
+    size_t len = serializeJson(doc, s.buffer[back], SNAPSHOT_BUFFER_SIZE);
+    if (len == s.len[s.front] && memcmp(s.buffer[back], s.buffer[s.front], len) == 0) {
+        unchanged++;                                    // Same content keeps the version and the ETag
+        xSemaphoreGive(writeLock);
+        return true;
+    }
+
+    s.len[back] = len;
+    s.packLen[back] = serializeMsgPack(doc, s.buffer[back] + len, SNAPSHOT_BUFFER_SIZE - len);  // Only for changed content
+    s.version++;
+    snprintf(s.tag[back], sizeof(s.tag[back]), "%08lx-%lu", (unsigned long)bootId, (unsigned long)s.version);
+
+    portENTER_CRITICAL(&snapshotMux);
+    s.front = back;
+    portEXIT_CRITICAL(&snapshotMux);
+    published++;
+    xSemaphoreGive(writeLock);
+    return true;
+}
+
+// format requested by ?fmt= or the Accept header
+static ResponseFormat requestFormat(AsyncWebServerRequest *request) {
+    const char *fmt = request->hasParam("fmt") ? request->getParam("fmt")->value().c_str() : nullptr;
+    const char *accept = request->hasHeader("Accept") ? request->header("Accept").c_str() : nullptr;
+    return responseFormat(fmt, accept);
+}
+
+// response with a private serialization of a document
+static AsyncWebServerResponse *documentResponse(AsyncWebServerRequest *request, const JsonDocument &doc, ResponseFormat format) {
+    AsyncResponseStream *stream = request->beginResponseStream(responseContentType(format));
+    if (format == FORMAT_MSGPACK) {
+        serializeMsgPack(doc, *stream);
+    } else {
+        serializeJson(doc, *stream);
+    }
+    return stream;
+}
+
+// send the published version or 304, in the requested format and field selection
+void snapshotSend(AsyncWebServerRequest *request, SnapshotId id) {
+    Snapshot &s = snapshots[id];
+
+    portENTER_CRITICAL(&snapshotMux);
+    uint8_t index = s.front;
+    s.readers[index]++;
+    portEXIT_CRITICAL(&snapshotMux);
+    auto ref = std::make_shared<SnapshotRef>(s, index);  // Released when the response is done or aborted
+
+    if (s.len[index] == 0) {                            // Not yet published
+        request->send(503, "text/plain", "Starting up");
+        return;
+    }
+
+    ResponseFormat format = requestFormat(request);
+    char etag[28];                                      // Same version, one ETag per format
+    snprintf(etag, sizeof(etag), "\"%s%s\"", s.tag[index], format == FORMAT_MSGPACK ? "-m" : "");
+    JsonDocument filter;
+    bool selection = request->hasParam("fields") && responseFilter(request->getParam("fields")->value().c_str(), filter);
+
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+        response = request->beginResponse(304);
+        notModified++;
+    } else if (selection) {                             // Selected keys only, decoded from the MessagePack copy
+        JsonDocument doc;
+        deserializeMsgPack(doc, s.buffer[index] + s.len[index], s.packLen[index], DeserializationOption::Filter(filter));
+        response = documentResponse(request, doc, format);
+        selected++;
+    } else {
+        size_t offset = format == FORMAT_MSGPACK ? s.len[index] : 0;
+        size_t len = format == FORMAT_MSGPACK ? s.packLen[index] : s.len[index];
+        response = request->beginResponse(responseContentType(format), len,
+            [ref, offset, len](uint8_t *buffer, size_t maxLen, size_t position) -> size_t {
+                size_t n = min(maxLen, len - position);
+                memcpy(buffer, ref->snapshot.buffer[ref->index] + offset + position, n);
+                return n;
+            });
+    }
+    if (format == FORMAT_MSGPACK) {
+        packed++;
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");   // Always revalidate, the ETag makes that cheap
+    response->addHeader("Vary", "Accept");
+    request->send(response);
+}
+
+// send a private document (not a published version) in the requested format and field selection
+void snapshotSendDocument(AsyncWebServerRequest *request, const JsonDocument &doc) {
+    ResponseFormat format = requestFormat(request);
+    JsonDocument filter;
+    if (request->hasParam("fields") && responseFilter(request->getParam("fields")->value().c_str(), filter)) {
+        JsonDocument part;
+        for (JsonPairConst field : filter.as<JsonObjectConst>()) {
+            if (!doc[field.key()].isNull()) {
+                part[field.key()] = doc[field.key()];
+            }
+        }
+        request->send(documentResponse(request, part, format));
+        return;
+    }
+    request->send(documentResponse(request, doc, format));
+}
+
+// add publish/skip/304 counters
+void snapshotStats(JsonDocument &sys) {
+    sys["snapshot_published"] = published;
+    sys["snapshot_unchanged"] = unchanged;
+    sys["snapshot_busy"] = busy;
+    sys["snapshot_too_large"] = tooLarge;
+    sys["snapshot_not_modified"] = notModified;
+    sys["snapshot_msgpack"] = packed;
+    sys["snapshot_selected"] = selected;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// ======================================================================
+// JSON snapshots
+// ======================================================================
+// /getdata and /getsys are serialized once per state change into one of
+// two static buffers and published with a new version. Handlers only
+// send the published buffer and answer If-None-Match with 304. A buffer
+// is not rewritten while a response is still sending from it, so the
+// writer skips and retries later, backing off while publishing keeps
+// failing, instead of blocking. Every version is
+// kept as JSON and as MessagePack (response_format.h), ?fields= is
+// decoded from the MessagePack copy per request.
+
+// Worst case /getsys (110 keys, all counters 10 digits, 3 x 24 heap history): 4.2 KB JSON + 3.0 KB MessagePack
+#define SNAPSHOT_BUFFER_SIZE 8192                       // Per buffer (JSON + MessagePack), two buffers per snapshot
+#define SNAPSHOT_RETRY_MIN_MS 500                       // First retry after a skipped publish
+#define SNAPSHOT_RETRY_MAX_MS 60000                     // Retry interval doubles up to this while publishing fails
+
+enum SnapshotId {
+    SNAPSHOT_DATA,                                      // /getdata (config + live values, no secrets)
+    SNAPSHOT_SYS,                                       // /getsys (system parameters + statistics)
+    SNAPSHOT_COUNT
+};
+
+void snapshotBegin();                                   // Create the writer lock, pick the boot id for the ETags
+bool snapshotPublish(SnapshotId id, const JsonDocument &doc);  // Serialize + publish, false if busy or too large
+bool snapshotRetryDue(SnapshotId id);                   // False while a failed publish is backing off
+void snapshotSend(AsyncWebServerRequest *request, SnapshotId id);  // Send the published version or 304 (?fmt=, ?fields=)
+void snapshotSendDocument(AsyncWebServerRequest *request, const JsonDocument &doc);  // Send a private document (?fmt=, ?fields=)
+void snapshotStats(JsonDocument &sys);                  // Add publish/skip/304 counters
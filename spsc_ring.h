@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ======================================================================
+// Single-producer/single-consumer ring
+// ======================================================================
+// Lock-free FIFO between exactly one producer task and one consumer
+// task. Each side only writes its own index (release) and reads the
+// other one (acquire): no mutex, no critical section, so the producer
+// is never blocked by the consumer, whatever core it runs on. A full
+// ring rejects the push and counts it, the producer never waits.
+
+template <typename T, uint32_t N>
+struct SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+    T items[N];
+    std::atomic<uint32_t> head{0};                      // Items pushed (written by the producer only)
+    std::atomic<uint32_t> tail{0};                      // Items popped (written by the consumer only)
+    std::atomic<uint32_t> dropped{0};                   // Pushes rejected because the ring was full
+    std::atomic<uint32_t> highWater{0};                 // Most items waiting at once
+
+    // append an item (producer), false if full
+    bool push(const T &item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t waiting = h - tail.load(std::memory_order_acquire);
+        if (waiting >= N) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);   // Publishes the item
+        if (waiting + 1 > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(waiting + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // take the oldest item (consumer), false if empty
+    bool pop(T &item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);   // Frees the slot
+        return true;
+    }
+
+    // items waiting (either side, a snapshot)
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,922 @@
+// ======================================================================
+// Unit tests of the portable logic
+// ======================================================================
+// Run on the host against the simulated HAL of native/:
+//
+//   pio test -e native
+
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../../alarm.h"
+#include "../../config_schema.h"
+#include "../../hal.h"
+#include "../../history.h"
+#include "../../outbox.h"
+#include "../../probes.h"
+#include "../../response_format.h"
+#include "../../rules.h"
+#include "../../sampling.h"
+#include "../../sensor.h"
+#include "../../spsc_ring.h"
+#include "../../trend.h"
+#include "../../native/format_bench.h"
+#include "../../native/sim.h"
+
+void setUp() {
+    configDefaults(config);
+}
+
+void tearDown() {}
+
+// ======================================================================
+// Alarm hysteresis
+// ======================================================================
+
+static void test_alarm_raises_above_target() {
+    bool alarm = false;
+    TEST_ASSERT_EQUAL(ALARM_NONE, alarmEvaluate(alarm, 7.0f, 7, 2));       // At the target: no alarm yet
+    TEST_ASSERT_EQUAL(ALARM_RAISED, alarmEvaluate(alarm, 7.1f, 7, 2));
+    TEST_ASSERT_TRUE(alarm);
+    TEST_ASSERT_EQUAL(ALARM_NONE, alarmEvaluate(alarm, 8.0f, 7, 2));       // Raised once
+}
+
+static void test_alarm_clears_below_hysteresis() {
+    bool alarm = true;
+    TEST_ASSERT_EQUAL(ALARM_NONE, alarmEvaluate(alarm, 6.0f, 7, 2));       // Inside the hysteresis band
+    TEST_ASSERT_EQUAL(ALARM_NONE, alarmEvaluate(alarm, 5.0f, 7, 2));
+    TEST_ASSERT_TRUE(alarm);
+    TEST_ASSERT_EQUAL(ALARM_CLEARED, alarmEvaluate(alarm, 4.9f, 7, 2));
+    TEST_ASSERT_FALSE(alarm);
+}
+
+static void test_pre_alarm_lead_and_hysteresis() {
+    bool preAlarm = false;
+    TEST_ASSERT_EQUAL(ALARM_NONE, preAlarmEvaluate(preAlarm, 45, 30, 15));
+    TEST_ASSERT_EQUAL(ALARM_RAISED, preAlarmEvaluate(preAlarm, 30, 30, 15));
+    TEST_ASSERT_EQUAL(ALARM_NONE, preAlarmEvaluate(preAlarm, 45, 30, 15));  // Within lead + hysteresis
+    TEST_ASSERT_EQUAL(ALARM_CLEARED, preAlarmEvaluate(preAlarm, 46, 30, 15));
+    TEST_ASSERT_EQUAL(ALARM_RAISED, preAlarmEvaluate(preAlarm, 10, 30, 15));
+    TEST_ASSERT_EQUAL(ALARM_CLEARED, preAlarmEvaluate(preAlarm, TREND_NO_ETA, 30, 15));   // Not rising any more
+    TEST_ASSERT_EQUAL(ALARM_NONE, preAlarmEvaluate(preAlarm, 10, 0, 15));  // PRE_ALARM=0 disables it
+}
+
+static void test_reminder_once_per_period() {
+    AlarmReminder reminder = {false, 0};
+    TEST_ASSERT_EQUAL(ALARM_RAISED, alarmReminderUpdate(reminder, true, 1000, 60000));
+    TEST_ASSERT_FALSE(alarmReminderDue(reminder, 60999, 60000));
+    TEST_ASSERT_TRUE(alarmReminderDue(reminder, 61000, 60000));
+    TEST_ASSERT_FALSE(alarmReminderDue(reminder, 61000, 60000));
+    TEST_ASSERT_TRUE(alarmReminderDue(reminder, 500000, 60000));           // Late: one reminder, no burst
+    TEST_ASSERT_FALSE(alarmReminderDue(reminder, 500001, 60000));
+    TEST_ASSERT_EQUAL(ALARM_CLEARED, alarmReminderUpdate(reminder, false, 500002, 60000));
+    TEST_ASSERT_FALSE(alarmReminderDue(reminder, 1000000, 60000));
+}
+
+// ======================================================================
+// /getdata parameter coercion
+// ======================================================================
+
+static void test_config_int_is_clamped_and_rounded() {
+    TEST_ASSERT_TRUE(configApplyParam("TARGET_TEMP", "30"));
+    TEST_ASSERT_EQUAL_INT32(25, config.targetTemp);
+    TEST_ASSERT_TRUE(configApplyParam("TARGET_TEMP", "-3"));
+    TEST_ASSERT_EQUAL_INT32(0, config.targetTemp);
+    TEST_ASSERT_TRUE(configApplyParam("TARGET_TEMP", "6.6"));
+    TEST_ASSERT_EQUAL_INT32(7, config.targetTemp);
+    TEST_ASSERT_FALSE(configApplyParam("TARGET_TEMP", "7"));               // Unchanged
+}
+
+static void test_config_float_is_clamped() {
+    TEST_ASSERT_TRUE(configApplyParam("MIN_TEMP", "-200"));
+    TEST_ASSERT_EQUAL_FLOAT(-100.0f, config.minTemp);
+    TEST_ASSERT_TRUE(configApplyParam("MIN_TEMP", "3.5"));
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, config.minTemp);
+}
+
+static void test_config_rejects_invalid_values() {
+    TEST_ASSERT_FALSE(configApplyParam("TARGET_TEMP", "warm"));            // Not a number
+    TEST_ASSERT_EQUAL_INT32(7, config.targetTemp);
+    TEST_ASSERT_FALSE(configApplyParam("FRIDGE_TEMP", "3"));               // Read-only
+    TEST_ASSERT_FALSE(configApplyParam("NO_SUCH_KEY", "1"));
+}
+
+static void test_config_bool_and_string() {
+    TEST_ASSERT_TRUE(configApplyParam("NOTIFICATION", "true"));
+    TEST_ASSERT_TRUE(config.notification);
+    TEST_ASSERT_TRUE(configApplyParam("NOTIFICATION", "1"));               // Only "true" is true
+    TEST_ASSERT_FALSE(config.notification);
+
+    char longName[64];
+    memset(longName, 'a', sizeof(longName) - 1);
+    longName[sizeof(longName) - 1] = '\0';
+    TEST_ASSERT_TRUE(configApplyParam("HOSTNAME", longName));
+    TEST_ASSERT_EQUAL(sizeof(config.hostname) - 1, strlen(config.hostname));   // Truncated, terminated
+}
+
+// ======================================================================
+// Sensor conversion state machine (simulated DS18B20)
+// ======================================================================
+
+static void sensorSetUp() {
+    simSetSensorCount(1);
+    simSetSensorConnected(true);
+    simSetSensorStalled(false);
+    simSetTemperature(4.1f);
+    sensorBegin(12);
+}
+
+static void test_sensor_converts_without_blocking() {
+    sensorSetUp();
+    float temp = 0;
+    uint32_t waitMs = sensorStart();
+    TEST_ASSERT_EQUAL_UINT32(750, waitMs);
+    TEST_ASSERT_EQUAL(SENSOR_CONVERTING, sensorPoll(temp));
+    TEST_ASSERT_EQUAL_UINT32(750, sensorStart());                           // Running conversion is not restarted
+    simAdvance(waitMs);
+    TEST_ASSERT_EQUAL(SENSOR_READY, sensorPoll(temp));
+    TEST_ASSERT_EQUAL_FLOAT(4.0625f, temp);                                 // 12 bit steps of 1/16 °C
+    TEST_ASSERT_EQUAL(SENSOR_READY, sensorPoll(temp));                      // Result stays until the next start
+}
+
+static void test_sensor_times_out() {
+    sensorSetUp();
+    float temp = 0;
+    simSetSensorStalled(true);
+    sensorStart();
+    simAdvance(750 * SENSOR_TIMEOUT_FACTOR - 1);
+    TEST_ASSERT_EQUAL(SENSOR_CONVERTING, sensorPoll(temp));
+    simAdvance(1);
+    TEST_ASSERT_EQUAL(SENSOR_TIMEOUT, sensorPoll(temp));
+
+    simSetSensorStalled(false);                                             // Next start recovers
+    simAdvance(sensorStart());
+    TEST_ASSERT_EQUAL(SENSOR_READY, sensorPoll(temp));
+}
+
+static void test_sensor_reports_disconnected_probe() {
+    sensorSetUp();
+    float temp = 0;
+    simSetSensorConnected(false);
+    simAdvance(sensorStart());
+    TEST_ASSERT_EQUAL(SENSOR_ERROR, sensorPoll(temp));
+    TEST_ASSERT_FALSE(sensorValue(0, temp));
+    simSetSensorConnected(true);
+    simAdvance(sensorStart());
+    TEST_ASSERT_EQUAL(SENSOR_READY, sensorPoll(temp));
+}
+
+static void test_sensor_resolution_sets_conversion_time() {
+    sensorSetUp();
+    float temp = 0;
+    sensorSetResolution(9);
+    uint32_t waitMs = sensorStart();
+    TEST_ASSERT_EQUAL_UINT32(93, waitMs);
+    simAdvance(waitMs);
+    TEST_ASSERT_EQUAL(SENSOR_READY, sensorPoll(temp));
+    TEST_ASSERT_EQUAL_FLOAT(4.0f, temp);                                    // 9 bit steps of 1/2 °C
+    sensorSetResolution(12);
+}
+
+// ======================================================================
+// Trend estimation
+// ======================================================================
+
+static Trend trend;                                     // Shared by the trend tests, reset by each
+
+static void test_trend_needs_enough_samples() {
+    trendReset(trend);
+    float slope;
+    for (uint32_t i = 0; i < TREND_MIN_SAMPLES - 1; i++) {
+        trendAdd(trend, i * 10000, 4.0f);
+    }
+    TEST_ASSERT_FALSE(trendSlope(trend, slope));
+    TEST_ASSERT_EQUAL_FLOAT(TREND_NO_ETA, trendMinutesTo(trend, 7.0f));
+}
+
+static void test_trend_slope_and_projection() {
+    trendReset(trend);
+    for (uint32_t i = 0; i < 60; i++) {                 // +0.1 °C/min, one sample per minute
+        trendAdd(trend, i * 60000, 4.0f + 0.1f * i);
+    }
+    float slope;
+    TEST_ASSERT_TRUE(trendSlope(trend, slope));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.1f, slope);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 9.5f, trendSmoothed(trend));           // EWMA lags the last sample (9.9 °C)
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 25.0f, trendMinutesTo(trend, 12.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0, trendMinutesTo(trend, 5.0f));               // Already above
+}
+
+static void test_trend_falling_has_no_eta() {
+    trendReset(trend);
+    for (uint32_t i = 0; i < 30; i++) {
+        trendAdd(trend, i * 60000, 8.0f - 0.1f * i);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(TREND_NO_ETA, trendMinutesTo(trend, 10.0f));
+}
+
+// window sums recomputed from the samples in the window
+static bool trendSumsExact(const Trend &t) {
+    int64_t sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (uint8_t i = 0; i < t.count; i++) {
+        uint8_t slot = (t.head + TREND_WINDOW - t.count + i) % TREND_WINDOW;
+        sumX += t.x[slot];
+        sumY += t.y[slot];
+        sumXX += (int64_t)t.x[slot] * t.x[slot];
+        sumXY += (int64_t)t.x[slot] * t.y[slot];
+    }
+    return sumX == t.sumX && sumY == t.sumY && sumXX == t.sumXX && sumXY == t.sumXY;
+}
+
+static void test_trend_window_and_rebase_stay_exact() {
+    trendReset(trend);
+    for (uint32_t i = 0; i < 40 * TREND_WINDOW; i++) {  // Many rebases and dropped samples
+        trendAdd(trend, i * 10000, 4.0f + 0.05f * (i % 100));
+    }
+    TEST_ASSERT_EQUAL(TREND_WINDOW, trend.count);
+    TEST_ASSERT_TRUE(trendSumsExact(trend));
+    TEST_ASSERT_LESS_THAN(TREND_REBASE_S, trend.x[(trend.head + TREND_WINDOW - 1) % TREND_WINDOW]);
+}
+
+static void test_trend_window_is_bounded_in_time() {
+    trendReset(trend);
+    uint32_t baseMs = trend.baseMs;
+    uint8_t rebases = 0;
+    for (uint32_t i = 0; i < 600; i++) {                // 10 h at 60 s
+        trendAdd(trend, i * 60000, 4.0f + 0.01f * i);
+        rebases += trend.baseMs != baseMs;
+        baseMs = trend.baseMs;
+    }
+    TEST_ASSERT_EQUAL(TREND_SPAN_S / 60 + 1, trend.count);                 // 20 min, not TREND_WINDOW samples
+    TEST_ASSERT_TRUE(trendSumsExact(trend));
+    TEST_ASSERT_LESS_THAN(600 / 30, rebases);                               // About every 40 min, not every sample
+    float slope;
+    TEST_ASSERT_TRUE(trendSlope(trend, slope));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.01f, slope);
+}
+
+// ======================================================================
+// Compiled alarm rules
+// ======================================================================
+
+static RuleDef ruleDef(RuleWhen when, float temp) {
+    RuleDef def;
+    memset(&def, 0, sizeof(def));
+    strcpy(def.name, "Test");
+    def.when = when;
+    def.severity = RULE_WARNING;
+    def.temp = (int16_t)lroundf(temp * 10);
+    def.hysteresis = 10;
+    def.samples = 1;
+    return def;
+}
+
+// evaluate one sample of a single sensor, returns the number of events
+static uint8_t evaluate(RuleTable &table, int16_t temp, bool online, uint32_t nowMs, RuleEvent *events) {
+    RuleInput input = {temp, online};
+    return rulesEvaluateTable(table, &input, 1, nowMs, events, RULES_EVENTS_MAX);
+}
+
+static void test_rules_compile_per_sensor() {
+    static RuleTable table;
+    RuleDef defs[2] = {ruleDef(RULE_ABOVE, 8), ruleDef(RULE_OFFLINE, 0)};
+    defs[1].sensor = 2;
+    rulesCompile(defs, 2, 3, table);
+    TEST_ASSERT_EQUAL_UINT8(4, table.size);             // 3 sensors + sensor 2 only
+    TEST_ASSERT_EQUAL_UINT8(1, table.entries[3].rule);
+    TEST_ASSERT_EQUAL_UINT8(1, table.entries[3].probe);
+    TEST_ASSERT_EQUAL_INT16(80, table.entries[0].raise);
+    TEST_ASSERT_EQUAL_INT16(70, table.entries[0].clear);
+}
+
+static void test_rules_above_with_hysteresis() {
+    static RuleTable table;
+    RuleDef def = ruleDef(RULE_ABOVE, 8);
+    rulesCompile(&def, 1, 1, table);
+    table.generation = 3;
+    RuleEvent events[RULES_EVENTS_MAX];
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 80, true, 0, events));      // At the limit
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 81, true, 10000, events));
+    TEST_ASSERT_EQUAL(RULE_RAISED, events[0].type);
+    TEST_ASSERT_EQUAL_INT16(81, events[0].temp);
+    TEST_ASSERT_EQUAL(3, events[0].generation);         // Checked by rulesGet() when the event is handled
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 70, true, 20000, events));  // Inside the hysteresis band
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 0, false, 30000, events));  // Failed reading keeps the state
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 69, true, 40000, events));
+    TEST_ASSERT_EQUAL(RULE_CLEARED, events[0].type);
+}
+
+static void test_rules_below_needs_consecutive_samples() {
+    static RuleTable table;
+    RuleDef def = ruleDef(RULE_BELOW, 2);
+    def.samples = 3;
+    rulesCompile(&def, 1, 1, table);
+    RuleEvent events[RULES_EVENTS_MAX];
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 10, true, 0, events));
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 10, true, 10000, events));
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 30, true, 20000, events));  // Streak broken
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 10, true, 30000, events));
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 10, true, 40000, events));
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 10, true, 50000, events));
+    TEST_ASSERT_EQUAL(RULE_RAISED, events[0].type);
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 29, true, 60000, events));  // Clears above 2 + 1 °C
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 31, true, 70000, events));
+    TEST_ASSERT_EQUAL(RULE_CLEARED, events[0].type);
+}
+
+static void test_rules_duration_and_reminder() {
+    static RuleTable table;
+    RuleDef def = ruleDef(RULE_ABOVE, 10);
+    def.forS = 300;
+    def.reminder = 30;
+    rulesCompile(&def, 1, 1, table);
+    RuleEvent events[RULES_EVENTS_MAX];
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 120, true, 0, events));
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 120, true, 299000, events));   // Defrost excursion
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 120, true, 300000, events));
+    TEST_ASSERT_EQUAL(RULE_RAISED, events[0].type);
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 120, true, 300000 + 1799000, events));
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 120, true, 300000 + 1800000, events));
+    TEST_ASSERT_EQUAL(RULE_REMINDER, events[0].type);
+}
+
+static void test_rules_offline() {
+    static RuleTable table;
+    RuleDef def = ruleDef(RULE_OFFLINE, 0);
+    def.samples = 2;
+    rulesCompile(&def, 1, 1, table);
+    RuleEvent events[RULES_EVENTS_MAX];
+    TEST_ASSERT_EQUAL_UINT8(0, evaluate(table, 0, false, 0, events));
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 0, false, 10000, events));
+    TEST_ASSERT_EQUAL(RULE_RAISED, events[0].type);
+    TEST_ASSERT_EQUAL_UINT8(1, evaluate(table, 40, true, 20000, events));
+    TEST_ASSERT_EQUAL(RULE_CLEARED, events[0].type);
+}
+
+static void test_rules_count_dropped_events() {
+    static RuleTable table;
+    RuleDef defs[4] = {ruleDef(RULE_ABOVE, 1), ruleDef(RULE_ABOVE, 2), ruleDef(RULE_ABOVE, 3), ruleDef(RULE_ABOVE, 4)};
+    rulesCompile(defs, 4, 1, table);
+    RuleInput input = {100, true};
+    RuleEvent events[2];
+    TEST_ASSERT_EQUAL_UINT8(2, rulesEvaluateTable(table, &input, 1, 0, events, 2));
+    TEST_ASSERT_EQUAL_UINT32(2, table.dropped);
+}
+
+static void test_rules_replace_keeps_unchanged_state() {
+    static RuleTable before, after;
+    RuleDef defs[2] = {ruleDef(RULE_ABOVE, 8), ruleDef(RULE_BELOW, 2)};
+    rulesCompile(defs, 2, 2, before);
+    RuleInput inputs[2] = {{90, true}, {50, true}};
+    RuleEvent events[RULES_EVENTS_MAX];
+    TEST_ASSERT_EQUAL_UINT8(1, rulesEvaluateTable(before, inputs, 2, 0, events, RULES_EVENTS_MAX));
+
+    RuleDef reordered[2] = {defs[1], defs[0]};          // Same rules, other order
+    int8_t map[RULES_MAX];
+    rulesMatch(defs, 2, reordered, 2, map);
+    TEST_ASSERT_EQUAL(1, map[0]);
+    TEST_ASSERT_EQUAL(0, map[1]);
+    rulesCompile(reordered, 2, 2, after);
+    RuleEvent cleared[RULES_ENTRIES_MAX];
+    TEST_ASSERT_EQUAL_UINT8(0, rulesCarryState(before, after, map, cleared));
+    TEST_ASSERT_TRUE(after.state[2].active);            // Rule 2 on sensor 1
+    TEST_ASSERT_EQUAL_UINT8(0, rulesEvaluateTable(after, inputs, 2, 10000, events, RULES_EVENTS_MAX));  // Not raised again
+}
+
+static void test_rules_replace_clears_removed_entries() {
+    static RuleTable before, after;
+    RuleDef def = ruleDef(RULE_ABOVE, 8);
+    rulesCompile(&def, 1, 2, before);
+    before.generation = 4;
+    RuleInput inputs[2] = {{50, true}, {90, true}};
+    RuleEvent events[RULES_EVENTS_MAX];
+    TEST_ASSERT_EQUAL_UINT8(1, rulesEvaluateTable(before, inputs, 2, 0, events, RULES_EVENTS_MAX));
+
+    RuleDef changed = ruleDef(RULE_ABOVE, 9);
+    int8_t map[RULES_MAX];
+    rulesMatch(&def, 1, &changed, 1, map);
+    TEST_ASSERT_EQUAL(-1, map[0]);
+    rulesCompile(&changed, 1, 2, after);
+    RuleEvent cleared[RULES_ENTRIES_MAX];
+    TEST_ASSERT_EQUAL_UINT8(1, rulesCarryState(before, after, map, cleared));
+    TEST_ASSERT_EQUAL(RULE_CLEARED, cleared[0].type);
+    TEST_ASSERT_EQUAL_UINT8(0, cleared[0].rule);
+    TEST_ASSERT_EQUAL_UINT8(1, cleared[0].probe);
+    TEST_ASSERT_EQUAL(4, cleared[0].generation);        // Refers to the old definitions
+    TEST_ASSERT_FALSE(after.state[1].active);
+}
+
+static void test_rules_format_template() {
+    RuleDef def = ruleDef(RULE_ABOVE, 8);
+    strcpy(def.text, "{sensor}: {temp}°C über {limit}°C ({rule}, {severity}) {unknown}");
+    RuleEvent event = {RULE_RAISED, 0, 0, 93};
+    char text[RULE_TEXT_LEN + 32];
+    rulesFormat(def, event, "Theke", text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("Theke: 9.3°C über 8.0°C (Test, Warnung) {unknown}", text);
+    char shortText[8];
+    TEST_ASSERT_EQUAL(7, rulesFormat(def, event, "Theke", shortText, sizeof(shortText)));   // Truncated, terminated
+}
+
+// ======================================================================
+// Single-producer/single-consumer ring
+// ======================================================================
+
+static void test_ring_fifo_and_full() {
+    static SpscRing<int, 4> ring;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_FALSE(ring.push(4));                    // Full: rejected and counted
+    TEST_ASSERT_EQUAL_UINT32(1, ring.dropped.load());
+    TEST_ASSERT_EQUAL_UINT32(4, ring.highWater.load());
+    TEST_ASSERT_EQUAL_UINT32(4, ring.size());
+    int item;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.pop(item));
+        TEST_ASSERT_EQUAL_INT(i, item);
+    }
+    TEST_ASSERT_FALSE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+}
+
+static void test_ring_index_wraps() {
+    static SpscRing<int, 4> ring;
+    ring.head = UINT32_MAX - 1;                         // Indices wrap after 2^32 items
+    ring.tail = UINT32_MAX - 1;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_FALSE(ring.push(4));
+    TEST_ASSERT_EQUAL_UINT32(4, ring.size());
+    int item;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.pop(item));
+        TEST_ASSERT_EQUAL_INT(i, item);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, ring.tail.load());
+}
+
+// ======================================================================
+// Per-sensor table
+// ======================================================================
+
+// two simulated sensors, one conversion taken over
+static void probesSetUp() {
+    simSetSensorCount(2);
+    simSetSensorConnected(true);
+    simSetSensorStalled(false);
+    simSetSensorTemperature(0, 4.0f);
+    simSetSensorTemperature(1, 5.0f);
+    sensorBegin(12);
+    probesBegin();
+    float temp;
+    simAdvance(sensorStart());
+    sensorPoll(temp);
+    probesUpdate();
+}
+
+static void test_probes_checksum_ignores_readings() {
+    probesSetUp();
+    uint32_t table = probesChecksum();
+    uint32_t readings = probesReadingsChecksum();
+    simSetSensorTemperature(1, 6.0f);
+    float temp;
+    simAdvance(sensorStart());
+    sensorPoll(temp);
+    probesUpdate();
+    TEST_ASSERT_EQUAL_UINT32(table, probesChecksum());                      // No table refetch per sample
+    TEST_ASSERT_NOT_EQUAL(readings, probesReadingsChecksum());
+
+    JsonDocument live;
+    probesReadingsToJson(live);
+    TEST_ASSERT_EQUAL_INT(60, live["SENSOR_TEMPS"][1][0].as<int>());        // 1/10 °C
+    TEST_ASSERT_EQUAL_INT(50, live["SENSOR_TEMPS"][1][1].as<int>());
+
+    TEST_ASSERT_TRUE(probesApplyParam("SENSOR_2_NAME", "Theke"));
+    TEST_ASSERT_NOT_EQUAL(table, probesChecksum());
+}
+
+static void test_probes_failed_save_is_retried() {
+    probesSetUp();
+    simPutFile(PROBES_FILE, "{}");
+    TEST_ASSERT_TRUE(probesApplyParam("SENSOR_1_NAME", "Kühlung"));
+    simSetFileFull(true);
+    probesCommitNow();
+    TEST_ASSERT_EQUAL_STRING("{}", simGetFile(PROBES_FILE).c_str());
+    simSetFileFull(false);
+    probesLoop();                                                           // Quiet time again after the failure
+    TEST_ASSERT_EQUAL_STRING("{}", simGetFile(PROBES_FILE).c_str());
+    simAdvance(PROBES_COMMIT_QUIET_MS);
+    probesLoop();
+    TEST_ASSERT_NOT_NULL(strstr(simGetFile(PROBES_FILE).c_str(), "Kühlung"));
+}
+
+// ======================================================================
+// Adaptive sampling
+// ======================================================================
+
+static void test_sampling_period_from_margin_and_rise() {
+    TEST_ASSERT_EQUAL_UINT32(10000, samplingPeriodMs(0, 0.5f, 10000, 60000));          // At the threshold
+    TEST_ASSERT_EQUAL_UINT32(10000, samplingPeriodMs(NAN, 0, 10000, 60000));           // No reading
+    TEST_ASSERT_EQUAL_UINT32(60000, samplingPeriodMs(5, 0, 10000, 60000));             // Far and flat
+    TEST_ASSERT_EQUAL_UINT32(30000, samplingPeriodMs(0.2f, 0, 10000, 60000));          // Flat counts as SAMPLING_ASSUMED_RISE
+    TEST_ASSERT_EQUAL_UINT32(20000, samplingPeriodMs(0.5f, 0.75f, 10000, 60000));      // Half the time to the threshold
+    TEST_ASSERT_EQUAL_UINT32(10000, samplingPeriodMs(0.1f, 1.0f, 10000, 60000));
+    TEST_ASSERT_EQUAL_UINT32(10000, samplingPeriodMs(5, 0, 10000, 5000));              // SAMPLE_MAX below SAMPLE_MIN
+}
+
+static void test_sampling_follows_the_fastest_sensor() {
+    probesSetUp();                                                          // 4.0 °C and 5.0 °C, TARGET_TEMP 7 °C
+    TEST_ASSERT_EQUAL_UINT32(60000, samplingProbesPeriodMs(0, 10000, 60000));
+    simSetSensorTemperature(1, 6.5f);                                       // Second sensor +0.75 °C/min
+    float temp;
+    sensorStart();
+    simAdvance(PROBES_RISE_SPAN_MS);                                        // Conversion completes meanwhile
+    sensorPoll(temp);
+    probesUpdate();
+    Probe probe;
+    probesGet(1, probe);
+    TEST_ASSERT_EQUAL_INT16(75, probe.rise);
+    TEST_ASSERT_EQUAL_UINT32(20000, samplingProbesPeriodMs(0, 10000, 60000));  // Not the first sensor's flat slope
+
+    simSetSensorConnected(false);                                           // Offline: SAMPLE_MIN
+    simAdvance(sensorStart());
+    sensorPoll(temp);
+    probesUpdate();
+    TEST_ASSERT_EQUAL_UINT32(10000, samplingProbesPeriodMs(0, 10000, 60000));
+}
+
+// ======================================================================
+// Temperature history (segments on the in-memory filesystem)
+// ======================================================================
+
+// one packed HistorySample as stored in a segment file
+static std::string historyRecord(uint32_t ts, int16_t temp) {
+    HistorySample sample = { ts, temp };
+    return std::string((const char *)&sample, sizeof(sample));
+}
+
+// whole export in chunks of maxLen bytes
+static std::string historyExport(HistoryFormat format, uint32_t from, uint32_t to, uint32_t step, size_t maxLen) {
+    HistoryCursor cursor;
+    historyExportBegin(cursor, format, from, to, step);
+    std::string out;
+    std::vector<uint8_t> buffer(maxLen);
+    for (int chunks = 0; chunks < 1000; chunks++) {
+        size_t len = historyExportChunk(cursor, buffer.data(), buffer.size());
+        if (len == 0) {
+            break;
+        }
+        if (len != HISTORY_TRY_AGAIN) {
+            out.append((const char *)buffer.data(), len);
+        }
+    }
+    return out;
+}
+
+static void historySetUp() {
+    simClearFiles();
+    simSetEpoch(0);
+    historyBegin();
+}
+
+static void test_history_exports_flash_and_ram_once() {
+    historySetUp();
+    historyAddAt(1000, 4.0f);
+    historyAddAt(1010, -1.5f);
+    historyFlush();
+    TEST_ASSERT_EQUAL(2 * sizeof(HistorySample), simGetFile(HISTORY_DIR "/00000000.bin").size());
+    historyAddAt(1020, 5.25f);                                              // RAM only
+    historyAddAt(1020, 6.0f);                                               // Same second -> 1021
+
+    const char *expected = "timestamp,temp_c\n1000,4.0\n1010,-1.5\n1020,5.3\n1021,6.0\n";
+    TEST_ASSERT_EQUAL_STRING(expected, historyExport(HISTORY_CSV, 0, UINT32_MAX, 0, 64).c_str());
+    TEST_ASSERT_EQUAL_STRING("timestamp,temp_c\n1010,-1.5\n1020,5.3\n", historyExport(HISTORY_CSV, 1005, 1020, 0, 64).c_str());
+    TEST_ASSERT_EQUAL(4 * sizeof(HistorySample), historyExport(HISTORY_BIN, 0, UINT32_MAX, 0, 64).size());
+}
+
+static void test_history_msgpack_announces_its_length() {
+    historySetUp();
+    historyAddAt(1000, 4.0f);
+    historyAddAt(1010, 5.0f);
+    historyFlush();
+    historyAddAt(1020, 6.0f);
+
+    HistoryCursor cursor;
+    historyExportBegin(cursor, HISTORY_MSGPACK, 0, UINT32_MAX, 20);
+    uint8_t small[4];
+    TEST_ASSERT_EQUAL(HISTORY_TRY_AGAIN, historyExportChunk(cursor, small, sizeof(small)));   // Not even the header, 0 would end the response
+
+    std::string packed = historyExport(HISTORY_MSGPACK, 0, UINT32_MAX, 20, 32);
+    TEST_ASSERT_EQUAL_UINT8(0xdd, (uint8_t)packed[0]);                      // One array 32, buckets 1000 and 1020
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeMsgPack(doc, packed.data(), packed.size()));
+    TEST_ASSERT_EQUAL(2, doc.size());
+    TEST_ASSERT_EQUAL_UINT32(1000, doc[0][0].as<uint32_t>());
+    TEST_ASSERT_EQUAL_INT(45, doc[0][1].as<int>());                         // Mean of 4.0 and 5.0 in 1/10 °C
+    TEST_ASSERT_EQUAL_INT(60, doc[1][1].as<int>());
+}
+
+static void test_history_restart_continues_after_flash() {
+    historySetUp();
+    historyAddAt(1000, 4.0f);
+    historyFlush();
+    historyBegin();                                                         // Reboot without a set clock
+    TEST_ASSERT_EQUAL_UINT32(1000, historyLastTimestamp());
+    historyAdd(4.5f);
+    TEST_ASSERT_EQUAL_UINT32(1001 + halMillis() / 1000, historyLastTimestamp());    // Continues after the stored sample
+
+    simSetEpoch(1700000000);
+    historyAdd(5.0f);
+    TEST_ASSERT_EQUAL_UINT32(1700000000, historyLastTimestamp());
+}
+
+static void test_history_rotates_torn_and_old_segments() {
+    simClearFiles();
+    simSetEpoch(0);
+    char path[32];
+    for (uint32_t segment = 0; segment < HISTORY_SEGMENTS; segment++) {
+        snprintf(path, sizeof(path), HISTORY_DIR "/%08lu.bin", (unsigned long)segment);
+        simPutFile(path, historyRecord(100 * segment, 40));
+    }
+    simPutFile(path, historyRecord(700, 40) + "\x01\x02");                 // Newest segment torn by a power cut
+    historyBegin();
+    for (int i = 0; i < HISTORY_FLUSH_SAMPLES; i++) {
+        historyAddAt(1000 + 10 * i, 4.0f);
+    }
+    TEST_ASSERT_TRUE(historyNeedsFlush());
+    historyFlush();
+    TEST_ASSERT_FALSE(historyNeedsFlush());
+
+    snprintf(path, sizeof(path), HISTORY_DIR "/%08lu.bin", (unsigned long)HISTORY_SEGMENTS);
+    TEST_ASSERT_EQUAL(HISTORY_FLUSH_SAMPLES * sizeof(HistorySample), simGetFile(path).size());   // Appended to a new segment
+    TEST_ASSERT_TRUE(simGetFile(HISTORY_DIR "/00000000.bin").empty());     // Oldest one dropped
+    TEST_ASSERT_EQUAL(sizeof(HistorySample) + 2, simGetFile(HISTORY_DIR "/00000007.bin").size());
+}
+
+static void test_history_failed_flush_keeps_samples() {
+    historySetUp();
+    for (int i = 0; i < HISTORY_FLUSH_SAMPLES; i++) {
+        historyAddAt(1000 + 10 * i, 4.0f);
+    }
+    simSetFileFull(true);
+    historyFlush();
+    simSetFileFull(false);
+    TEST_ASSERT_TRUE(historyNeedsFlush());                                  // Written again with the next flush
+    historyFlush();
+    TEST_ASSERT_EQUAL(HISTORY_FLUSH_SAMPLES * sizeof(HistorySample), simGetFile(HISTORY_DIR "/00000000.bin").size());
+}
+
+// ======================================================================
+// Store-and-forward outbox
+// ======================================================================
+
+#define TEST_OUTBOX_DIR "/test_outbox"
+
+static Outbox testOutbox;
+
+static void outboxSetUp() {
+    simClearFiles();
+    simSetEpoch(0);
+    outboxBegin(testOutbox, TEST_OUTBOX_DIR);
+}
+
+// payload of the oldest record as a string, empty if none
+static std::string outboxHead(Outbox &box) {
+    char data[OUTBOX_DATA_MAX];
+    size_t len = outboxPeek(box, data, sizeof(data));
+    return std::string(data, len);
+}
+
+static void test_outbox_fifo_survives_restart() {
+    outboxSetUp();
+    TEST_ASSERT_TRUE(outboxAppend(testOutbox, "first", 5));
+    TEST_ASSERT_TRUE(outboxAppend(testOutbox, "second", 6));
+    TEST_ASSERT_TRUE(outboxAppend(testOutbox, "third", 5));
+    TEST_ASSERT_EQUAL_STRING("first", outboxHead(testOutbox).c_str());
+    TEST_ASSERT_EQUAL_STRING("first", outboxHead(testOutbox).c_str());     // Peek does not remove
+    outboxPop(testOutbox);
+
+    outboxBegin(testOutbox, TEST_OUTBOX_DIR);                               // Reboot: read position from the cursor file
+    TEST_ASSERT_EQUAL_UINT32(2, outboxCount(testOutbox));
+    TEST_ASSERT_EQUAL_STRING("second", outboxHead(testOutbox).c_str());
+    outboxPop(testOutbox);
+    outboxPop(testOutbox);
+    TEST_ASSERT_EQUAL_UINT32(0, outboxCount(testOutbox));
+    TEST_ASSERT_EQUAL_STRING("", outboxHead(testOutbox).c_str());
+    TEST_ASSERT_TRUE(simGetFile(TEST_OUTBOX_DIR "/00000000.bin").empty()); // Delivered segment deleted
+}
+
+static void test_outbox_crc_matches_the_rom_routine() {
+    outboxSetUp();
+    outboxAppend(testOutbox, "123456789", 9);
+    std::string record = simGetFile(TEST_OUTBOX_DIR "/00000000.bin");
+    TEST_ASSERT_EQUAL(OUTBOX_RECORD_SIZE, record.size());
+    uint32_t crc;
+    memcpy(&crc, record.data() + 8, sizeof(crc));
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc);                               // CRC-32 check value: records written before stay valid
+}
+
+static void test_outbox_skips_corrupt_and_torn_records() {
+    outboxSetUp();
+    outboxAppend(testOutbox, "first", 5);
+    outboxAppend(testOutbox, "second", 6);
+    std::string segment = simGetFile(TEST_OUTBOX_DIR "/00000000.bin");
+    segment[12] ^= 0xff;                                                    // First payload byte flipped
+    simPutFile(TEST_OUTBOX_DIR "/00000000.bin", segment + "torn");          // Append cut off by a power loss
+
+    outboxBegin(testOutbox, TEST_OUTBOX_DIR);
+    TEST_ASSERT_EQUAL_UINT32(1, outboxCount(testOutbox));
+    TEST_ASSERT_EQUAL_STRING("second", outboxHead(testOutbox).c_str());
+    TEST_ASSERT_TRUE(outboxAppend(testOutbox, "third", 5));                 // Continues in a new segment
+    TEST_ASSERT_EQUAL(OUTBOX_RECORD_SIZE, simGetFile(TEST_OUTBOX_DIR "/00000001.bin").size());
+
+    JsonDocument sys;
+    outboxStats(testOutbox, sys, "test");
+    TEST_ASSERT_EQUAL_UINT32(2, sys["test_depth"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_UINT32(1, sys["test_dropped"].as<uint32_t>());
+}
+
+static void test_outbox_drops_oldest_segment_when_full() {
+    outboxSetUp();
+    uint32_t capacity = OUTBOX_SEGMENTS * OUTBOX_SEGMENT_RECORDS;
+    for (uint32_t i = 0; i <= capacity; i++) {
+        TEST_ASSERT_TRUE(outboxAppend(testOutbox, &i, sizeof(i)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(capacity + 1 - OUTBOX_SEGMENT_RECORDS, outboxCount(testOutbox));
+    uint32_t head = 0;
+    TEST_ASSERT_EQUAL(sizeof(head), outboxPeek(testOutbox, &head, sizeof(head)));
+    TEST_ASSERT_EQUAL_UINT32(OUTBOX_SEGMENT_RECORDS, head);                 // Oldest segment is gone
+
+    simSetFileFull(true);
+    TEST_ASSERT_FALSE(outboxAppend(testOutbox, &head, sizeof(head)));
+    simSetFileFull(false);
+    char big[OUTBOX_DATA_MAX + 1] = {};
+    TEST_ASSERT_FALSE(outboxAppend(testOutbox, big, sizeof(big)));
+}
+
+static void test_outbox_oldest_age() {
+    outboxSetUp();
+    outboxAppend(testOutbox, "offline", 7);                                 // Clock not set: age since it became the oldest
+    simAdvance(30000);
+    JsonDocument sys;
+    outboxStats(testOutbox, sys, "test");
+    TEST_ASSERT_EQUAL_UINT32(30, sys["test_oldest_age_s"].as<uint32_t>());
+
+    outboxPop(testOutbox);
+    simSetEpoch(1700000000);
+    outboxAppend(testOutbox, "online", 6);
+    outboxBegin(testOutbox, TEST_OUTBOX_DIR);                               // Creation time survives a reboot
+    simAdvance(90000);
+    outboxStats(testOutbox, sys, "test");
+    TEST_ASSERT_EQUAL_UINT32(90, sys["test_oldest_age_s"].as<uint32_t>());
+}
+
+// ======================================================================
+// Response formats (/getdata as JSON and MessagePack)
+// ======================================================================
+
+// /getdata document like buildData(), with n simulated sensors
+static void buildData(JsonDocument &doc, uint8_t sensors) {
+    simSetSensorCount(sensors);
+    simSetSensorConnected(true);
+    simSetSensorStalled(false);
+    for (uint8_t i = 0; i < sensors; i++) {
+        simSetSensorTemperature(i, 3.5f + 0.5f * i);
+    }
+    sensorBegin(12);
+    probesBegin();
+    float temp;
+    simAdvance(sensorStart());
+    TEST_ASSERT_EQUAL(SENSOR_READY, sensorPoll(temp));
+    probesUpdate();
+    config.fridgeTemp = temp;
+    configToJson(config, doc, 0, CFG_SECRET);
+    probesToJson(doc);
+}
+
+static void test_format_negotiation() {
+    TEST_ASSERT_EQUAL(FORMAT_JSON, responseFormat(nullptr, nullptr));
+    TEST_ASSERT_EQUAL(FORMAT_MSGPACK, responseFormat(nullptr, "text/html, application/msgpack;q=0.9"));
+    TEST_ASSERT_EQUAL(FORMAT_JSON, responseFormat("json", "application/msgpack"));       // ?fmt= wins
+    TEST_ASSERT_EQUAL(FORMAT_MSGPACK, responseFormat("msgpack", nullptr));
+    TEST_ASSERT_EQUAL(FORMAT_JSON, responseFormat("", nullptr));
+    TEST_ASSERT_EQUAL_STRING(FORMAT_MSGPACK_TYPE, responseContentType(FORMAT_MSGPACK));
+}
+
+static void test_format_filter_keys() {
+    JsonDocument filter;
+    TEST_ASSERT_FALSE(responseFilter(nullptr, filter));
+    TEST_ASSERT_FALSE(responseFilter(",,", filter));
+    TEST_ASSERT_TRUE(responseFilter("FRIDGE_TEMP,,ALARM", filter));
+    TEST_ASSERT_EQUAL(2, filter.size());
+    TEST_ASSERT_TRUE(filter["ALARM"].as<bool>());
+}
+
+static void test_format_msgpack_round_trip() {
+    JsonDocument doc;
+    buildData(doc, 8);
+    TEST_ASSERT_TRUE(doc["WIFI_STA_PW"].isNull());     // Secrets are skipped
+    std::vector<char> json(responseMeasure(doc, FORMAT_JSON) + 1);
+    std::vector<char> packed(responseMeasure(doc, FORMAT_MSGPACK) + 1);
+    size_t jsonLen = responseSerialize(doc, FORMAT_JSON, json.data(), json.size());
+    size_t packedLen = responseSerialize(doc, FORMAT_MSGPACK, packed.data(), packed.size());
+    TEST_ASSERT_GREATER_THAN(0, (int)packedLen);
+    TEST_ASSERT_LESS_THAN((int)jsonLen, (int)packedLen);                   // Smaller than the JSON body
+    TEST_ASSERT_EQUAL(0, responseSerialize(doc, FORMAT_JSON, json.data(), jsonLen));   // No room for the terminator
+
+    JsonDocument decoded;
+    TEST_ASSERT_FALSE(deserializeMsgPack(decoded, packed.data(), packedLen));
+    TEST_ASSERT_EQUAL(doc.size(), decoded.size());
+    TEST_ASSERT_EQUAL_INT32(config.targetTemp, decoded["TARGET_TEMP"].as<int32_t>());
+    TEST_ASSERT_EQUAL_STRING(config.hostname, decoded["HOSTNAME"].as<const char *>());
+    TEST_ASSERT_EQUAL(8, decoded["SENSORS"].size());
+    TEST_ASSERT_EQUAL_FLOAT(7.0f, decoded["SENSORS"][7]["temp"].as<float>());
+}
+
+static void test_format_field_selection() {
+    JsonDocument doc;
+    buildData(doc, 8);
+    std::vector<char> packed(responseMeasure(doc, FORMAT_MSGPACK) + 1);
+    size_t packedLen = responseSerialize(doc, FORMAT_MSGPACK, packed.data(), packed.size());
+    JsonDocument filter;
+    responseFilter("FRIDGE_TEMP,ALARM", filter);
+    JsonDocument part;                                  // Like snapshotSend(): decode the MessagePack copy with the filter
+    TEST_ASSERT_FALSE(deserializeMsgPack(part, packed.data(), packedLen, DeserializationOption::Filter(filter)));
+    TEST_ASSERT_EQUAL(2, part.size());
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, part["FRIDGE_TEMP"].as<float>());
+    TEST_ASSERT_LESS_THAN(40, (int)responseMeasure(part, FORMAT_JSON));    // {"FRIDGE_TEMP":3.5,"ALARM":false}
+}
+
+static void test_format_bench_size_and_time() {
+    JsonDocument doc;
+    buildData(doc, SENSOR_MAX);
+    JsonDocument filter;
+    responseFilter(FORMAT_BENCH_FIELDS, filter);
+    FormatBenchResult json = formatBenchFull(doc, FORMAT_JSON);
+    FormatBenchResult packed = formatBenchFull(doc, FORMAT_MSGPACK);
+    FormatBenchResult part = formatBenchSelection(doc, filter, FORMAT_MSGPACK);
+    TEST_ASSERT_LESS_THAN((int)(json.bytes * 9 / 10), (int)packed.bytes);  // At least 10 % smaller than the JSON body
+    TEST_ASSERT_LESS_THAN((int)(packed.bytes / 10), (int)part.bytes);       // A selection only carries its keys
+    TEST_ASSERT_TRUE(json.serializeUs > 0 && packed.serializeUs > 0 && part.serializeUs > 0);
+
+    char line[160];                                     // Host timings only compare the formats, they say nothing about the ESP32
+    snprintf(line, sizeof(line), "json %zu B %.2f us, msgpack %zu B %.2f us, fields=%s %zu B %.2f us", json.bytes,
+             json.serializeUs, packed.bytes, packed.serializeUs, FORMAT_BENCH_FIELDS, part.bytes, part.serializeUs);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_alarm_raises_above_target);
+    RUN_TEST(test_alarm_clears_below_hysteresis);
+    RUN_TEST(test_pre_alarm_lead_and_hysteresis);
+    RUN_TEST(test_reminder_once_per_period);
+    RUN_TEST(test_config_int_is_clamped_and_rounded);
+    RUN_TEST(test_config_float_is_clamped);
+    RUN_TEST(test_config_rejects_invalid_values);
+    RUN_TEST(test_config_bool_and_string);
+    RUN_TEST(test_sensor_converts_without_blocking);
+    RUN_TEST(test_sensor_times_out);
+    RUN_TEST(test_sensor_reports_disconnected_probe);
+    RUN_TEST(test_sensor_resolution_sets_conversion_time);
+    RUN_TEST(test_trend_needs_enough_samples);
+    RUN_TEST(test_trend_slope_and_projection);
+    RUN_TEST(test_trend_falling_has_no_eta);
+    RUN_TEST(test_trend_window_and_rebase_stay_exact);
+    RUN_TEST(test_trend_window_is_bounded_in_time);
+    RUN_TEST(test_rules_compile_per_sensor);
+    RUN_TEST(test_rules_above_with_hysteresis);
+    RUN_TEST(test_rules_below_needs_consecutive_samples);
+    RUN_TEST(test_rules_duration_and_reminder);
+    RUN_TEST(test_rules_offline);
+    RUN_TEST(test_rules_count_dropped_events);
+    RUN_TEST(test_rules_replace_keeps_unchanged_state);
+    RUN_TEST(test_rules_replace_clears_removed_entries);
+    RUN_TEST(test_rules_format_template);
+    RUN_TEST(test_ring_fifo_and_full);
+    RUN_TEST(test_ring_index_wraps);
+    RUN_TEST(test_probes_checksum_ignores_readings);
+    RUN_TEST(test_probes_failed_save_is_retried);
+    RUN_TEST(test_sampling_period_from_margin_and_rise);
+    RUN_TEST(test_sampling_follows_the_fastest_sensor);
+    RUN_TEST(test_history_exports_flash_and_ram_once);
+    RUN_TEST(test_history_msgpack_announces_its_length);
+    RUN_TEST(test_history_restart_continues_after_flash);
+    RUN_TEST(test_history_rotates_torn_and_old_segments);
+    RUN_TEST(test_history_failed_flush_keeps_samples);
+    RUN_TEST(test_outbox_fifo_survives_restart);
+    RUN_TEST(test_outbox_crc_matches_the_rom_routine);
+    RUN_TEST(test_outbox_skips_corrupt_and_torn_records);
+    RUN_TEST(test_outbox_drops_oldest_segment_when_full);
+    RUN_TEST(test_outbox_oldest_age);
+    RUN_TEST(test_format_negotiation);
+    RUN_TEST(test_format_filter_keys);
+    RUN_TEST(test_format_msgpack_round_trip);
+    RUN_TEST(test_format_field_selection);
+    RUN_TEST(test_format_bench_size_and_time);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#include "trend.h"
+#include <math.h>
+
+// empty window
+void trendReset(Trend &trend) {
+    trend.head = 0;
+    trend.count = 0;
+    trend.baseMs = 0;
+    trend.sumX = trend.sumY = trend.sumXX = trend.sumXY = 0;
+    trend.ewma = NAN;
+}
+
+// slot of the oldest sample in the window
+static uint8_t oldest(const Trend &trend) {
+    return (trend.head + TREND_WINDOW - trend.count) % TREND_WINDOW;
+}
+
+// remove the oldest sample from the window
+static void dropOldest(Trend &trend) {
+    uint8_t slot = oldest(trend);
+    int64_t ox = trend.x[slot];
+    int64_t oy = trend.y[slot];
+    trend.sumX -= ox;
+    trend.sumY -= oy;
+    trend.sumXX -= ox * ox;
+    trend.sumXY -= ox * oy;
+    trend.count--;
+}
+
+// shift the time base, the sums follow exactly: x' = x - d
+static void rebase(Trend &trend, int32_t d) {
+    int64_t n = trend.count;
+    trend.sumXX += -2 * d * trend.sumX + n * d * d;     // Uses the old sumX
+    trend.sumXY -= d * trend.sumY;
+    trend.sumX -= n * d;
+    for (uint8_t i = 0, slot = oldest(trend); i < trend.count; i++, slot = (slot + 1) % TREND_WINDOW) {
+        trend.x[slot] -= d;                             // Samples in the window only
+    }
+    trend.baseMs += (uint32_t)d * 1000;
+}
+
+// add a sample
+void trendAdd(Trend &trend, uint32_t ms, float tempC) {
+    if (trend.count == 0) {
+        trend.baseMs = ms;
+    }
+    int32_t x = (int32_t)((ms - trend.baseMs) / 1000);
+    int16_t y = (int16_t)lroundf(tempC * 100);
+
+    if (trend.count == TREND_WINDOW) {                  // Drop the oldest sample (the one in the slot)
+        dropOldest(trend);
+    }
+    while (trend.count > 0 && x - trend.x[oldest(trend)] > TREND_SPAN_S) {   // Older than the window span
+        dropOldest(trend);
+    }
+    trend.count++;
+    trend.x[trend.head] = x;
+    trend.y[trend.head] = y;
+    trend.sumX += x;
+    trend.sumY += y;
+    trend.sumXX += (int64_t)x * x;
+    trend.sumXY += (int64_t)x * y;
+    trend.head = (trend.head + 1) % TREND_WINDOW;
+
+    trend.ewma = isnan(trend.ewma) ? tempC : trend.ewma + TREND_EWMA_ALPHA * (tempC - trend.ewma);
+
+    if (x >= TREND_REBASE_S) {                          // Keep x small, millis() wraps after 49 days; once per 40 min, the window spans 20
+        rebase(trend, trend.x[oldest(trend)]);
+    }
+}
+
+// slope in °C/min
+bool trendSlope(const Trend &trend, float &perMinute) {
+    if (trend.count < TREND_MIN_SAMPLES) {
+        return false;
+    }
+    uint8_t newest = (trend.head + TREND_WINDOW - 1) % TREND_WINDOW;
+    if (trend.x[newest] - trend.x[oldest(trend)] < TREND_MIN_SPAN_S) {
+        return false;
+    }
+    int64_t n = trend.count;
+    int64_t den = n * trend.sumXX - trend.sumX * trend.sumX;
+    if (den <= 0) {
+        return false;
+    }
+    int64_t num = n * trend.sumXY - trend.sumX * trend.sumY;
+    perMinute = (float)((double)num / (double)den * 60.0 / 100.0);   // 1/100 °C per s -> °C per min
+    return true;
+}
+
+// EWMA of the temperature
+float trendSmoothed(const Trend &trend) {
+    return trend.ewma;
+}
+
+// projected minutes until the smoothed temperature crosses threshold
+float trendMinutesTo(const Trend &trend, float threshold) {
+    float slope;
+    if (!trendSlope(trend, slope)) {
+        return TREND_NO_ETA;
+    }
+    if (trend.ewma >= threshold) {
+        return 0;
+    }
+    if (slope < TREND_MIN_SLOPE) {
+        return TREND_NO_ETA;
+    }
+    return (threshold - trend.ewma) / slope;
+}
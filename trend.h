@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+// ======================================================================
+// Trend estimation
+// ======================================================================
+// Least-squares slope over a sliding window of samples plus an EWMA of
+// the temperature. The window holds at most TREND_WINDOW samples and
+// TREND_SPAN_S seconds, so it covers the same time at any sampling
+// period. The window sums are kept as exact 64 bit integers (time in s,
+// temperature in 1/100 °C), so adding a sample and dropping the oldest
+// one is O(1) and does not drift over weeks of uptime. The
+// projection answers "in how many minutes does the smoothed temperature
+// cross the threshold at the current rate", which lets the pre-alarm
+// fire while the product is still cold.
+
+#define TREND_WINDOW 120                                // Regression window in samples: 20 min at 10 s
+#define TREND_SPAN_S 1200                               // Regression window in time: 20 min at any period, spans a compressor cycle
+#define TREND_MIN_SAMPLES 6                             // Samples before a slope is reported
+#define TREND_MIN_SPAN_S 30                             // Time span before a slope is reported
+#define TREND_EWMA_ALPHA 0.2f                           // Weight of a new sample in the EWMA
+#define TREND_MIN_SLOPE 0.01f                           // °C/min, flatter counts as not rising
+#define TREND_REBASE_S 3600                             // Shift the time base once samples are 1 h from it (> TREND_SPAN_S)
+#define TREND_NO_ETA -1.0f                              // Not rising or not enough samples
+
+struct Trend {
+    int32_t x[TREND_WINDOW];                            // Sample time in s relative to baseMs
+    int16_t y[TREND_WINDOW];                            // Temperature in 1/100 °C
+    uint8_t head;                                       // Next slot
+    uint8_t count;                                      // Samples in the window
+    uint32_t baseMs;                                    // Time base of x
+    int64_t sumX, sumY, sumXX, sumXY;                   // Window sums
+    float ewma;                                         // Smoothed temperature
+};
+
+void trendReset(Trend &trend);                          // Empty window
+void trendAdd(Trend &trend, uint32_t ms, float tempC);  // Add a sample, drops the oldest one when the window is full
+bool trendSlope(const Trend &trend, float &perMinute);  // Slope in °C/min, false if not enough samples
+float trendSmoothed(const Trend &trend);                // EWMA of the temperature
+float trendMinutesTo(const Trend &trend, float threshold);  // Projected minutes until threshold is crossed, 0 if above, TREND_NO_ETA if not rising
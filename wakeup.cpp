@@ -0,0 +1,100 @@
+#include "wakeup.h"
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include "debug.h"
+
+static TaskHandle_t loopTask = nullptr;                 // Task running loop()
+static bool lightSleepEnabled = false;                  // Automatic light sleep is active
+static uint8_t buttonPin = 0;                           // CONFIG mode button (wakeupAttachButton)
+
+// Statistics of the loop task, only written by the loop task
+static uint32_t wakeups = 0;                            // Wakeups in the current window
+static uint64_t blockedUs = 0;                          // Time blocked in the current window
+static unsigned long windowStart = 0;                   // millis() at the start of the window
+static float wakeupsPerSecond = 0;                      // Result of the last full window
+static float idlePercent = 0;                           // Result of the last full window
+
+// remember the loop task and configure power management
+void wakeupBegin(bool lightSleep) {
+    loopTask = xTaskGetCurrentTaskHandle();
+    windowStart = millis();
+
+    if (!lightSleep) {
+        return;
+    }
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz = getCpuFrequencyMhz();
+    pm.min_freq_mhz = 80;                               // APB clock, lowest frequency Wi-Fi works with
+    pm.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&pm);
+    lightSleepEnabled = err == ESP_OK;
+    if (lightSleepEnabled) {
+        debugln("💤 Automatic light sleep enabled");
+    } else {
+        debugf("❌ Automatic light sleep not available (%s)\n", esp_err_to_name(err));
+    }
+}
+
+// wake the loop (any task)
+void wakeupSignal(uint32_t bits) {
+    if (loopTask != nullptr) {
+        xTaskNotify(loopTask, bits, eSetBits);
+    }
+}
+
+// wake the loop (interrupt)
+void IRAM_ATTR wakeupSignalFromISR(uint32_t bits) {
+    if (loopTask != nullptr) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(loopTask, bits, eSetBits, &woken);
+        if (woken) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+// wake the loop on a button edge and arm the opposite level, edges do not wake from light sleep
+static void IRAM_ATTR buttonISR() {
+    gpio_ll_set_intr_type(&GPIO, buttonPin, gpio_ll_get_level(&GPIO, buttonPin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    wakeupSignalFromISR(WAKE_BUTTON);
+}
+
+// wake the loop on both button edges, also out of automatic light sleep
+void wakeupAttachButton(uint8_t pin) {
+    buttonPin = pin;
+    attachInterrupt(pin, buttonISR, ONLOW);             // Installs the handler, the level is set below
+    gpio_wakeup_enable((gpio_num_t)pin, digitalRead(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    esp_err_t err = esp_sleep_enable_gpio_wakeup();
+    if (err != ESP_OK) {
+        debugf("❌ Button wakeup not available (%s)\n", esp_err_to_name(err));
+    }
+}
+
+// block until signalled or timeout
+uint32_t wakeupWait(uint32_t timeoutMs) {
+    uint32_t bits = 0;
+    int64_t start = esp_timer_get_time();
+    xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(timeoutMs));
+    blockedUs += esp_timer_get_time() - start;
+    wakeups++;
+
+    unsigned long now = millis();
+    unsigned long elapsed = now - windowStart;
+    if (elapsed >= WAKE_STATS_WINDOW_MS) {
+        wakeupsPerSecond = wakeups * 1000.0f / elapsed;
+        idlePercent = min(100.0f, blockedUs / (elapsed * 10.0f));
+        wakeups = 0;
+        blockedUs = 0;
+        windowStart = now;
+    }
+    return bits;
+}
+
+// add wakeups/s, idle % and light sleep state
+void wakeupStats(JsonDocument &sys) {
+    sys["loop_wakeups_per_s"] = roundf(wakeupsPerSecond * 10) / 10;
+    sys["loop_idle_pct"] = roundf(idlePercent * 10) / 10;
+    sys["light_sleep"] = lightSleepEnabled;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Event-driven loop
+// ======================================================================
+// loop() blocks on a task notification instead of spinning. Producers
+// (sensing task, web server, GPIO interrupt, Wi-Fi events) set a bit to wake it up, a
+// slow housekeeping tick covers OTA invitations and commit deadlines.
+// With nothing to do the idle task lets the CPU enter automatic light
+// sleep while Wi-Fi stays associated (modem sleep, DTIM wakeups).
+
+#define WAKE_SAMPLE (1 << 0)                            // New sample and alarm decisions (sensing task)
+#define WAKE_LIVE (1 << 1)                              // Live data changed (/getdata)
+#define WAKE_BUTTON (1 << 2)                            // Edge on the CONFIG mode button (GPIO interrupt)
+#define WAKE_WIFI (1 << 3)                              // Station connected/disconnected (Wi-Fi event task)
+
+#define WAKE_TICK_MS 500                                // Housekeeping: OTA invitations, commit deadlines
+#define WAKE_BUTTON_POLL_MS 10                          // Button timing while it is pressed/debouncing
+#define WAKE_STATS_WINDOW_MS 10000                      // Window for wakeups/s and idle %
+#define RSSI_INTERVAL_MS 5000                           // Sample the RSSI every 5 seconds
+
+void wakeupBegin(bool lightSleep);                      // Call from setup() (loop task), optionally enable light sleep
+void wakeupSignal(uint32_t bits);                       // Wake the loop (any task)
+void wakeupSignalFromISR(uint32_t bits);                // Wake the loop (interrupt)
+void wakeupAttachButton(uint8_t pin);                   // WAKE_BUTTON on both edges, also out of light sleep
+uint32_t wakeupWait(uint32_t timeoutMs);                // Block until signalled or timeout, returns the bits
+void wakeupStats(JsonDocument &sys);                    // Add wakeups/s, idle % and light sleep state
@@ -0,0 +1,49 @@
+#include "web_assets.h"
+#include "metrics.h"
+#include "debug.h"
+#include "web_assets_data.h"                            // Generated by embed_assets.py
+
+// Statistics
+static uint32_t served = 0;                             // 200 responses
+static uint32_t notModified = 0;                        // 304 responses
+static uint32_t bytesSent = 0;                          // Body bytes of the 200 responses
+
+// send an asset or 304 if the client already has it
+static void sendAsset(AsyncWebServerRequest *request, const WebAsset &asset) {
+    uint32_t start = micros();
+    bool page = strcmp(asset.mime, "text/html") == 0;
+    AsyncWebServerResponse *response;
+
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == asset.etag) {
+        response = request->beginResponse(304);
+        notModified++;
+    } else {
+        response = request->beginResponse(200, asset.mime, asset.data, asset.len);
+        if (asset.gzip) {
+            response->addHeader("Content-Encoding", "gzip");
+        }
+        served++;
+        bytesSent += asset.len;
+    }
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", page ? WEB_PAGE_CACHE : WEB_ASSET_MAX_AGE);
+    request->send(response);
+    metricsObserve(HIST_HTTP_ASSET, micros() - start);
+}
+
+// register a GET route for every embedded asset
+void webAssetsBegin(AsyncWebServer &server) {
+    for (const WebAsset &asset : WEB_ASSETS) {
+        server.on(asset.url, HTTP_GET, [&asset](AsyncWebServerRequest *request) {
+            sendAsset(request, asset);
+        });
+    }
+    debugf("✅ %u web assets embedded\n", (unsigned)(sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0])));
+}
+
+// add served/not-modified counters and bytes
+void webAssetStats(JsonDocument &sys) {
+    sys["web_served"] = served;
+    sys["web_not_modified"] = notModified;
+    sys["web_bytes_sent"] = bytesSent;
+}
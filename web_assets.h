@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// ======================================================================
+// Embedded web assets
+// ======================================================================
+// The web UI is minified, gzipped and embedded in flash at build time
+// by embed_assets.py. Responses carry a strong ETag (content hash), so
+// a revalidation costs a 304 without body. CSS/SVG/icon URLs in the
+// pages carry ?v=<hash> and are cached for a year, the pages
+// themselves are revalidated on every load.
+
+#define WEB_ASSET_MAX_AGE "public, max-age=31536000, immutable"  // Fingerprinted CSS/SVG/icon
+#define WEB_PAGE_CACHE "no-cache"                       // Pages: always revalidate with the ETag
+
+struct WebAsset {
+    const char *url;                                    // Request path
+    const char *mime;                                   // Content type
+    const uint8_t *data;                                // Content in flash
+    size_t len;                                         // Content length
+    const char *etag;                                   // Quoted content hash
+    bool gzip;                                          // Content is gzip-encoded
+};
+
+void webAssetsBegin(AsyncWebServer &server);            // Register a GET route for every embedded asset
+void webAssetStats(JsonDocument &sys);                  // Add served/not-modified counters and bytes
@@ -0,0 +1,204 @@
+#include "wifi_manager.h"
+#include <atomic>
+#include <WiFi.h>
+#include <Preferences.h>
+#include "metrics.h"
+#include "wakeup.h"
+#include "debug.h"
+
+enum WifiState : uint8_t {
+    WIFI_STATE_IDLE,                                    // wifiBegin() not called (CONFIG/DEEP_SLEEP mode)
+    WIFI_STATE_CONNECTING,                              // Attempt running
+    WIFI_STATE_CONNECTED,                               // Got an IP address
+    WIFI_STATE_WAITING                                  // Backoff before the next attempt
+};
+
+static const char *const STATE_NAME[] = {"idle", "connecting", "connected", "waiting"};
+
+// Credentials and cached access point
+static char ssid[33];
+static char password[64];
+static uint8_t cachedBssid[6];                          // BSSID of the last successful connection
+static uint8_t cachedChannel = 0;                       // Channel of the last successful connection, 0 = none
+static bool useCache = false;                           // Next attempt skips the scan
+
+// State machine, only used by the loop task
+static WifiState state = WIFI_STATE_IDLE;
+static bool connectedOnce = false;                      // Distinguishes reconnects from the first connect
+static bool attemptCached = false;                      // Running attempt uses the cached BSSID/channel
+static uint32_t attemptStart = 0;                       // millis() of the running attempt
+static uint32_t retryAt = 0;                            // millis() of the next attempt
+static uint32_t offlineSinceUs = 0;                     // micros() of the boot/link loss, for the connect time
+
+// Set by the Wi-Fi event task, consumed by wifiLoop()
+static std::atomic<bool> gotIp(false);
+static std::atomic<bool> lostLink(false);
+static std::atomic<uint8_t> lastReason(0);              // wifi_err_reason_t of the last disconnect
+
+// Statistics
+static uint32_t lastConnectMs = 0;                      // Boot/link loss until IP, last time
+static uint32_t failures = 0;                           // Failed attempts since the last connect
+static uint32_t attempts = 0;                           // All attempts
+static uint32_t cachedHits = 0;                         // Connects without a scan
+
+// Wi-Fi event task: only flag and wake the loop
+static void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        gotIp = true;
+        wakeupSignal(WAKE_WIFI);
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        lastReason = info.wifi_sta_disconnected.reason;
+        lostLink = true;
+        wakeupSignal(WAKE_WIFI);
+    }
+}
+
+// load BSSID/channel of the last connection to this SSID
+static void loadCache() {
+    Preferences prefs;
+    if (!prefs.begin("wifi", true)) {
+        return;
+    }
+    if (prefs.getString("ssid", "") == ssid && prefs.getBytes("bssid", cachedBssid, sizeof(cachedBssid)) == sizeof(cachedBssid)) {
+        cachedChannel = prefs.getUChar("channel", 0);
+    }
+    prefs.end();
+    useCache = cachedChannel != 0;
+}
+
+// store BSSID/channel if they changed (roaming, new access point)
+static void storeCache() {
+    const uint8_t *bssid = WiFi.BSSID();
+    uint8_t channel = WiFi.channel();
+    if (bssid == nullptr || (channel == cachedChannel && memcmp(bssid, cachedBssid, sizeof(cachedBssid)) == 0)) {
+        return;
+    }
+    memcpy(cachedBssid, bssid, sizeof(cachedBssid));
+    cachedChannel = channel;
+
+    Preferences prefs;
+    if (prefs.begin("wifi", false)) {
+        prefs.putString("ssid", ssid);
+        prefs.putBytes("bssid", cachedBssid, sizeof(cachedBssid));
+        prefs.putUChar("channel", cachedChannel);
+        prefs.end();
+        debugf("📶 Cached access point %02X:%02X:%02X:%02X:%02X:%02X on channel %u\n",
+               cachedBssid[0], cachedBssid[1], cachedBssid[2], cachedBssid[3], cachedBssid[4], cachedBssid[5], cachedChannel);
+    }
+}
+
+// start an attempt, with the cached access point if there is one
+static void startAttempt() {
+    attemptCached = useCache;
+    attemptStart = millis();
+    attempts++;
+    lostLink = false;                                   // Disconnect of the previous attempt
+    state = WIFI_STATE_CONNECTING;
+
+    if (attemptCached) {
+        debugf("📶 Connecting WiFi STA with %s (channel %u, no scan)\n", ssid, cachedChannel);
+        WiFi.begin(ssid, password, cachedChannel, cachedBssid);
+    } else {
+        debugf("📶 Connecting WiFi STA with %s\n", ssid);
+        WiFi.begin(ssid, password);
+    }
+}
+
+// attempt failed: scan on the next attempt if the cache was used, else back off
+static void attemptFailed(uint32_t now, bool timeout) {
+    if (timeout) {
+        WiFi.disconnect();                              // Its disconnect event is dropped by the next startAttempt()
+    }
+    state = WIFI_STATE_WAITING;
+
+    if (attemptCached) {                                // Access point moved or gone -> scan almost right away
+        useCache = false;
+        retryAt = now + WIFI_SETTLE_MS;
+        debugf("❌ WiFi: cached access point failed (reason %u), scanning\n", lastReason.load());
+        return;
+    }
+    failures++;
+    uint32_t backoff = min<uint32_t>(WIFI_RETRY_BASE_MS << min<uint32_t>(failures - 1, 16), WIFI_RETRY_MAX_MS);
+    retryAt = now + backoff;
+    debugf("❌ WiFi connection failed (reason %u), retry in %lu s\n", lastReason.load(), (unsigned long)(backoff / 1000));
+}
+
+// start connecting
+void wifiBegin(const char *staSsid, const char *staPassword, const char *hostname) {
+    strlcpy(ssid, staSsid, sizeof(ssid));
+    strlcpy(password, staPassword, sizeof(password));
+    loadCache();
+
+    WiFi.onEvent(onWiFiEvent);
+    WiFi.persistent(false);                             // Credentials live in the config, no flash write per begin
+    WiFi.setAutoReconnect(false);                       // Reconnects are done by wifiLoop()
+    WiFi.setHostname(hostname);
+    WiFi.mode(WIFI_STA);
+
+    offlineSinceUs = micros();
+    startAttempt();
+}
+
+// run the state machine
+WifiEvent wifiLoop() {
+    if (state == WIFI_STATE_IDLE) {
+        return WIFI_EVENT_NONE;
+    }
+    uint32_t now = millis();
+
+    if (gotIp.exchange(false) && state != WIFI_STATE_CONNECTED) {
+        uint32_t connectUs = micros() - offlineSinceUs;
+        lastConnectMs = connectUs / 1000;
+        metricsObserve(HIST_WIFI_CONNECT, connectUs);
+        if (connectedOnce) {
+            metricsIncrement(COUNT_WIFI_RECONNECTS);
+        }
+        if (attemptCached) {
+            cachedHits++;
+        }
+        connectedOnce = true;
+        failures = 0;
+        state = WIFI_STATE_CONNECTED;
+        storeCache();
+        useCache = true;
+        debugf("✅ WiFi connected in %lu ms, IP: %s\n", (unsigned long)lastConnectMs, WiFi.localIP().toString().c_str());
+        return WIFI_EVENT_UP;
+    }
+
+    if (lostLink.exchange(false)) {
+        if (state == WIFI_STATE_CONNECTED) {            // Reconnect right away, with the cached access point
+            metricsIncrement(COUNT_WIFI_DISCONNECTS);
+            offlineSinceUs = micros();
+            state = WIFI_STATE_WAITING;
+            retryAt = now;
+            debugf("❌ WiFi lost (reason %u)\n", lastReason.load());
+            return WIFI_EVENT_DOWN;
+        }
+        if (state == WIFI_STATE_CONNECTING) {
+            attemptFailed(now, false);
+        }
+    }
+
+    if (state == WIFI_STATE_CONNECTING && now - attemptStart >= WIFI_CONNECT_TIMEOUT_MS) {
+        lastReason = 0;
+        attemptFailed(now, true);
+    }
+    if (state == WIFI_STATE_WAITING && (int32_t)(now - retryAt) >= 0) {
+        startAttempt();
+    }
+    return WIFI_EVENT_NONE;
+}
+
+// station has an IP address
+bool wifiConnected() {
+    return state == WIFI_STATE_CONNECTED;
+}
+
+// add state, connect time, failures and cache use
+void wifiStats(JsonDocument &sys) {
+    sys["wifi_state"] = STATE_NAME[state];
+    sys["wifi_connect_ms"] = lastConnectMs;
+    sys["wifi_attempts"] = attempts;
+    sys["wifi_failures"] = failures;
+    sys["wifi_cached_connects"] = cachedHits;
+}
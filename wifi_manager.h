@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ======================================================================
+// Wi-Fi connection manager
+// ======================================================================
+// Connects the station in the background instead of blocking setup():
+// the Wi-Fi event callbacks only set flags and wake the loop, which runs
+// the state machine in wifiLoop(). The BSSID and channel of the last
+// successful connection are kept in NVS, so a (re)connect can skip the
+// scan; if that fails the next attempt scans all channels. Failed
+// attempts are retried forever with exponential backoff.
+
+#define WIFI_CONNECT_TIMEOUT_MS 10000                   // Give up on an attempt after 10 s
+#define WIFI_RETRY_BASE_MS 1000                         // First retry after 1 s, then 2 s, 4 s, ...
+#define WIFI_RETRY_MAX_MS 60000                         // ... but at least once a minute
+#define WIFI_SETTLE_MS 250                              // Pause before the scan after a failed cached attempt
+
+enum WifiEvent : uint8_t {
+    WIFI_EVENT_NONE,                                    // No change
+    WIFI_EVENT_UP,                                      // Got an IP address (first connect or reconnect)
+    WIFI_EVENT_DOWN                                     // Lost the access point
+};
+
+void wifiBegin(const char *ssid, const char *password, const char *hostname);  // Start connecting, returns immediately
+WifiEvent wifiLoop();                                   // Run the state machine, call from loop()
+bool wifiConnected();                                   // Station has an IP address
+void wifiStats(JsonDocument &sys);                      // Add state, connect time, failures and cache use